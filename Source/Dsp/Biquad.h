@@ -107,6 +107,17 @@ public:
         }
     }
 
+    // A single section is already processed one stage at a time
+    template <class StateType, typename Sample>
+    void processBlockMajor(int numSamples,
+                           Sample* const* arrayOfChannels,
+                           StateType* states,
+                           int numChannels) const
+    {
+        for (int i = 0; i < numChannels; ++i)
+            process(numSamples, arrayOfChannels[i], states[i]);
+    }
+
 protected:
     //
     // These are protected so you can't mess with RBJ biquads
@@ -146,6 +157,32 @@ public:
 
 //------------------------------------------------------------------------------
 
+// The normalized coefficients of a section, converted once to the
+// precision of a filter state. Members have the same names as in
+// BiquadBase, so any state's process1() accepts either.
+template <typename Real>
+struct BiquadCoefficients
+{
+    BiquadCoefficients()
+        : m_a1(0), m_a2(0), m_b1(0), m_b2(0), m_b0(1)
+    {
+    }
+
+    explicit BiquadCoefficients(const BiquadBase& s)
+        : m_a1(Real(s.m_a1)), m_a2(Real(s.m_a2))
+        , m_b1(Real(s.m_b1)), m_b2(Real(s.m_b2)), m_b0(Real(s.m_b0))
+    {
+    }
+
+    Real m_a1;
+    Real m_a2;
+    Real m_b1;
+    Real m_b2;
+    Real m_b0;
+};
+
+//------------------------------------------------------------------------------
+
 // Expresses a biquad as a pair of pole/zeros, with gain
 // values so that the coefficients can be reconstructed precisely.
 struct BiquadPoleState : PoleZeroPair
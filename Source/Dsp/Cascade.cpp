@@ -43,6 +43,7 @@ Cascade::Cascade()
     : m_numStages(0)
     , m_maxStages(0)
     , m_stageArray(0)
+    , m_floatStageArray(0)
 {
 }
 
@@ -51,6 +52,7 @@ void Cascade::setCascadeStorage(const Storage& storage)
     m_numStages = 0;
     m_maxStages = storage.maxStages;
     m_stageArray = storage.stageArray;
+    m_floatStageArray = storage.floatStageArray;
 }
 
 complex_t Cascade::response(double normalizedFrequency) const
@@ -99,6 +101,14 @@ void Cascade::applyScale(double scale)
     // to spread this factor between all the stages.
     assert(m_numStages > 0);
     m_stageArray->applyScale(scale);
+
+    updateFloatStages();
+}
+
+void Cascade::updateFloatStages()
+{
+    for (int i = 0; i < m_numStages; ++i)
+        m_floatStageArray[i] = FloatStage(m_stageArray[i]);
 }
 
 void Cascade::setLayout(const LayoutBase& proto)
@@ -58,22 +58,105 @@ public:
     class StateBase : private DenormalPrevention
     {
     public:
+        // Precision of the state and of all arithmetic on it
+        typedef typename StateType::RealType RealType;
+
         template <typename Sample>
         inline Sample process(const Sample in, const Cascade& c)
         {
-            double out = in;
+            return process(in, c.getStages(RealType()), c.m_numStages);
+        }
+
+        // Process a sample through an external array of sections. Used
+        // by SmoothedFilterDesign to run interpolated coefficients
+        // without touching the design itself.
+        template <typename Sample, class Section>
+        inline Sample process(const Sample in,
+                              Section const* stage,
+                              const int numStages)
+        {
+            RealType out = static_cast<RealType>(in);
             StateType* state = m_stateArray;
-            Biquad const* stage = c.m_stageArray;
-            const double vsa = ac();
-            int i = c.m_numStages - 1;
+            const RealType vsa = RealType(ac());
+            int i = numStages - 1;
             out = (state++)->process1(out, *stage++, vsa);
             for (; --i >= 0;)
-                out = (state++)->process1(out, *stage++, 0);
+                out = (state++)->process1(out, *stage++, RealType(0));
             //for (int i = c.m_numStages; --i >= 0; ++state, ++stage)
             //  out = state->process1 (out, *stage, vsa);
             return static_cast<Sample>(out);
         }
 
+        // Run one section over a block of intermediate values, for this
+        // channel and optionally a second, independent one. The two
+        // recurrences are interleaved so that their latencies overlap.
+        // The arithmetic is identical to process(), sample for sample.
+        template <class Section>
+        void processSection(int index,
+                            const Section& stage,
+                            int numSamples,
+                            RealType* work,
+                            StateBase* other,
+                            RealType* otherWork)
+        {
+            // local copies keep the state in registers
+            StateType s = m_stateArray[index];
+
+            // ac() alternates in sign on every call; take the first value
+            // and leave the generator as numSamples calls would have
+            RealType vsa = 0;
+            RealType otherVsa = 0;
+
+            if (index == 0)
+            {
+                vsa = RealType(ac());
+                if ((numSamples & 1) == 0)
+                    ac();
+
+                if (other != 0)
+                {
+                    otherVsa = RealType(other->ac());
+                    if ((numSamples & 1) == 0)
+                        other->ac();
+                }
+            }
+
+            if (other == 0)
+            {
+                if (index == 0)
+                    for (int n = 0; n < numSamples; ++n)
+                        work[n] = s.process1(work[n], stage, (n & 1) ? -vsa : vsa);
+                else
+                    for (int n = 0; n < numSamples; ++n)
+                        work[n] = s.process1(work[n], stage, RealType(0));
+            }
+            else
+            {
+                StateType s2 = other->m_stateArray[index];
+
+                if (index == 0)
+                {
+                    for (int n = 0; n < numSamples; ++n)
+                    {
+                        work[n] = s.process1(work[n], stage, (n & 1) ? -vsa : vsa);
+                        otherWork[n] = s2.process1(otherWork[n], stage, (n & 1) ? -otherVsa : otherVsa);
+                    }
+                }
+                else
+                {
+                    for (int n = 0; n < numSamples; ++n)
+                    {
+                        work[n] = s.process1(work[n], stage, RealType(0));
+                        otherWork[n] = s2.process1(otherWork[n], stage, RealType(0));
+                    }
+                }
+
+                other->m_stateArray[index] = s2;
+            }
+
+            m_stateArray[index] = s;
+        }
+
     protected:
         StateBase(StateType* stateArray)
             : m_stateArray(stateArray)
@@ -88,16 +171,21 @@ public:
     {
     };
 
+    // Single-precision copy of a stage, for float states
+    typedef BiquadCoefficients <float> FloatStage;
+
     struct Storage
     {
-        Storage(int maxStages_, Stage* stageArray_)
+        Storage(int maxStages_, Stage* stageArray_, FloatStage* floatStageArray_)
             : maxStages(maxStages_)
             , stageArray(stageArray_)
+            , floatStageArray(floatStageArray_)
         {
         }
 
         int maxStages;
         Stage* stageArray;
+        FloatStage* floatStageArray;
     };
 
     int getNumStages() const
@@ -105,7 +193,7 @@ public:
         return m_numStages;
     }
 
-    const Stage& operator[](int index)
+    const Stage& operator[](int index) const
     {
         assert(index >= 0 && index <= m_numStages);
         return m_stageArray[index];
@@ -128,6 +216,82 @@ public:
         }
     }
 
+    // The stages in a given precision: the designed (double) sections, or
+    // their single-precision copies. Selected by the type of the argument.
+    const Stage* getStages(double) const
+    {
+        return m_stageArray;
+    }
+
+    const FloatStage* getStages(float) const
+    {
+        return m_floatStageArray;
+    }
+
+    enum { blockMajorChunk = 256 };
+
+    // Process several channels one section at a time: each section runs
+    // over a whole chunk before the next one starts, and channels are
+    // taken in pairs. The state after each call, and the output, are
+    // bit-identical to process().
+    //
+    // A lone channel gains nothing from this (consecutive sections
+    // already overlap in the sample-major loop), so it is processed
+    // sample by sample.
+    template <class StateType, typename Sample>
+    void processBlockMajor(int numSamples,
+                           Sample* const* arrayOfChannels,
+                           StateType* states,
+                           int numChannels) const
+    {
+        for (int c = 0; c < numChannels; c += 2)
+        {
+            if (c + 1 < numChannels)
+                processPair(numSamples,
+                            arrayOfChannels[c], states[c],
+                            arrayOfChannels[c+1], states[c+1]);
+            else
+                process(numSamples, arrayOfChannels[c], states[c]);
+        }
+    }
+
+    // Process two independent channels through this cascade, one section
+    // at a time with the two recurrences interleaved.
+    template <class StateType, typename Sample>
+    void processPair(int numSamples,
+                     Sample* dest1, StateType& state1,
+                     Sample* dest2, StateType& state2) const
+    {
+        typedef typename StateType::RealType RealType;
+
+        const RealType realType = 0;
+        RealType work[2][blockMajorChunk];
+
+        for (int offset = 0; offset < numSamples; offset += blockMajorChunk)
+        {
+            const int n = std::min(int(blockMajorChunk), numSamples - offset);
+
+            Sample* src1 = dest1 + offset;
+            Sample* src2 = dest2 + offset;
+
+            for (int i = 0; i < n; ++i)
+            {
+                work[0][i] = static_cast<RealType>(src1[i]);
+                work[1][i] = static_cast<RealType>(src2[i]);
+            }
+
+            for (int stage = 0; stage < m_numStages; ++stage)
+                state1.processSection(stage, getStages(realType)[stage], n,
+                                      work[0], &state2, work[1]);
+
+            for (int i = 0; i < n; ++i)
+            {
+                src1[i] = static_cast<Sample>(work[0][i]);
+                src2[i] = static_cast<Sample>(work[1][i]);
+            }
+        }
+    }
+
 protected:
     Cascade();
 
@@ -137,9 +301,13 @@ protected:
     void setLayout(const LayoutBase& proto);
 
 private:
+    // Copies the designed stages into m_floatStageArray
+    void updateFloatStages();
+
     int m_numStages;
     int m_maxStages;
     Stage* m_stageArray;
+    FloatStage* m_floatStageArray;
 };
 
 //------------------------------------------------------------------------------
@@ -173,11 +341,12 @@ public:
     /*@Internal*/
     Cascade::Storage getCascadeStorage()
     {
-        return Cascade::Storage(MaxStages, m_stages);
+        return Cascade::Storage(MaxStages, m_stages, m_floatStages);
     }
 
 private:
     Cascade::Stage m_stages[MaxStages];
+    Cascade::FloatStage m_floatStages[MaxStages];
 };
 
 }
@@ -207,6 +207,7 @@ class FilterDesign : public FilterDesignBase <DesignClass>
 {
 public:
     FilterDesign()
+        : m_blockMajor(false)
     {
     }
 
@@ -220,19 +221,44 @@ public:
         m_state.reset();
     }
 
+    // When set, blocks are processed one section at a time across the
+    // whole block (and channels in pairs) instead of one sample at a
+    // time through every section. The results are identical; only the
+    // order of the work changes.
+    void setBlockMajor(bool blockMajor)
+    {
+        m_blockMajor = blockMajor;
+    }
+
+    bool isBlockMajor() const
+    {
+        return m_blockMajor;
+    }
+
     void process(int numSamples, float* const* arrayOfChannels)
     {
-        m_state.process(numSamples, arrayOfChannels,
-                        FilterDesignBase<DesignClass>::m_design);
+        processChannels(numSamples, arrayOfChannels);
     }
 
     void process(int numSamples, double* const* arrayOfChannels)
     {
-        m_state.process(numSamples, arrayOfChannels,
-                        FilterDesignBase<DesignClass>::m_design);
+        processChannels(numSamples, arrayOfChannels);
     }
 
 protected:
+    template <typename Sample>
+    void processChannels(int numSamples, Sample* const* arrayOfChannels)
+    {
+        if (m_blockMajor)
+            m_state.processBlockMajor(numSamples, arrayOfChannels,
+                                      FilterDesignBase<DesignClass>::m_design);
+        else
+            m_state.process(numSamples, arrayOfChannels,
+                            FilterDesignBase<DesignClass>::m_design);
+    }
+
+    bool m_blockMajor;
+
     ChannelsState <Channels,
                   typename DesignClass::template State <StateType> > m_state;
 };
@@ -37,6 +37,7 @@ THE SOFTWARE.
 #define DSPFILTERS_SMOOTHEDFILTER_H
 
 #include "Common.h"
+#include "Cascade.h"
 #include "Filter.h"
 
 namespace Dsp
@@ -45,6 +46,20 @@ namespace Dsp
 /*
  * Implements smooth modulation of time-varying filter parameters
  *
+ * When the parameters change, the new filter is designed once (in
+ * setParams) and the transition is carried out by linearly interpolating
+ * the normalized biquad coefficients of each section, from the values in
+ * use at that moment to those of the new design. No pole/zero design
+ * happens inside the sample loop, so the cost of a transition is a few
+ * additions per section per sample.
+ *
+ * The stability region of a second order section (|a2| < 1,
+ * |a1| < 1 + a2) is convex, so every intermediate section is stable
+ * when both endpoints are.
+ *
+ * If the number of sections changes (e.g. a different order), the new
+ * coefficients take effect immediately.
+ *
  */
 template <class DesignClass,
          int Channels,
@@ -57,9 +72,12 @@ class SmoothedFilterDesign
 public:
     typedef FilterDesign <DesignClass, Channels, StateType> filter_type_t;
 
+    enum { maxSmoothedStages = 32 };
+
     SmoothedFilterDesign(int transitionSamples)
         : m_transitionSamples(transitionSamples)
         , m_remainingSamples(-1)  // first time flag
+        , m_numStages(0)
     {
     }
 
@@ -78,40 +96,52 @@ public:
 
         if (remainingSamples > 0)
         {
-            // interpolate parameters for each sample
+            // step the coefficients towards the target for each sample
             const double t = 1. / m_remainingSamples;
-            double dp[maxParameters];
-            for (int i = 0; i < DesignClass::NumParams; ++i)
-                dp[i] = (this->getParams()[i] - m_transitionParams[i]) * t;
+            Coefficients delta[maxSmoothedStages];
+            for (int s = 0; s < m_numStages; ++s)
+                delta[s].setStep(m_target[s], m_current[s], t);
 
             for (int n = 0; n < remainingSamples; ++n)
             {
-                for (int i = DesignClass::NumParams; --i >=0;)
-                    m_transitionParams[i] += dp[i];
-
-                m_transitionFilter.setParams(m_transitionParams);
+                for (int s = 0; s < m_numStages; ++s)
+                    delta[s].addTo(m_current[s]);
 
                 for (int i = numChannels; --i >= 0;)
                 {
                     Sample* dest = destChannelArray[i]+n;
-                    *dest = this->m_state[i].process(*dest, m_transitionFilter);
+                    *dest = processStages(this->m_state[i], *dest);
                 }
             }
 
             m_remainingSamples -= remainingSamples;
 
+            // land exactly on the designed coefficients
             if (m_remainingSamples == 0)
-                m_transitionParams = this->getParams();
+                copyStages(m_target, m_current, m_numStages);
         }
 
         // do what's left
         if (numSamples - remainingSamples > 0)
         {
             // no transition
-            for (int i = 0; i < numChannels; ++i)
-                this->m_design.process(numSamples - remainingSamples,
-                                       destChannelArray[i] + remainingSamples,
-                                       this->m_state[i]);
+            if (this->m_blockMajor)
+            {
+                Sample* remaining[Channels > 0 ? Channels : 1];
+                for (int i = 0; i < numChannels; ++i)
+                    remaining[i] = destChannelArray[i] + remainingSamples;
+
+                this->m_state.processBlockMajor(numSamples - remainingSamples,
+                                                remaining,
+                                                this->m_design);
+            }
+            else
+            {
+                for (int i = 0; i < numChannels; ++i)
+                    this->m_design.process(numSamples - remainingSamples,
+                                           destChannelArray[i] + remainingSamples,
+                                           this->m_state[i]);
+            }
         }
     }
 
@@ -128,26 +158,94 @@ public:
 protected:
     void doSetParams(const Params& parameters)
     {
-        if (m_remainingSamples >= 0)
+        filter_type_t::doSetParams(parameters);
+
+        const int numStages = getStages(this->m_design, m_target);
+
+        if (m_remainingSamples >= 0 && numStages == m_numStages)
         {
+            // start from whatever is in use now, even mid-transition
             m_remainingSamples = m_transitionSamples;
         }
         else
         {
-            // first time
+            // first time, or the layout changed
             m_remainingSamples = 0;
-            m_transitionParams = parameters;
+            m_numStages = numStages;
+            copyStages(m_target, m_current, m_numStages);
         }
+    }
 
-        filter_type_t::doSetParams(parameters);
+private:
+    // Per-sample increments for the normalized coefficients of one section
+    struct Coefficients
+    {
+        void setStep(const Biquad& to, const Biquad& from, double t)
+        {
+            a1 = (to.m_a1 - from.m_a1) * t;
+            a2 = (to.m_a2 - from.m_a2) * t;
+            b0 = (to.m_b0 - from.m_b0) * t;
+            b1 = (to.m_b1 - from.m_b1) * t;
+            b2 = (to.m_b2 - from.m_b2) * t;
+        }
+
+        inline void addTo(Biquad& s) const
+        {
+            s.m_a1 += a1;
+            s.m_a2 += a2;
+            s.m_b0 += b0;
+            s.m_b1 += b1;
+            s.m_b2 += b2;
+        }
+
+        double a1, a2, b0, b1, b2;
+    };
+
+    static void copyStages(const Biquad* src, Biquad* dest, int numStages)
+    {
+        for (int s = 0; s < numStages; ++s)
+            dest[s] = src[s];
+    }
+
+    // Pole filter families are cascades of sections...
+    static int getStages(const Cascade& design, Biquad* dest)
+    {
+        const int numStages = std::min(design.getNumStages(),
+                                       int(maxSmoothedStages));
+
+        for (int s = 0; s < numStages; ++s)
+            dest[s] = design[s];
+
+        return numStages;
+    }
+
+    // ...while RBJ designs are a single section.
+    static int getStages(const BiquadBase& design, Biquad* dest)
+    {
+        static_cast<BiquadBase&>(dest[0]) = design;
+        return 1;
+    }
+
+    template <class State, typename Sample>
+    inline Sample processStages(Cascade::StateBase <State>& state, const Sample in)
+    {
+        return state.process(in, m_current, m_numStages);
+    }
+
+    template <class State, typename Sample>
+    inline Sample processStages(BiquadBase::State <State>& state, const Sample in)
+    {
+        return state.process(in, m_current[0]);
     }
 
 protected:
-    Params m_transitionParams;
-    DesignClass m_transitionFilter;
     int m_transitionSamples;
 
     int m_remainingSamples;        // remaining transition samples
+
+    int m_numStages;
+    Biquad m_current[maxSmoothedStages];  // coefficients in use
+    Biquad m_target[maxSmoothedStages];   // coefficients of m_design
 };
 
 }
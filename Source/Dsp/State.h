@@ -48,6 +48,18 @@ namespace Dsp
  * Various forms of state information required to
  * process channels of actual sample data.
  *
+ * The realizations below are templated on the precision (Real) used for
+ * the state and the arithmetic. The familiar names (DirectFormII etc.)
+ * are the double-precision versions. The float versions halve the size of
+ * the state and allow twice the SIMD width, at the cost of accuracy; for
+ * low-order band-pass filters well inside the Nyquist band the transposed
+ * direct form II is the most robust choice in single precision.
+ *
+ * process1() accepts any section with public m_a1 ... m_b2 members: a
+ * BiquadBase, whose double coefficients are narrowed on every call, or a
+ * BiquadCoefficients <RealType>, which a Cascade keeps up to date so that
+ * the float path never touches a double.
+ *
  */
 
 //------------------------------------------------------------------------------
@@ -60,10 +72,11 @@ namespace Dsp
  *  y[n] = (b0/a0)*x[n] + (b1/a0)*x[n-1] + (b2/a0)*x[n-2]
  *                      - (a1/a0)*y[n-1] - (a2/a0)*y[n-2]
  */
-class DirectFormI
+template <typename Real>
+class BasicDirectFormI
 {
 public:
-    DirectFormI()
+    BasicDirectFormI()
     {
         reset();
     }
@@ -76,29 +89,35 @@ public:
         m_y2 = 0;
     }
 
-    template <typename Sample>
+    typedef Real RealType;
+
+    template <typename Sample, class Coefficients>
     inline Sample process1(const Sample in,
-                           const BiquadBase& s,
-                           const double vsa) // very small amount
+                           const Coefficients& s,
+                           const Real vsa) // very small amount
     {
-        double out = s.m_b0*in + s.m_b1*m_x1 + s.m_b2*m_x2
-                     - s.m_a1*m_y1 - s.m_a2*m_y2
-                     + vsa;
+        const Real x = static_cast<Real>(in);
+        Real out = Real(s.m_b0)*x + Real(s.m_b1)*m_x1 + Real(s.m_b2)*m_x2
+                   - Real(s.m_a1)*m_y1 - Real(s.m_a2)*m_y2
+                   + vsa;
         m_x2 = m_x1;
         m_y2 = m_y1;
-        m_x1 = in;
+        m_x1 = x;
         m_y1 = out;
 
         return static_cast<Sample>(out);
     }
 
 protected:
-    double m_x2; // x[n-2]
-    double m_y2; // y[n-2]
-    double m_x1; // x[n-1]
-    double m_y1; // y[n-1]
+    Real m_x2; // x[n-2]
+    Real m_y2; // y[n-2]
+    Real m_x1; // x[n-1]
+    Real m_y1; // y[n-1]
 };
 
+typedef BasicDirectFormI <double> DirectFormI;
+typedef BasicDirectFormI <float> DirectFormIFloat;
+
 //------------------------------------------------------------------------------
 
 /*
@@ -110,10 +129,11 @@ protected:
  *  y(n) = (b0/a0)*v[n] + (b1/a0)*v[n-1] + (b2/a0)*v[n-2]
  *
  */
-class DirectFormII
+template <typename Real>
+class BasicDirectFormII
 {
 public:
-    DirectFormII()
+    BasicDirectFormII()
     {
         reset();
     }
@@ -124,13 +144,15 @@ public:
         m_v2 = 0;
     }
 
-    template <typename Sample>
+    typedef Real RealType;
+
+    template <typename Sample, class Coefficients>
     Sample process1(const Sample in,
-                    const BiquadBase& s,
-                    const double vsa)
+                    const Coefficients& s,
+                    const Real vsa)
     {
-        double w   = in - s.m_a1*m_v1 - s.m_a2*m_v2 + vsa;
-        double out =      s.m_b0*w    + s.m_b1*m_v1 + s.m_b2*m_v2;
+        Real w   = static_cast<Real>(in) - Real(s.m_a1)*m_v1 - Real(s.m_a2)*m_v2 + vsa;
+        Real out =      Real(s.m_b0)*w    + Real(s.m_b1)*m_v1 + Real(s.m_b2)*m_v2;
 
         m_v2 = m_v1;
         m_v1 = w;
@@ -139,10 +161,13 @@ public:
     }
 
 private:
-    double m_v1; // v[-1]
-    double m_v2; // v[-2]
+    Real m_v1; // v[-1]
+    Real m_v2; // v[-2]
 };
 
+typedef BasicDirectFormII <double> DirectFormII;
+typedef BasicDirectFormII <float> DirectFormIIFloat;
+
 //------------------------------------------------------------------------------
 
 /*
@@ -176,9 +201,11 @@ public:
         m_s4_1 = 0;
     }
 
-    template <typename Sample>
+    typedef double RealType;
+
+    template <typename Sample, class Coefficients>
     inline Sample process1(const Sample in,
-                           const BiquadBase& s,
+                           const Coefficients& s,
                            const double vsa)
     {
         double out;
@@ -213,10 +240,11 @@ private:
 
 //------------------------------------------------------------------------------
 
-class TransposedDirectFormII
+template <typename Real>
+class BasicTransposedDirectFormII
 {
 public:
-    TransposedDirectFormII()
+    BasicTransposedDirectFormII()
     {
         reset();
     }
@@ -229,16 +257,19 @@ public:
         m_s2_1 = 0;
     }
 
-    template <typename Sample>
+    typedef Real RealType;
+
+    template <typename Sample, class Coefficients>
     inline Sample process1(const Sample in,
-                           const BiquadBase& s,
-                           const double vsa)
+                           const Coefficients& s,
+                           const Real vsa)
     {
-        double out;
+        const Real x = static_cast<Real>(in);
+        Real out;
 
-        out = m_s1_1 + s.m_b0*in + vsa;
-        m_s1 = m_s2_1 + s.m_b1*in - s.m_a1*out;
-        m_s2 = s.m_b2*in - s.m_a2*out;
+        out = m_s1_1 + Real(s.m_b0)*x + vsa;
+        m_s1 = m_s2_1 + Real(s.m_b1)*x - Real(s.m_a1)*out;
+        m_s2 = Real(s.m_b2)*x - Real(s.m_a2)*out;
         m_s1_1 = m_s1;
         m_s2_1 = m_s2;
 
@@ -246,12 +277,15 @@ public:
     }
 
 private:
-    double m_s1;
-    double m_s1_1;
-    double m_s2;
-    double m_s2_1;
+    Real m_s1;
+    Real m_s1_1;
+    Real m_s2;
+    Real m_s2_1;
 };
 
+typedef BasicTransposedDirectFormII <double> TransposedDirectFormII;
+typedef BasicTransposedDirectFormII <float> TransposedDirectFormIIFloat;
+
 //------------------------------------------------------------------------------
 
 // Holds an array of states suitable for multi-channel processing
@@ -289,6 +323,14 @@ public:
             filter.process(numSamples, arrayOfChannels[i], m_state[i]);
     }
 
+    template <class Filter, typename Sample>
+    void processBlockMajor(int numSamples,
+                           Sample* const* arrayOfChannels,
+                           Filter& filter)
+    {
+        filter.processBlockMajor(numSamples, arrayOfChannels, m_state, Channels);
+    }
+
 private:
     StateType m_state[Channels];
 };
@@ -315,6 +357,14 @@ public:
     {
         throw std::logic_error("attempt to process empty ChannelState");
     }
+
+    template <class FilterDesign, typename Sample>
+    void processBlockMajor(int numSamples,
+                           Sample* const* arrayOfChannels,
+                           FilterDesign& filter)
+    {
+        throw std::logic_error("attempt to process empty ChannelState");
+    }
 };
 
 //------------------------------------------------------------------------------
@@ -27,6 +27,7 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainWindow.h"
 #include "UI/CustomLookAndFeel.h"
+#include "Processors/SignalChainBenchmark.h"
 
 #include <stdio.h>
 
@@ -75,6 +76,18 @@ public:
         customLookAndFeel = new CustomLookAndFeel();
         LookAndFeel::setDefaultLookAndFeel(customLookAndFeel);
 
+        if (parameters.contains("--benchmark",true))
+        {
+            // run the processors headlessly and exit without opening a window
+            SignalChainBenchmark benchmark;
+            benchmark.parseCommandLine(parameters);
+            if (! benchmark.run())
+                setApplicationReturnValue(1);
+
+            quit();
+            return;
+        }
+
         mainWindow = new MainWindow();
 
 
@@ -25,10 +25,55 @@
 #include "AudioNode.h"
 #include "Channel.h"
 
+// the FIFO holds this many device blocks
+#define FIFO_BLOCKS 8
+
+// output (re)starts once the FIFO holds this many device blocks
+#define PRIME_BLOCKS 2
+
+/**
+  Sets dest to the weighted sum of numSources input buffers.
+
+  Sources are combined four at a time, so the mix makes one pass over dest
+  per four channels instead of one per channel; the inner loop has no
+  dependencies between samples and is vectorised by the compiler.
+*/
+static void gainSum(float* dest, const float* const* sources, const float* gains,
+                    int numSources, int numSamples)
+{
+    FloatVectorOperations::clear(dest, numSamples);
+
+    int s = 0;
+
+    for (; s + 4 <= numSources; s += 4)
+    {
+        const float* a = sources[s];
+        const float* b = sources[s+1];
+        const float* c = sources[s+2];
+        const float* d = sources[s+3];
+
+        const float ga = gains[s];
+        const float gb = gains[s+1];
+        const float gc = gains[s+2];
+        const float gd = gains[s+3];
+
+        for (int i = 0; i < numSamples; i++)
+            dest[i] += (ga * a[i] + gb * b[i]) + (gc * c[i] + gd * d[i]);
+    }
+
+    for (; s < numSources; s++)
+        FloatVectorOperations::addWithMultiply(dest, sources[s], gains[s], numSamples);
+}
+
 AudioNode::AudioNode()
-    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), 
-    bufferA(2,10000),
-    bufferB(2,10000)
+    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f),
+      maxMixSources(0),
+      mixBuffer(1, 1024),
+      resampledBuffer(1, 1024),
+      fifo(1024),
+      deviceSampleRate(44100.0), deviceBlockSize(1024),
+      primeLevel(2048), isPrimed(false),
+      numUnderruns(0), numOverruns(0)
 {
 
     settings.numInputs = 2048;
@@ -39,10 +84,7 @@ AudioNode::AudioNode()
 
     nextAvailableChannel = 2; // keep first two channels empty
 
-    numSamplesExpected = 1024;
-
-    samplesInOverflowBuffer = 0;
-    samplesInBackupBuffer = 0;
+    fifoData.calloc(fifo.getTotalSize());
 
 }
 
@@ -71,9 +113,6 @@ void AudioNode::resetConnections()
 
     channelPointers.clear();
 
-    samplesInOverflowBuffer = 0;
-    samplesInBackupBuffer = 0;
-
 }
 
 void AudioNode::updateBufferSize()
@@ -159,199 +198,185 @@ void AudioNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
     std::cout << "Audio card sample rate: " << sampleRate_ << std::endl;
     std::cout << "Samples per block: " << estimatedSamplesPerBlock << std::endl;
 
-    numSamplesExpected = (int) (getSampleRate()/sampleRate_*float(estimatedSamplesPerBlock)) + 1; 
-    // processor sample rate divided by sound card sample rate
-
-    samplesInBackupBuffer = 0;
-    samplesInOverflowBuffer = 0;
-
-    bufferA.clear();
-    bufferB.clear();
+    deviceSampleRate = sampleRate_;
+    deviceBlockSize = jmax(1, estimatedSamplesPerBlock);
 
-    bufferSwap = false;
+    // the resampler and FIFO are set up in enable(), once the
+    // processor sample rate is known
 }
 
-void AudioNode::process(AudioSampleBuffer& buffer,
-                        MidiBuffer& midiMessages,
-                        int& nSamples)
+void AudioNode::allocateBuffers(int numSamples)
 {
-    float gain;
+    if (mixBuffer.getNumSamples() < numSamples)
+        mixBuffer.setSize(1, numSamples);
 
-    // clear the left and right channels
-    buffer.clear(0,0,buffer.getNumSamples());
-    buffer.clear(1,0,buffer.getNumSamples());
+    const int numResampled = resampler.getMaxOutputSamples(numSamples);
 
-    if (1)
-    {
+    if (resampledBuffer.getNumSamples() < numResampled)
+        resampledBuffer.setSize(1, numResampled);
+}
 
-        AudioSampleBuffer* overflowBuffer;
-        AudioSampleBuffer* backupBuffer;
+bool AudioNode::enable()
+{
+    resampler.setRates(getSampleRate(), deviceSampleRate, true);
+    resampler.prepare(1, jmax(deviceBlockSize, 1024));
 
-        if (!bufferSwap)
-        {
-            overflowBuffer = &bufferA;
-            backupBuffer = &bufferB;
-            bufferSwap = true;
-        } else {
-            overflowBuffer = &bufferB;
-            backupBuffer = &bufferA;
-            bufferSwap = false;
-        }
+    std::cout << "Audio monitor: " << getSampleRate() << " Hz -> "
+              << resampler.getOutputRate() << " Hz" << std::endl;
 
-        backupBuffer->clear();
-        
-        samplesInOverflowBuffer = samplesInBackupBuffer; // size of buffer after last round
-        samplesInBackupBuffer = 0;
+    allocateBuffers(jmax(deviceBlockSize, 1024));
 
-        int samplesToCopy = 0;
-        int orphanedSamples = 0;
+    maxMixSources = jmax(1, channelPointers.size());
+    mixSources.malloc(maxMixSources);
+    mixGains.malloc(maxMixSources);
 
-        if (channelPointers.size() > 0)
-        {
-            bool copiedBuffer = false;
+    fifo.setTotalSize(jmax(4096, FIFO_BLOCKS * deviceBlockSize));
+    fifoData.calloc(fifo.getTotalSize());
+    fifo.reset();
 
-            for (int i = 2; i < buffer.getNumChannels(); i++)
-            {
+    primeLevel = PRIME_BLOCKS * deviceBlockSize;
+    isPrimed = false;
 
-                if (channelPointers[i-2]->isMonitored)
-                {
+    numUnderruns = 0;
+    numOverruns = 0;
 
-                    if (!copiedBuffer)
-                    {
-                        // 1. copy overflow buffer
+    return true;
+}
 
-                        samplesToCopy = ((samplesInOverflowBuffer <= numSamplesExpected) ? 
-                                                  samplesInOverflowBuffer :
-                                                  numSamplesExpected);
+bool AudioNode::disable()
+{
+    std::cout << "Audio monitor: " << numUnderruns << " underruns, "
+              << numOverruns << " overruns." << std::endl;
 
-                      //  std::cout << " " << std::endl;
-                      //  std::cout << "Copying " << samplesToCopy << " samples from overflow buffer of " << samplesInOverflowBuffer << " samples." << std::endl;
+    return true;
+}
 
-                        if (samplesToCopy > 0)
-                        {
+void AudioNode::skipBlock(AudioSampleBuffer& buffer,
+                          MidiBuffer& midiMessages,
+                          int& nSamples)
+{
+    buffer.clear(0,0,buffer.getNumSamples());
+    buffer.clear(1,0,buffer.getNumSamples());
 
-                            buffer.addFrom(0,    // destination channel
-                               0,                // destination start sample
-                               *overflowBuffer,  // source
-                               0,                // source channel
-                               0,                // source start sample
-                               samplesToCopy,    // number of samples
-                               1.0f              // gain to apply
-                              );
+    // the buffered audio no longer lines up with the next block
+    fifo.reset();
+    resampler.reset();
+    isPrimed = false;
 
-                            buffer.addFrom(1,       // destination channel
-                               0,           // destination start sample
-                               *overflowBuffer,      // source
-                               1,           // source channel
-                               0,           // source start sample
-                               samplesToCopy, //  number of samples
-                               1.0f       // gain to apply
-                              );
+    nSamples = buffer.getNumSamples();
+}
 
+void AudioNode::writeToFifo(const float* data, int numSamples)
+{
+    const int capacity = fifo.getTotalSize() - 1;
 
-                            int leftoverSamples = samplesInOverflowBuffer - samplesToCopy;
+    if (numSamples > capacity)
+    {
+        data += numSamples - capacity;
+        numSamples = capacity;
+    }
 
-                       //     std::cout << "Samples remaining in overflow buffer: " << leftoverSamples << std::endl;
+    if (numSamples > fifo.getFreeSpace())
+    {
+        // the device is consuming more slowly than the data arrive; drop
+        // the oldest samples, bringing the latency back down to primeLevel
+        const int target = jmax(0, primeLevel - numSamples);
+        const int numToDrop = jmax(fifo.getNumReady() - target, numSamples - fifo.getFreeSpace());
 
-                            if (leftoverSamples > 0)
-                            {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numToDrop, start1, size1, start2, size2);
+        fifo.finishedRead(size1 + size2);
 
-                                // move remaining samples to the backup buffer
+        numOverruns++;
+    }
 
-                                 backupBuffer->addFrom(0, // destination channel
-                                   0,                     // destination start sample
-                                   *overflowBuffer,       // source
-                                   0,                     // source channel
-                                   samplesToCopy,         // source start sample
-                                   leftoverSamples,       // number of samples
-                                   1.0f                   // gain to apply
-                                  );
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
 
-                                backupBuffer->addFrom(1,  // destination channel
-                                   0,                     // destination start sample
-                                   *overflowBuffer,        // source
-                                   1,                     // source channel
-                                   samplesToCopy,         // source start sample
-                                   leftoverSamples,       // number of samples
-                                   1.0f                   // gain to apply
-                                  );
+    FloatVectorOperations::copy(fifoData + start1, data, size1);
+    FloatVectorOperations::copy(fifoData + start2, data + size1, size2);
 
-                            }
+    fifo.finishedWrite(size1 + size2);
+}
 
-                            samplesInBackupBuffer = leftoverSamples;
+void AudioNode::readFromFifo(AudioSampleBuffer& buffer, int numSamples)
+{
+    if (!isPrimed)
+    {
+        if (fifo.getNumReady() < primeLevel)
+            return; // outputs are already silent
 
-                        }
+        isPrimed = true;
+    }
 
-                        copiedBuffer = true;
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamples, start1, size1, start2, size2);
 
-                    } // copying buffer
+    float* left = buffer.getSampleData(0);
 
-                    gain = volume/(float(0x7fff) * channelPointers[i-2]->bitVolts);
+    FloatVectorOperations::copy(left, fifoData + start1, size1);
+    FloatVectorOperations::copy(left + size1, fifoData + start2, size2);
 
-                    int remainingSamples = numSamplesExpected - samplesToCopy;
+    fifo.finishedRead(size1 + size2);
 
-                  //  std::cout << "Copying " << remainingSamples << " samples from incoming buffer of " << nSamples << " samples." << std::endl;
+    if (size1 + size2 < numSamples)
+    {
+        // ran dry: the rest of the block stays silent, and output waits
+        // until the FIFO has been primed again
+        numUnderruns++;
+        isPrimed = false;
+    }
 
-                    int samplesToCopy2 = ((remainingSamples <= nSamples) ? 
-                                                  remainingSamples :
-                                                  nSamples);
+    buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
+}
 
-                    if (samplesToCopy2 > 0)
-                    {
+void AudioNode::process(AudioSampleBuffer& buffer,
+                        MidiBuffer& midiMessages,
+                        int& nSamples)
+{
+    const int numOutputSamples = buffer.getNumSamples();
 
-                        buffer.addFrom(0,       // destination channel
-                                   samplesToCopy,           // destination start sample
-                                   buffer,      // source
-                                   i,           // source channel
-                                   0,           // source start sample
-                                   remainingSamples, //  number of samples
-                                   gain       // gain to apply
-                                  );
+    // clear the left and right channels
+    buffer.clear(0,0,numOutputSamples);
+    buffer.clear(1,0,numOutputSamples);
 
-                        buffer.addFrom(1,       // destination channel
-                                   samplesToCopy,           // destination start sample
-                                   buffer,      // source
-                                   i,           // source channel
-                                   0,           // source start sample
-                                   remainingSamples, //  number of samples
-                                   gain       // gain to apply
-                                  );
-                    }
+    // gather the monitored channels and their gains
+    int numSources = 0;
 
-                    orphanedSamples = nSamples - samplesToCopy2;
+    const int numChannels = jmin(buffer.getNumChannels() - 2, channelPointers.size(), maxMixSources);
 
-                   // std::cout << "Samples remaining in incoming buffer: " << orphanedSamples << std::endl;
+    for (int i = 0; i < numChannels; i++)
+    {
+        Channel* ch = channelPointers.getUnchecked(i);
 
+        if (ch->isMonitored)
+        {
+            mixSources[numSources] = buffer.getSampleData(i + 2);
+            mixGains[numSources] = volume/(float(0x7fff) * ch->bitVolts);
+            numSources++;
+        }
+    }
 
-                    if (orphanedSamples > 0)
-                    {
-                          backupBuffer->addFrom(0,       // destination channel
-                                   samplesInBackupBuffer,           // destination start sample
-                                   buffer,      // source
-                                   i,           // source channel
-                                   remainingSamples,           // source start sample
-                                   orphanedSamples, //  number of samples
-                                   gain       // gain to apply
-                                  );
+    if (numSources > 0 && nSamples > 0)
+    {
+        allocateBuffers(nSamples);
 
-                        backupBuffer->addFrom(0,       // destination channel
-                                   samplesInBackupBuffer,           // destination start sample
-                                   buffer,      // source
-                                   i,           // source channel
-                                   remainingSamples,           // source start sample
-                                   orphanedSamples, //  number of samples
-                                   gain       // gain to apply
-                                  );
+        gainSum(mixBuffer.getSampleData(0), mixSources, mixGains, numSources, nSamples);
 
-                    }
+        const int numResampled = resampler.process(mixBuffer, nSamples, resampledBuffer);
 
-                }
-            }
+        writeToFifo(resampledBuffer.getSampleData(0), numResampled);
+    }
+    else if (numSources == 0)
+    {
+        // nothing to monitor: start from a clean state when monitoring resumes
+        fifo.reset();
+        resampler.reset();
+        isPrimed = false;
+    }
 
-        }
+    readFromFifo(buffer, numOutputSamples);
 
-        samplesInBackupBuffer += orphanedSamples;
-        nSamples = numSamplesExpected;
-   
-    }
+    // already at the device rate, so the AudioResamplingNode passes it through
+    nSamples = numOutputSamples;
 }
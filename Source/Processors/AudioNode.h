@@ -32,6 +32,7 @@
 #include "Editors/AudioEditor.h"
 
 #include "Channel.h"
+#include "PolyphaseResampler.h"
 
 class AudioEditor;
 
@@ -53,7 +54,16 @@ class AudioEditor;
   control the channels going to the audio monitor; it all happens in a distributed
   way through the individual processors.
 
-  @see GenericProcessor, AudioEditor
+  Each block, the monitored channels are summed once into a mono mix (four
+  channels per pass), converted to the audio device's sample rate with a
+  band-limited PolyphaseResampler, and written to a single-producer,
+  single-consumer FIFO (an AbstractFifo). Exactly one device block is read back
+  from the FIFO into the left and right outputs, so the AudioResamplingNode
+  downstream passes it through unchanged. The FIFO absorbs the difference
+  between the number of data samples per block and the fixed device block;
+  underruns and overruns are counted and printed when acquisition stops.
+
+  @see GenericProcessor, AudioEditor, PolyphaseResampler
 
 */
 
@@ -69,6 +79,15 @@ public:
     */
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
 
+    /** Outputs silence for a block skipped by the DeadlineMonitor. */
+    void skipBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
+    /** Audio monitoring can drop out when the callback runs late. */
+    int getPriorityClass()
+    {
+        return BEST_EFFORT_PRIORITY;
+    }
+
     /** Used to change audio monitoring parameters (such as channels to monitor and volume) while acquisition is active.
     */
     void setParameter(int parameterIndex, float newValue);
@@ -98,8 +117,36 @@ public:
 
     void prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock);
 
+    /** Sets up the resampler and empties the FIFO before acquisition starts. */
+    bool enable();
+
+    /** Prints the FIFO statistics. */
+    bool disable();
+
+    /** Returns the number of device blocks that could not be filled from the FIFO. */
+    int getNumUnderruns() const
+    {
+        return numUnderruns;
+    }
+
+    /** Returns the number of times samples were dropped because the FIFO was full. */
+    int getNumOverruns() const
+    {
+        return numOverruns;
+    }
+
 private:
 
+    /** Makes sure the scratch buffers can hold a block of numSamples. */
+    void allocateBuffers(int numSamples);
+
+    /** Writes resampled audio to the FIFO, dropping the oldest samples
+        if there is not enough room. */
+    void writeToFifo(const float* data, int numSamples);
+
+    /** Reads one device block from the FIFO into the left and right outputs. */
+    void readFromFifo(AudioSampleBuffer& buffer, int numSamples);
+
     Array<int> leftChan;
     Array<int> rightChan;
     float volume;
@@ -107,15 +154,28 @@ private:
     /** An array of pointers to the channels that feed into the AudioNode. */
     Array<Channel*> channelPointers;
 
-    AudioSampleBuffer bufferA;
-    AudioSampleBuffer bufferB;
+    /** Sources and gains of the monitored channels, gathered every block. */
+    HeapBlock<const float*> mixSources;
+    HeapBlock<float> mixGains;
+    int maxMixSources;
+
+    AudioSampleBuffer mixBuffer;
+    AudioSampleBuffer resampledBuffer;
+
+    PolyphaseResampler resampler;
+
+    AbstractFifo fifo;
+    HeapBlock<float> fifoData;
 
-    int numSamplesExpected;
+    double deviceSampleRate;
+    int deviceBlockSize;
 
-    int samplesInBackupBuffer;
-    int samplesInOverflowBuffer;
+    /** Number of samples the FIFO must hold before output (re)starts. */
+    int primeLevel;
+    bool isPrimed;
 
-    bool bufferSwap;
+    int numUnderruns;
+    int numOverruns;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioNode);
 
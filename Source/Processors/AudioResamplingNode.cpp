@@ -147,6 +147,12 @@ void AudioResamplingNode::process(AudioSampleBuffer& buffer,
     int nSamps = nSamples;
     int valuesNeeded;
 
+    if (destBufferIsTempBuffer && nSamps == buffer.getNumSamples())
+    {
+        // already at the device rate (the AudioNode resamples its own mix)
+        return;
+    }
+
     if (destBufferIsTempBuffer)
     {
         ratio = float(nSamps) / float(buffer.getNumSamples());
@@ -41,6 +41,9 @@
   inputs that do not provide the same amount of samples in each buffer. At the
   moment, the resampling process shifts the pitch of the incoming signal.
 
+  The AudioNode now delivers exactly one device block at the device rate,
+  in which case the buffer is passed through untouched.
+
   @see GenericProcessor
 
 */
@@ -65,8 +65,15 @@ AudioProcessorEditor* ChannelMappingNode::createEditor()
 void ChannelMappingNode::updateSettings()
 {
 	if (getNumInputs() > 0)
+	{
 		channelBuffer.setSize(getNumInputs(), 10000);
 
+		// the remap plan is rebuilt every block, so keep it from allocating
+		mapSource.ensureStorageAllocated(getNumInputs());
+		mapReference.ensureStorageAllocated(getNumInputs());
+		saveChannel.ensureStorageAllocated(getNumInputs());
+	}
+
 	if (getNumInputs() != previousChannelCount)
 	{
 		previousChannelCount = getNumInputs();
@@ -113,57 +120,131 @@ void ChannelMappingNode::setParameter(int parameterIndex, float newValue)
 
 }
 
+void ChannelMappingNode::buildMap(int numBufferChannels)
+{
+	const int numChannels = jmin(numBufferChannels, channelArray.size());
+
+	mapSource.clearQuick();
+	mapReference.clearQuick();
+
+	for (int i = 0; i < numChannels; i++)
+	{
+		int realChan = channelArray[i];
+
+		if (realChan < 0 || realChan >= numBufferChannels || !enabledChannelArray[realChan])
+			continue;
+
+		int ref = -1;
+
+		if ((referenceArray[realChan] > -1) && referenceChannels[referenceArray[realChan]] > -1)
+			ref = referenceChannels[referenceArray[realChan]];
+
+		if (ref >= numBufferChannels)
+			ref = -1;
+
+		mapSource.add(realChan);
+		mapReference.add(ref);
+	}
+}
+
+bool ChannelMappingNode::getChannelPermutation(int numChannels, Array<int>& sourceChannels)
+{
+	buildMap(jmin(numChannels, channelBuffer.getNumChannels()));
+
+	for (int j = 0; j < mapReference.size(); j++)
+	{
+		if (mapReference.getUnchecked(j) > -1)
+			return false; // referencing needs arithmetic
+	}
+
+	sourceChannels.clearQuick();
+	sourceChannels.addArray(mapSource);
+
+	// outputs past the mapped channels are silent
+	while (sourceChannels.size() < numChannels)
+		sourceChannels.add(-1);
+
+	return true;
+}
+
 void ChannelMappingNode::process(AudioSampleBuffer& buffer,
 								 MidiBuffer& midiMessages,
 								 int& nSamples)
 {
-	int j=0;
+	// the ParallelGraphRenderer has already reordered the channel pointers
+	if (channelsPermuted)
+		return;
 
-	// use copy constructor to set the data to refer to
-	channelBuffer = buffer;
+	// everything below was sized in updateSettings(), so nothing allocates here
+	const int numChannels = jmin(buffer.getNumChannels(), channelBuffer.getNumChannels());
 
-	// copy it back into the buffer according to the channel mapping
-	buffer.clear();
+	jassert(nSamples <= channelBuffer.getNumSamples());
+
+	// work out where each output channel comes from
+	buildMap(numChannels);
 
-	for (int i = 0; i < buffer.getNumChannels(); i++)
+	const int numOutputs = mapSource.size();
+
+	saveChannel.clearQuick();
+	saveChannel.insertMultiple(0, false, numChannels);
+
+	// output j overwrites channel j in place, so a channel only needs to be
+	// saved if it is read again after that
+	for (int j = 0; j < numOutputs; j++)
+	{
+		const int src = mapSource.getUnchecked(j);
+		const int ref = mapReference.getUnchecked(j);
+
+		if (src < j)
+			saveChannel.set(src, true);
+
+		if (ref > -1 && (ref < j || (ref == j && src != j)))
+			saveChannel.set(ref, true);
+	}
+
+	for (int c = 0; c < numOutputs; c++)
 	{
-		if (enabledChannelArray[channelArray[i]])
+		if (saveChannel.getUnchecked(c))
+			channelBuffer.copyFrom(c, 0, buffer, c, 0, nSamples);
+	}
+
+	// copy it back into the buffer according to the channel mapping
+	for (int j = 0; j < numOutputs; j++)
+	{
+		const int src = mapSource.getUnchecked(j);
+		const int ref = mapReference.getUnchecked(j);
+
+		if (src != j)
 		{
-			buffer.addFrom(j, // destChannel
+			const AudioSampleBuffer& source = saveChannel[src] ? channelBuffer : buffer;
+
+			buffer.copyFrom(j, // destChannel
 				0, // destStartSample
-				channelBuffer, // source
-				channelArray[i], // sourceChannel
+				source, // source
+				src, // sourceChannel
 				0, // sourceStartSample
-				nSamples, // numSamples
-				1.0f // gain to apply to source (positive for original signal)
+				nSamples // numSamples
 				);
-			j++;
 		}
 
-	}
-
-	j=0;
-	// now do the referencing
-	for (int i = 0; i < buffer.getNumChannels(); i++)
-	{
-		int realChan = channelArray[i];
-		if (enabledChannelArray[realChan])
+		// now do the referencing
+		if (ref > -1)
 		{
-			if ((referenceArray[realChan] > -1) && referenceChannels[referenceArray[realChan]] > -1)
-			{
+			const AudioSampleBuffer& source = saveChannel[ref] ? channelBuffer : buffer;
 
-				buffer.addFrom(j, // destChannel
-					0, // destStartSample
-					channelBuffer, // source
-					referenceChannels[referenceArray[realChan]], // sourceChannel
-					0, // sourceStartSample
-					nSamples, // numSamples
-					-1.0f // gain to apply to source (negative for reference)
-					);
-			}
-			j++;
+			buffer.addFrom(j, // destChannel
+				0, // destStartSample
+				source, // source
+				ref, // sourceChannel
+				0, // sourceStartSample
+				nSamples, // numSamples
+				-1.0f // gain to apply to source (negative for reference)
+				);
 		}
 	}
 
+	for (int c = numOutputs; c < buffer.getNumChannels(); c++)
+		buffer.clear(c, 0, nSamples);
+
 }
 
@@ -62,8 +62,16 @@ public:
 
     void updateSettings();
 
+    /** A mapping without referencing is a pure reordering, which the
+        ParallelGraphRenderer can apply by permuting channel pointers. */
+    bool getChannelPermutation(int numChannels, Array<int>& sourceChannels);
+
 private:
 
+    /** Works out the source and reference of every output channel, for a
+        buffer with numBufferChannels channels. */
+    void buildMap(int numBufferChannels);
+
     Array<int> referenceArray;
 	Array<int> referenceChannels;
     Array<int> channelArray;
@@ -71,8 +79,14 @@ private:
 
 	int previousChannelCount;
 
+    /** Scratch rows for channels that are read after they have been
+        overwritten by the in-place remap. */
     AudioSampleBuffer channelBuffer;
 
+    Array<int> mapSource;
+    Array<int> mapReference;
+    Array<bool> saveChannel;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelMappingNode);
 
 };
@@ -0,0 +1,82 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DeadlineMonitor.h"
+
+DeadlineMonitor::DeadlineMonitor()
+    : enabled(false), budgetFraction(0.8), blockStartTicks(0), periodTicks(0)
+{
+    clear();
+}
+
+DeadlineMonitor::~DeadlineMonitor()
+{
+
+}
+
+void DeadlineMonitor::clear()
+{
+    // nothing is late until the first callback sets a deadline
+    deadlineTicks = std::numeric_limits<int64>::max();
+    blockDegraded = 0;
+
+    numBlocks = 0;
+    numDegradedBlocks = 0;
+    numOverruns = 0;
+    numSkipped = 0;
+    numHighPriorityLate = 0;
+}
+
+void DeadlineMonitor::beginBlock(int numSamples, double sampleRate)
+{
+    blockStartTicks = Time::getHighResolutionTicks();
+
+    if (sampleRate > 0)
+        periodTicks = Time::secondsToHighResolutionTicks(double(numSamples) / sampleRate);
+    else
+        periodTicks = std::numeric_limits<int64>::max() / 2;
+
+    deadlineTicks = blockStartTicks + int64(double(periodTicks) * budgetFraction);
+    blockDegraded = 0;
+
+    ++numBlocks;
+}
+
+void DeadlineMonitor::endBlock()
+{
+    if (Time::getHighResolutionTicks() - blockStartTicks > periodTicks)
+        ++numOverruns;
+
+    if (blockDegraded.get() != 0)
+        ++numDegradedBlocks;
+}
+
+void DeadlineMonitor::printReport()
+{
+    std::cout << "Deadline report: " << numBlocks.get() << " callbacks, "
+              << numOverruns.get() << " over budget, "
+              << numDegradedBlocks.get() << " with best-effort work skipped ("
+              << numSkipped.get() << " processor blocks), "
+              << numHighPriorityLate.get() << " high-priority blocks finished late."
+              << std::endl;
+}
@@ -0,0 +1,166 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __DEADLINEMONITOR_H_7C2E15B9__
+#define __DEADLINEMONITOR_H_7C2E15B9__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Keeps each callback within its real-time budget by shedding work that
+  can be lost without harm.
+
+  Every processor belongs to one of three priority classes (see
+  GenericProcessor::getPriorityClass()):
+
+  - critical: sources and the RecordNode, which must see every sample.
+  - high: everything between them, including closed-loop outputs.
+  - best-effort: displays and the AudioNode.
+
+  While the monitor is enabled (View > Deadline scheduler), the
+  ProcessorGraph stamps the start of every callback and computes a
+  deadline from the block size and a fraction of the callback period.
+  Once that deadline has passed, best-effort processors skip the rest of
+  the block (their display or audio drops out for one block); critical
+  and high-priority processors always run, so recording stays gap-free.
+
+  The counters are Atomic, so they can be read from the message thread
+  while acquisition is running. A summary is printed when it stops.
+
+  @see GenericProcessor, ProcessorGraph, ProcessorProfile
+
+*/
+
+class DeadlineMonitor
+{
+public:
+
+    DeadlineMonitor();
+    ~DeadlineMonitor();
+
+    /** Turns the deadline check on or off. Takes effect at the start of the
+        next acquisition. */
+    void setEnabled(bool t)
+    {
+        enabled = t;
+    }
+
+    /** Returns true if best-effort work will be skipped in late blocks. */
+    bool isEnabled()
+    {
+        return enabled;
+    }
+
+    /** Sets the part of the callback period (0-1) that may be used before
+        best-effort work is skipped. The rest is headroom for the driver. */
+    void setBudgetFraction(double fraction)
+    {
+        budgetFraction = jlimit(0.1, 1.0, fraction);
+    }
+
+    /** Clears all counters; called before acquisition starts. */
+    void clear();
+
+    /** Called by the ProcessorGraph at the start of each callback. */
+    void beginBlock(int numSamples, double sampleRate);
+
+    /** Called by the ProcessorGraph once every node has been processed. */
+    void endBlock();
+
+    /** Returns true if the deadline of the current block has passed. Safe to
+        call from several threads. */
+    bool isLate() const
+    {
+        return Time::getHighResolutionTicks() > deadlineTicks.get();
+    }
+
+    /** Called by a best-effort processor that skipped its work. */
+    void workSkipped()
+    {
+        ++numSkipped;
+        blockDegraded = 1;
+    }
+
+    /** Called by a high-priority processor that finished after the deadline. */
+    void finishedLate()
+    {
+        ++numHighPriorityLate;
+    }
+
+    /** Returns the number of callbacks since acquisition started. */
+    int64 getNumBlocks() const
+    {
+        return numBlocks.get();
+    }
+
+    /** Returns the number of callbacks in which best-effort work was skipped. */
+    int64 getNumDegradedBlocks() const
+    {
+        return numDegradedBlocks.get();
+    }
+
+    /** Returns the number of callbacks that took longer than the whole period. */
+    int64 getNumOverruns() const
+    {
+        return numOverruns.get();
+    }
+
+    /** Returns the number of processBlock() calls that were skipped. */
+    int64 getNumSkipped() const
+    {
+        return numSkipped.get();
+    }
+
+    /** Returns the number of high-priority blocks finished after the deadline. */
+    int64 getNumHighPriorityLate() const
+    {
+        return numHighPriorityLate.get();
+    }
+
+    /** Prints a summary of the counters to the console. */
+    void printReport();
+
+private:
+
+    bool enabled;
+    double budgetFraction;
+
+    int64 blockStartTicks;
+    int64 periodTicks;
+    Atomic<int64> deadlineTicks;
+
+    Atomic<int> blockDegraded;
+
+    Atomic<int64> numBlocks;
+    Atomic<int64> numDegradedBlocks;
+    Atomic<int64> numOverruns;
+    Atomic<int64> numSkipped;
+    Atomic<int64> numHighPriorityLate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeadlineMonitor);
+
+};
+
+
+#endif  // __DEADLINEMONITOR_H_7C2E15B9__
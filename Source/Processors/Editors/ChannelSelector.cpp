@@ -29,7 +29,10 @@
 #include "../ProcessorGraph.h"
 
 ChannelSelector::ChannelSelector(bool createButtons, Font& titleFont_) :
-    eventsOnly(false), paramsToggled(true), paramsActive(true),
+    eventsOnly(false),
+    numChannels(0), anchorChannel(-1), lastDragChannel(-1), dragState(false),
+    hoverChannel(-1), hoverType(PARAMETER),
+    paramsToggled(true), paramsActive(true),
     radioStatus(false), isNotSink(createButtons), moveRight(false),
     moveLeft(false), offsetLR(0), offsetUD(0), desiredOffset(0),
     titleFont(titleFont_), acquisitionIsActive(false)
@@ -54,16 +57,11 @@ ChannelSelector::ChannelSelector(bool createButtons, Font& titleFont_) :
 
     paramsButton->setToggleState(true, false);
 
-    audioButtons.clear();
-    recordButtons.clear();
-
     // set button layout parameters
     parameterOffset = 0;
     recordOffset = getDesiredWidth();
     audioOffset = getDesiredWidth()*2;
 
-    parameterButtons.clear();
-
     allButton = new EditorButton("all", titleFont);
     allButton->addListener(this);
     addAndMakeVisible(allButton);
@@ -110,25 +108,26 @@ void ChannelSelector::paint(Graphics& g)
 void ChannelSelector::setNumChannels(int numChans)
 {
 
-    int difference = numChans - parameterButtons.size();
-
-    std::cout << difference << " buttons needed." << std::endl;
-
-    if (difference > 0)
+    if (numChans > numChannels)
     {
-        for (int n = 0; n < difference; n++)
-        {
-            addButton();
-        }
+        // new channels start out with the default parameter selection
+        paramStates.setRange(numChannels, numChans - numChannels, paramsToggled && !radioStatus);
     }
-    else if (difference < 0)
+    else if (numChans < numChannels)
     {
-        for (int n = 0; n < -difference; n++)
-        {
-            removeButton();
-        }
+        paramStates.setRange(numChans, numChannels - numChans, false);
+        recordStates.setRange(numChans, numChannels - numChans, false);
+        audioStates.setRange(numChans, numChannels - numChans, false);
     }
 
+    numChannels = numChans;
+
+    if (anchorChannel >= numChannels)
+        anchorChannel = -1;
+
+    if (hoverChannel >= numChannels)
+        hoverChannel = -1;
+
     refreshButtonBoundaries();
 
 }
@@ -136,14 +135,13 @@ void ChannelSelector::setNumChannels(int numChans)
 void ChannelSelector::shiftChannelsVertical(float amount)
 {
 
-    if (parameterButtons.size() > 32)
-    {
-        offsetUD -= amount*10;
-        offsetUD = jmin(offsetUD, 0.0f);
-        offsetUD = jmax(offsetUD, float(parameterButtons.size())/8*-10.68f);
-    }
+    // scroll until the last row reaches the bottom of the region
+    const int numRows = (numChannels + numColumns - 1) / numColumns;
+    const float minOffset = jmin(0.0f, float(channelSelectorRegion->getHeight() - numRows*rowHeight));
 
-    std::cout << "offsetUD = " << offsetUD << std::endl;
+    offsetUD -= amount*10;
+    offsetUD = jmin(offsetUD, 0.0f);
+    offsetUD = jmax(offsetUD, minOffset);
 
     refreshButtonBoundaries();
 
@@ -154,33 +152,6 @@ void ChannelSelector::refreshButtonBoundaries()
 
     channelSelectorRegion->setBounds(0,20,getWidth(),getHeight()-35);
 
-    int nColumns = 8;
-    int columnWidth = getDesiredWidth()/(nColumns + 1);
-    int rowHeight = 14;
-
-    for (int i = 0; i < parameterButtons.size(); i++)
-    {
-
-        parameterButtons[i]->setBounds(columnWidth/2 + offsetLR +
-                                       columnWidth*((i)%nColumns),
-                                       floor(double(i)/nColumns)*rowHeight+(int) offsetUD,
-                                       columnWidth, rowHeight);
-
-        if (isNotSink)
-        {
-            recordButtons[i]->setBounds(columnWidth/2 + offsetLR +
-                                        columnWidth*((i)%nColumns) - getDesiredWidth(),
-                                        floor(double(i)/nColumns)*rowHeight+(int) offsetUD,
-                                        columnWidth, rowHeight);
-            audioButtons[i]->setBounds(columnWidth/2 + offsetLR +
-                                       columnWidth*((i)%nColumns) -
-                                       getDesiredWidth()*2,
-                                       floor(double(i)/nColumns)*rowHeight+(int) offsetUD,
-                                       columnWidth, rowHeight);
-        }
-
-    }
-
     int w = getWidth()/3;
     int h = 15;
 
@@ -191,6 +162,9 @@ void ChannelSelector::refreshButtonBoundaries()
     allButton->setBounds(0, getHeight()-15, getWidth()/2, 15);
     noneButton->setBounds(getWidth()/2, getHeight()-15, getWidth()/2, 15);
 
+    // the channels themselves are drawn on demand
+    channelSelectorRegion->repaint();
+
 }
 
 void ChannelSelector::resized()
@@ -226,56 +200,248 @@ void ChannelSelector::timerCallback()
 
 }
 
-void ChannelSelector::addButton()
+int ChannelSelector::getColumnWidth()
 {
+    return getDesiredWidth()/(numColumns + 1);
+}
 
-    int size = parameterButtons.size();
+int ChannelSelector::getTabOffset(int type)
+{
+    if (type == RECORD)
+        return recordOffset;
+    else if (type == AUDIO)
+        return audioOffset;
+    else
+        return parameterOffset;
+}
 
-    ChannelSelectorButton* b = new ChannelSelectorButton(size+1, PARAMETER, titleFont);
-    parameterButtons.add(b);
-    channelSelectorRegion->addAndMakeVisible(b);
+BigInteger& ChannelSelector::getStates(int type)
+{
+    if (type == RECORD)
+        return recordStates;
+    else if (type == AUDIO)
+        return audioStates;
+    else
+        return paramStates;
+}
+
+void ChannelSelector::paintChannels(Graphics& g, int width, int height)
+{
+    const int columnWidth = getColumnWidth();
+
+    // only the rows that intersect the region are drawn
+    const int firstRow = jmax(0, int(floor(-offsetUD / rowHeight)));
+    const int lastRow = int(ceil((height - offsetUD) / rowHeight));
+
+    Font cellFont = titleFont;
+    cellFont.setHeight(10);
+    g.setFont(cellFont);
+
+    const int types[] = {PARAMETER, RECORD, AUDIO};
 
-    if (paramsToggled)
-        b->setToggleState(true, false);
+    for (int t = 0; t < 3; t++)
+    {
+        const int type = types[t];
+
+        if (type != PARAMETER && !isNotSink)
+            continue;
+
+        const int panelX = columnWidth/2 + offsetLR - getTabOffset(type);
+
+        if (panelX + numColumns*columnWidth < 0 || panelX > width)
+            continue;
+
+        const BigInteger& states = getStates(type);
+        const bool isActive = (type != PARAMETER || paramsActive);
+
+        for (int row = firstRow; row <= lastRow; row++)
+        {
+            for (int col = 0; col < numColumns; col++)
+            {
+                const int chan = row*numColumns + col;
+
+                if (chan >= numChannels)
+                    break;
+
+                if (isActive)
+                {
+                    if (states[chan])
+                        g.setColour(Colours::orange);
+                    else
+                        g.setColour(Colours::darkgrey);
+
+                    if (chan == hoverChannel && type == hoverType)
+                        g.setColour(Colours::white);
+                }
+                else
+                {
+                    if (states[chan])
+                        g.setColour(Colours::yellow);
+                    else
+                        g.setColour(Colours::lightgrey);
+                }
+
+                g.drawText(String(chan + 1),
+                           panelX + col*columnWidth, row*rowHeight + (int) offsetUD,
+                           columnWidth, rowHeight,
+                           Justification::centred, true);
+            }
+        }
+    }
+}
+
+int ChannelSelector::getChannelAt(int x, int y, int& type)
+{
+    type = PARAMETER;
+
+    // no hit-testing while the tabs are sliding
+    if (offsetLR == parameterOffset)
+        type = PARAMETER;
+    else if (offsetLR == recordOffset && isNotSink)
+        type = RECORD;
+    else if (offsetLR == audioOffset && isNotSink)
+        type = AUDIO;
     else
-        b->setToggleState(false, false);
+        return -1;
 
-    if (!paramsActive)
-        b->setActive(false);
 
-    b->addListener(this);
+    const int columnWidth = getColumnWidth();
+    const int relX = x - columnWidth/2;
+    const int relY = y - (int) offsetUD;
 
-    if (isNotSink)
+    if (relX < 0 || relY < 0)
+        return -1;
+
+    const int col = relX / columnWidth;
+    const int row = relY / rowHeight;
+
+    if (col >= numColumns)
+        return -1;
+
+    const int chan = row*numColumns + col;
+
+    return chan < numChannels ? chan : -1;
+}
+
+bool ChannelSelector::setChannelState(int type, int chan, bool status)
+{
+    BigInteger& states = getStates(type);
+
+    if (states[chan] == status)
+        return false;
+
+    states.setBit(chan, status);
+
+    if (type == AUDIO)
+    {
+        // get audio node, and inform it of the change
+        GenericEditor* editor = (GenericEditor*) getParentComponent();
+
+        Channel* ch = editor->getChannel(chan);
+
+        if (ch == nullptr)
+            return true;
+
+        if (acquisitionIsActive) // use setParameter to change parameter safely
+        {
+            editor->getProcessorGraph()->
+            getAudioNode()->
+            setChannelStatus(ch, status);
+        }
+        else     // change parameter directly
+        {
+            ch->isMonitored = status;
+        }
+    }
+    else if (type == RECORD)
     {
-        ChannelSelectorButton* br = new ChannelSelectorButton(size+1, RECORD, titleFont);
-        recordButtons.add(br);
-        channelSelectorRegion->addAndMakeVisible(br);
-        br->addListener(this);
+        // get record node, and inform it of the change
+        GenericEditor* editor = (GenericEditor*) getParentComponent();
+
+        Channel* ch = editor->getChannel(chan);
+
+        if (ch == nullptr)
+            return true;
 
-        ChannelSelectorButton* ba = new ChannelSelectorButton(size+1, AUDIO, titleFont);
-        audioButtons.add(ba);
-        channelSelectorRegion->addAndMakeVisible(ba);
-        ba->addListener(this);
+        if (acquisitionIsActive) // use setParameter to change parameter safely
+        {
+            editor->getProcessorGraph()->
+            getRecordNode()->
+            setChannelStatus(ch, status);
+        }
+        else     // change parameter directly
+        {
+            ch->setRecordState(status);
+        }
     }
+
+    return true;
 }
 
-void ChannelSelector::removeButton()
+void ChannelSelector::setChannelRange(int type, int first, int last, bool status)
 {
-    int size = parameterButtons.size();
+    for (int chan = jmin(first, last); chan <= jmax(first, last); chan++)
+        setChannelState(type, chan, status);
+}
 
-    ChannelSelectorButton* b = parameterButtons.remove(size-1);
-    channelSelectorRegion->removeChildComponent(b);
-    deleteAndZero(b);
+void ChannelSelector::channelClicked(int type, int chan, bool extendSelection)
+{
+    if (type == PARAMETER && !paramsActive)
+        return;
 
-    if (isNotSink)
+    if (type == PARAMETER && radioStatus)
     {
-        ChannelSelectorButton* br = recordButtons.remove(size-1);
-        channelSelectorRegion->removeChildComponent(br);
-        deleteAndZero(br);
+        // radio buttons: exactly one channel is selected
+        paramStates.clear();
+        paramStates.setBit(chan);
+        anchorChannel = chan;
+        lastDragChannel = -1;
+
+        GenericEditor* editor = (GenericEditor*) getParentComponent();
+        editor->channelChanged(chan + 1);
+    }
+    else if (extendSelection && anchorChannel >= 0)
+    {
+        // shift-click: give the whole range the state of the anchor
+        dragState = getStates(type)[anchorChannel];
+        setChannelRange(type, anchorChannel, chan, dragState);
+        lastDragChannel = chan;
+    }
+    else
+    {
+        dragState = !getStates(type)[chan];
+        setChannelState(type, chan, dragState);
+        anchorChannel = chan;
+        lastDragChannel = chan;
+    }
+
+    channelSelectorRegion->repaint();
+    refreshParameterColors();
+}
+
+void ChannelSelector::channelDragged(int type, int chan)
+{
+    if (lastDragChannel < 0 || chan == lastDragChannel)
+        return;
+
+    if (type == PARAMETER && (!paramsActive || radioStatus))
+        return;
+
+    // dragging paints the state chosen on mouse-down
+    setChannelRange(type, lastDragChannel, chan, dragState);
+    lastDragChannel = chan;
 
-        ChannelSelectorButton* ba = audioButtons.remove(size-1);
-        channelSelectorRegion->removeChildComponent(ba);
-        deleteAndZero(ba);
+    channelSelectorRegion->repaint();
+    refreshParameterColors();
+}
+
+void ChannelSelector::setHoverChannel(int type, int chan)
+{
+    if (chan != hoverChannel || type != hoverType)
+    {
+        hoverChannel = chan;
+        hoverType = type;
+        channelSelectorRegion->repaint();
     }
 }
 
@@ -285,10 +451,10 @@ Array<int> ChannelSelector::getActiveChannels()
 
     if (!eventsOnly)
     {
-        for (int i = 0; i < parameterButtons.size(); i++)
+        for (int i = paramStates.findNextSetBit(0); i >= 0 && i < numChannels;
+             i = paramStates.findNextSetBit(i + 1))
         {
-            if (parameterButtons[i]->getToggleState())
-                a.add(i);
+            a.add(i);
         }
     }
     else
@@ -302,17 +468,15 @@ Array<int> ChannelSelector::getActiveChannels()
 void ChannelSelector::setActiveChannels(Array<int> a)
 {
 
-    std::cout << "Setting active channels!" << std::endl;
-
-    for (int i = 0; i < parameterButtons.size(); i++)
-    {
-        parameterButtons[i]->setToggleState(false,false);
-    }
+    paramStates.clear();
 
     for (int i = 0; i < a.size(); i++)
     {
-        parameterButtons[a[i]]->setToggleState(true,false);
+        if (a[i] >= 0 && a[i] < numChannels)
+            paramStates.setBit(a[i]);
     }
+
+    channelSelectorRegion->repaint();
 }
 
 void ChannelSelector::inactivateButtons()
@@ -320,11 +484,7 @@ void ChannelSelector::inactivateButtons()
 
     paramsActive = false;
 
-    for (int i = 0; i < parameterButtons.size(); i++)
-    {
-        parameterButtons[i]->setActive(false);
-        parameterButtons[i]->repaint();
-    }
+    channelSelectorRegion->repaint();
 }
 
 void ChannelSelector::activateButtons()
@@ -332,11 +492,7 @@ void ChannelSelector::activateButtons()
 
     paramsActive = true;
 
-    for (int i = 0; i < parameterButtons.size(); i++)
-    {
-        parameterButtons[i]->setActive(true);
-        parameterButtons[i]->repaint();
-    }
+    channelSelectorRegion->repaint();
 
 }
 
@@ -358,19 +514,10 @@ void ChannelSelector::setRadioStatus(bool radioOn)
 
         radioStatus = radioOn;
 
-        for (int i = 0; i < parameterButtons.size(); i++)
-        {
-            if (radioOn)
-            {
-                parameterButtons[i]->setToggleState(false, false);
-                parameterButtons[i]->setRadioGroupId(999);
-            }
-            else
-            {
-                parameterButtons[i]->setToggleState(false, false);
-                parameterButtons[i]->setRadioGroupId(0);
-            }
-        }
+        paramStates.clear();
+        anchorChannel = -1;
+
+        channelSelectorRegion->repaint();
 
     }
 
@@ -381,8 +528,8 @@ void ChannelSelector::setRadioStatus(bool radioOn)
 bool ChannelSelector::getParamStatus(int chan)
 {
 
-    if (chan >= 0 && chan < parameterButtons.size())
-        return parameterButtons[chan]->getToggleState();
+    if (chan >= 0 && chan < numChannels)
+        return paramStates[chan];
     else
         return false;
 
@@ -391,8 +538,8 @@ bool ChannelSelector::getParamStatus(int chan)
 bool ChannelSelector::getRecordStatus(int chan)
 {
 
-    if (chan >= 0 && chan < recordButtons.size())
-        return recordButtons[chan]->getToggleState();
+    if (isNotSink && chan >= 0 && chan < numChannels)
+        return recordStates[chan];
     else
         return false;
 
@@ -401,8 +548,8 @@ bool ChannelSelector::getRecordStatus(int chan)
 bool ChannelSelector::getAudioStatus(int chan)
 {
 
-    if (chan >= 0 && chan < audioButtons.size())
-        return audioButtons[chan]->getToggleState();
+    if (isNotSink && chan >= 0 && chan < numChannels)
+        return audioStates[chan];
     else
         return false;
 
@@ -411,28 +558,68 @@ bool ChannelSelector::getAudioStatus(int chan)
 void ChannelSelector::setParamStatus(int chan, bool b)
 {
 
-    if (chan >= 0 && chan < parameterButtons.size())
-        parameterButtons[chan]->setToggleState(b, true);
+    if (chan >= 0 && chan < numChannels)
+    {
+        if (radioStatus && b)
+            paramStates.clear();
+
+        paramStates.setBit(chan, b);
+        channelSelectorRegion->repaint();
+        refreshParameterColors();
+    }
 
 }
 
 void ChannelSelector::setRecordStatus(int chan, bool b)
 {
 
-    if (chan >= 0 && chan < recordButtons.size())
-        recordButtons[chan]->setToggleState(b, true);
+    if (isNotSink && chan >= 0 && chan < numChannels)
+    {
+        setChannelState(RECORD, chan, b);
+        channelSelectorRegion->repaint();
+    }
 
 }
 
 void ChannelSelector::setAudioStatus(int chan, bool b)
 {
 
-    if (chan >= 0 && chan < audioButtons.size())
-        audioButtons[chan]->setToggleState(b, true);
+    if (isNotSink && chan >= 0 && chan < numChannels)
+    {
+        setChannelState(AUDIO, chan, b);
+        channelSelectorRegion->repaint();
+    }
+
+}
+
+
 
+void ChannelSelector::getSelectionStates(BigInteger& p, BigInteger& r, BigInteger& a)
+{
+    p = paramStates;
+    r = recordStates;
+    a = audioStates;
 }
 
+void ChannelSelector::setSelectionStates(const BigInteger& p, const BigInteger& r, const BigInteger& a)
+{
+    paramStates = p;
+
+    if (numChannels < paramStates.getHighestBit() + 1)
+        paramStates.setRange(numChannels, paramStates.getHighestBit() + 1 - numChannels, false);
 
+    if (isNotSink)
+    {
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            setChannelState(RECORD, chan, r[chan]);
+            setChannelState(AUDIO, chan, a[chan]);
+        }
+    }
+
+    channelSelectorRegion->repaint();
+    refreshParameterColors();
+}
 
 int ChannelSelector::getDesiredWidth()
 {
@@ -487,22 +674,13 @@ void ChannelSelector::buttonClicked(Button* button)
         // select all active buttons
         if (offsetLR == recordOffset)
         {
-
-
-            for (int i = 0; i < recordButtons.size(); i++)
-            {
-                recordButtons[i]->setToggleState(true, true);
-            }
-
+            if (isNotSink && numChannels > 0)
+                setChannelRange(RECORD, 0, numChannels - 1, true);
         }
         else if (offsetLR == parameterOffset)
         {
-
-
-            for (int i = 0; i < parameterButtons.size(); i++)
-            {
-                parameterButtons[i]->setToggleState(true, true);
-            }
+            if (paramsActive && !radioStatus)
+                paramStates.setRange(0, numChannels, true);
         }
         else if (offsetLR == audioOffset)
         {
@@ -514,24 +692,18 @@ void ChannelSelector::buttonClicked(Button* button)
         // deselect all active buttons
         if (offsetLR == recordOffset)
         {
-            for (int i = 0; i < recordButtons.size(); i++)
-            {
-                recordButtons[i]->setToggleState(false, true);
-            }
+            if (isNotSink && numChannels > 0)
+                setChannelRange(RECORD, 0, numChannels - 1, false);
         }
         else if (offsetLR == parameterOffset)
         {
-            for (int i = 0; i < parameterButtons.size(); i++)
-            {
-                parameterButtons[i]->setToggleState(false, true);
-            }
+            if (paramsActive)
+                paramStates.clear();
         }
         else if (offsetLR == audioOffset)
         {
-            for (int i = 0; i < audioButtons.size(); i++)
-            {
-                audioButtons[i]->setToggleState(false, true);
-            }
+            if (isNotSink && numChannels > 0)
+                setChannelRange(AUDIO, 0, numChannels - 1, false);
         }
 
         if (radioStatus) // if radio buttons are active
@@ -541,67 +713,8 @@ void ChannelSelector::buttonClicked(Button* button)
             editor->channelChanged(-1);
         }
     }
-    else
-    {
 
-        ChannelSelectorButton* b = (ChannelSelectorButton*) button;
-
-        if (b->getType() == AUDIO)
-        {
-            // get audio node, and inform it of the change
-            GenericEditor* editor = (GenericEditor*) getParentComponent();
-
-            Channel* ch = editor->getChannel(b->getChannel()-1);
-            //int channelNum = editor->getStartChannel() + b->getChannel() - 1;
-            bool status = b->getToggleState();
-
-            if (acquisitionIsActive) // use setParameter to change parameter safely
-            {
-                editor->getProcessorGraph()->
-                getAudioNode()->
-                setChannelStatus(ch, status);
-            }
-            else     // change parameter directly
-            {
-                ch->isMonitored = status;
-            }
-
-
-        }
-        else if (b->getType() == RECORD)
-        {
-            // get record node, and inform it of the change
-            GenericEditor* editor = (GenericEditor*) getParentComponent();
-
-            Channel* ch = editor->getChannel(b->getChannel()-1);
-            //int channelNum = editor->getStartChannel() + b->getChannel() - 1;
-            bool status = b->getToggleState();
-
-            if (acquisitionIsActive) // use setParameter to change parameter safely
-            {
-                editor->getProcessorGraph()->
-                getRecordNode()->
-                setChannelStatus(ch, status);
-            }
-            else     // change parameter directly
-            {
-                //std::cout << "Setting record status for channel " << b->getChannel() << std::endl;
-                ch->setRecordState(status);
-            }
-
-        }
-        else
-        {
-            // do nothing
-            if (radioStatus) // if radio buttons are active
-            {
-                // send a message to parent
-                GenericEditor* editor = (GenericEditor*) getParentComponent();
-                editor->channelChanged(b->getChannel());
-            }
-        }
-
-    }
+    channelSelectorRegion->repaint();
     refreshParameterColors();
 }
 
@@ -768,75 +881,55 @@ void EditorButton::paintButton(Graphics& g, bool isMouseOver, bool isButtonDown)
 }
 
 
-ChannelSelectorButton::ChannelSelectorButton(int num_, int type_, Font& f) : Button("name")
+ChannelSelectorRegion::ChannelSelectorRegion(ChannelSelector* cs)
 {
-    isActive = true;
-    num = num_;
-    type = type_;
-
-    setClickingTogglesState(true);
-
-    buttonFont = f;
-    buttonFont.setHeight(10);
+    channelSelector = cs;
 }
 
-
-void ChannelSelectorButton::paintButton(Graphics& g, bool isMouseOver, bool isButtonDown)
+ChannelSelectorRegion::~ChannelSelectorRegion()
 {
-    if (isActive)
-    {
-        if (getToggleState() == true)
-            g.setColour(Colours::orange);
-        else
-            g.setColour(Colours::darkgrey);
-
-        if (isMouseOver)
-            g.setColour(Colours::white);
-    }
-    else
-    {
-        if (getToggleState() == true)
-            g.setColour(Colours::yellow);
-        else
-            g.setColour(Colours::lightgrey);
-    }
 
-    // g.fillRect(0,0,getWidth(),getHeight());
-
-    g.setFont(buttonFont);
+}
 
-    // g.drawRect(0,0,getWidth(),getHeight(),1.0);
+void ChannelSelectorRegion::mouseWheelMove(const MouseEvent& event,
+                                           const MouseWheelDetails& wheel)
+{
 
-    g.drawText(String(num),0,0,getWidth(),getHeight(),Justification::centred,true);
+    channelSelector->shiftChannelsVertical(wheel.deltaY);
 }
 
-void ChannelSelectorButton::setActive(bool t)
+void ChannelSelectorRegion::mouseDown(const MouseEvent& event)
 {
-    isActive = t;
-    setClickingTogglesState(t);
+    int type;
+    int chan = channelSelector->getChannelAt(event.x, event.y, type);
+
+    if (chan >= 0)
+        channelSelector->channelClicked(type, chan, event.mods.isShiftDown());
 }
 
-ChannelSelectorRegion::ChannelSelectorRegion(ChannelSelector* cs)
+void ChannelSelectorRegion::mouseDrag(const MouseEvent& event)
 {
-    channelSelector = cs;
+    int type;
+    int chan = channelSelector->getChannelAt(event.x, event.y, type);
 
-    addMouseListener((MouseListener*) this, true);
+    if (chan >= 0)
+        channelSelector->channelDragged(type, chan);
 }
 
-ChannelSelectorRegion::~ChannelSelectorRegion()
+void ChannelSelectorRegion::mouseMove(const MouseEvent& event)
 {
-    deleteAllChildren();
+    int type;
+    int chan = channelSelector->getChannelAt(event.x, event.y, type);
+
+    channelSelector->setHoverChannel(type, chan);
 }
 
-void ChannelSelectorRegion::mouseWheelMove(const MouseEvent& event,
-                                           const MouseWheelDetails& wheel)
+void ChannelSelectorRegion::mouseExit(const MouseEvent& event)
 {
-
-    std::cout << "Got wheel move: " << wheel.deltaY << std::endl;
-    channelSelector->shiftChannelsVertical(wheel.deltaY);
+    channelSelector->setHoverChannel(ChannelSelector::PARAMETER, -1);
 }
 
 void ChannelSelectorRegion::paint(Graphics& g)
 {
-    // g.fillAll(Colours::white);
-}
\ No newline at end of file
+    channelSelector->paintChannels(g, getWidth(), getHeight());
+}
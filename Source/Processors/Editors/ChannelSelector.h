@@ -33,7 +33,6 @@
 #include <stdio.h>
 
 class ChannelSelectorRegion;
-class ChannelSelectorButton;
 class EditorButton;
 
 /**
@@ -43,6 +42,14 @@ class EditorButton;
   Contains tabs for "Params", "Audio", and "Record", which allow
   channels to be selected for different purposes.
 
+  The selection for each tab is held in a bitset, and the channels are
+  drawn by the ChannelSelectorRegion on demand rather than as one
+  component per channel, so layout and painting only cost as much as the
+  rows that are visible, even with 1024 or more channels. Clicking a
+  channel toggles it; shift-clicking extends the selection from the last
+  clicked channel, and dragging applies the same state to every channel
+  the mouse passes over.
+
   @see GenericEditor
 
 */
@@ -76,7 +83,7 @@ public:
     /** get the total number of channels. */
     int getNumChannels()
     {
-        return parameterButtons.size();
+        return numChannels;
     }
 
     /** Return whether a particular channel should be recording. */
@@ -97,6 +104,13 @@ public:
     /** Set whether a particular channel is selected for editing parameters. */
     void setParamStatus(int, bool);
 
+    /** Copies the param, record and audio selections of all channels. */
+    void getSelectionStates(BigInteger& p, BigInteger& r, BigInteger& a);
+
+    /** Replaces the param, record and audio selections of all channels,
+        informing the RecordNode and AudioNode only of the channels that change. */
+    void setSelectionStates(const BigInteger& p, const BigInteger& r, const BigInteger& a);
+
     /** Return component's desired width. */
     int getDesiredWidth();
 
@@ -106,10 +120,10 @@ public:
     /** Called immediately after data acquisition ends.*/
     void stopAcquisition();
 
-    /** Inactivates all the ChannelSelectorButtons under the "param" tab.*/
+    /** Inactivates all the channels under the "param" tab.*/
     void inactivateButtons();
 
-    /** Activates all the ChannelSelectorButtons under the "param" tab.*/
+    /** Activates all the channels under the "param" tab.*/
     void activateButtons();
 
     /** Refreshes Parameter Colors on change*/
@@ -119,7 +133,7 @@ public:
         p->updateParameterButtons(-1);
     }
 
-    /** Controls the behavior of ChannelSelectorButtons; they can either behave
+    /** Controls the behavior of the "param" channels; they can either behave
     like radio buttons (only one selected at a time) or like toggle buttons (an
     arbitrary number can be selected at once).*/
     void setRadioStatus(bool);
@@ -137,23 +151,34 @@ public:
 
 private:
 
+    friend class ChannelSelectorRegion;
+
     EditorButton* audioButton;
     EditorButton* recordButton;
     EditorButton* paramsButton;
     EditorButton* allButton;
     EditorButton* noneButton;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-       will be updated when a parameter is changed. */
-    Array<ChannelSelectorButton*> parameterButtons;
+    /** The channels that will be updated when a parameter is changed. */
+    BigInteger paramStates;
+
+    /** The channels that are sent to the audio monitor. */
+    BigInteger audioStates;
+
+    /** The channels that will be written to disk when the record button is pressed. */
+    BigInteger recordStates;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-       are sent to the audio monitor. */
-    Array<ChannelSelectorButton*> audioButtons;
+    int numChannels;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-       will be written to disk when the record button is pressed. */
-    Array<ChannelSelectorButton*> recordButtons;
+    /** Start of a shift-click range. */
+    int anchorChannel;
+
+    /** Last channel reached while dragging, and the state being applied. */
+    int lastDragChannel;
+    bool dragState;
+
+    int hoverChannel;
+    int hoverType;
 
     bool paramsToggled;
     bool paramsActive;
@@ -174,10 +199,34 @@ private:
 
     void resized();
 
-    void addButton();
-    void removeButton();
     void refreshButtonBoundaries();
 
+    int getColumnWidth();
+    int getTabOffset(int type);
+    BigInteger& getStates(int type);
+
+    /** Draws the visible rows of every tab that is on screen. */
+    void paintChannels(Graphics& g, int width, int height);
+
+    /** Returns the channel under a point in the region (or -1), and the tab it
+        belongs to. */
+    int getChannelAt(int x, int y, int& type);
+
+    /** Updates one channel, and informs the RecordNode or AudioNode of record
+        and audio changes. Returns true if the state changed. */
+    bool setChannelState(int type, int chan, bool status);
+
+    /** Applies setChannelState() to every channel between first and last. */
+    void setChannelRange(int type, int first, int last, bool status);
+
+    /** Handles a mouse click on a channel in the region. */
+    void channelClicked(int type, int chan, bool extendSelection);
+
+    /** Handles the mouse being dragged onto a channel in the region. */
+    void channelDragged(int type, int chan);
+
+    void setHoverChannel(int type, int chan);
+
     /** Controls the speed of animations. */
     void timerCallback();
 
@@ -188,6 +237,8 @@ private:
 
     enum {AUDIO, RECORD, PARAMETER};
 
+    enum {numColumns = 8, rowHeight = 14};
+
     bool acquisitionIsActive;
 
     ChannelSelectorRegion* channelSelectorRegion;
@@ -247,7 +298,7 @@ private:
 
 /**
 
-  Holds the ChannelSelector buttons.
+  Draws the channels of the ChannelSelector and forwards mouse events to it.
 
   @see ChannelSelector
 
@@ -262,48 +313,21 @@ public:
 
     /** Allows the user to scroll the channels if they are not all visible.*/
     void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel);
-    void paint(Graphics& g);
 
-private:
-    ChannelSelector* channelSelector;
+    /** Toggles a channel, or extends the selection if shift is held.*/
+    void mouseDown(const MouseEvent& event);
 
-};
+    /** Applies the state chosen on mouse-down to the channels dragged over.*/
+    void mouseDrag(const MouseEvent& event);
 
-/**
-
-  A button within the ChannelSelector representing an individual channel.
-
-  @see ChannelSelector
-
-*/
+    void mouseMove(const MouseEvent& event);
+    void mouseExit(const MouseEvent& event);
 
-class ChannelSelectorButton : public Button
-{
-public:
-    ChannelSelectorButton(int num, int type, Font& f);
-    ~ChannelSelectorButton() {}
-
-    int getType()
-    {
-        return type;
-    }
-    int getChannel()
-    {
-        return num;
-    }
-    //Channel* getChannel() {return ch;}
-    void setActive(bool t);
+    void paint(Graphics& g);
 
 private:
-    void paintButton(Graphics& g, bool isMouseOver, bool isButtonDown);
-
-    //Channel* ch;
+    ChannelSelector* channelSelector;
 
-    int type;
-    int num;
-    Font buttonFont;
-    bool isActive;
 };
 
-
 #endif  // __CHANNELSELECTOR_H_68124E35__
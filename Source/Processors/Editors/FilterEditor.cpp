@@ -65,6 +65,14 @@ FilterEditor::FilterEditor(GenericProcessor* parentNode, bool useDefaultParamete
     highCutValue->addListener(this);
     addAndMakeVisible(highCutValue);
 
+    precisionButton = new UtilityButton("F32", Font("Small Text", 10, Font::plain));
+    precisionButton->setRadius(3.0f);
+    precisionButton->setBounds(105,100,30,20);
+    precisionButton->setClickingTogglesState(true);
+    precisionButton->setTooltip("Single-precision filters (fine for spike bands, not for LFP)");
+    precisionButton->addListener(this);
+    addAndMakeVisible(precisionButton);
+
 }
 
 FilterEditor::~FilterEditor()
@@ -147,6 +155,22 @@ void FilterEditor::labelTextChanged(Label* label)
 
 void FilterEditor::buttonEvent(Button* button)
 {
+    if (button == precisionButton)
+    {
+        FilterNode* fn = (FilterNode*) getProcessor();
+
+        if (acquisitionIsActive)
+        {
+            // a new bank starts from rest, which would put a transient in the data
+            sendActionMessage("Stop acquisition before changing filter precision.");
+            precisionButton->setToggleState(fn->isSinglePrecision(), false);
+            return;
+        }
+
+        fn->setSinglePrecision(precisionButton->getToggleState());
+        return;
+    }
+
     //std::cout << button->getRadioGroupId() << " " << button->getName() << std::endl;
 
     //if (!checkDrawerButton(button) && !checkChannelSelectors(button)) {
@@ -185,6 +209,7 @@ void FilterEditor::saveEditorParameters(XmlElement* xml)
     XmlElement* textLabelValues = xml->createNewChildElement("VALUES");
     textLabelValues->setAttribute("HighCut",lastHighCutString);
     textLabelValues->setAttribute("LowCut",lastLowCutString);
+    textLabelValues->setAttribute("SinglePrecision",precisionButton->getToggleState());
 }
 
 void FilterEditor::loadEditorParameters(XmlElement* xml)
@@ -196,6 +221,10 @@ void FilterEditor::loadEditorParameters(XmlElement* xml)
         {
             highCutValue->setText(xmlNode->getStringAttribute("HighCut"),dontSendNotification);
             lowCutValue->setText(xmlNode->getStringAttribute("LowCut"),dontSendNotification);
+
+            bool singlePrecision = xmlNode->getBoolAttribute("SinglePrecision", false);
+            precisionButton->setToggleState(singlePrecision, false);
+            ((FilterNode*) getProcessor())->setSinglePrecision(singlePrecision);
         }
     }
 }
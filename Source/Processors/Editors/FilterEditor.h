@@ -64,6 +64,8 @@ private:
     ScopedPointer<Label> highCutValue;
     ScopedPointer<Label> lowCutValue;
 
+    ScopedPointer<UtilityButton> precisionButton;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterEditor);
 
 };
@@ -525,6 +525,28 @@ void GenericEditor::setChannelSelectionState(int chan, bool p, bool r, bool a)
     }
 }
 
+void GenericEditor::getChannelSelectionStates(BigInteger& p, BigInteger& r, BigInteger& a)
+{
+    if (!isSplitOrMerge)
+    {
+        channelSelector->getSelectionStates(p, r, a);
+    }
+    else
+    {
+        p.clear();
+        r.clear();
+        a.clear();
+    }
+}
+
+void GenericEditor::setChannelSelectionStates(const BigInteger& p, const BigInteger& r, const BigInteger& a)
+{
+    if (!isSplitOrMerge)
+    {
+        channelSelector->setSelectionStates(p, r, a);
+    }
+}
+
 void GenericEditor::saveEditorParameters(XmlElement* xml)
 {
 
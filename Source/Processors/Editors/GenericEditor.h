@@ -231,6 +231,12 @@ public:
     /** Sets param/audio/record selection state for a given channel */
     void setChannelSelectionState(int chan, bool p, bool r, bool a);
 
+    /** Returns param/record/audio selection state for all channels at once */
+    void getChannelSelectionStates(BigInteger& p, BigInteger& r, BigInteger& a);
+
+    /** Sets param/record/audio selection state for all channels at once */
+    void setChannelSelectionStates(const BigInteger& p, const BigInteger& r, const BigInteger& a);
+
     /** Writes editor state to xml */
     virtual void saveEditorParameters(XmlElement* xml);
 
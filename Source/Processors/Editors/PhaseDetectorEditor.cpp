@@ -120,7 +120,7 @@ void PhaseDetectorEditor::comboBoxChanged(ComboBox* c)
 
 void PhaseDetectorEditor::buttonEvent(Button* button)
 {
-    if (button == plusButton && interfaces.size() < 5)
+    if (button == plusButton && interfaces.size() < 32)
     {
 
         addDetector();
@@ -37,9 +37,25 @@ ReferenceNodeEditor::ReferenceNodeEditor(GenericProcessor* parentNode, bool useD
     referenceSelector->setBounds(15,50,150,25);
     referenceSelector->addListener(this);
     referenceSelector->addItem("None", 1);
+    referenceSelector->addItem("Common average", commonAverageId);
+    referenceSelector->addItem("Common median", commonMedianId);
     referenceSelector->setSelectedId(1, false);
     addAndMakeVisible(referenceSelector);
 
+    // the item ID is the group size, except for "All channels"
+    groupSelector = new ComboBox();
+    groupSelector->setBounds(15,85,150,25);
+    groupSelector->addListener(this);
+    groupSelector->addItem("All channels", 1);
+    groupSelector->addItem("Groups of 4", 4);
+    groupSelector->addItem("Groups of 8", 8);
+    groupSelector->addItem("Groups of 16", 16);
+    groupSelector->addItem("Groups of 32", 32);
+    groupSelector->addItem("Groups of 64", 64);
+    groupSelector->setSelectedId(1, false);
+    groupSelector->setEnabled(false);
+    addAndMakeVisible(groupSelector);
+
 }
 
 ReferenceNodeEditor::~ReferenceNodeEditor()
@@ -52,9 +68,13 @@ void ReferenceNodeEditor::updateSettings()
 
     if (getProcessor()->getNumInputs() != previousChannelCount)
     {
+        int id = referenceSelector->getSelectedId();
+
         referenceSelector->clear();
 
         referenceSelector->addItem("None", 1);
+        referenceSelector->addItem("Common average", commonAverageId);
+        referenceSelector->addItem("Common median", commonMedianId);
 
         for (int i = 0; i < getProcessor()->getNumInputs(); i++)
         {
@@ -64,32 +84,66 @@ void ReferenceNodeEditor::updateSettings()
 
         previousChannelCount = getProcessor()->getNumInputs();
 
-    }
+        // keep the common reference modes; a single channel may no longer exist
+        if (id != commonAverageId && id != commonMedianId)
+            id = 1;
 
-    referenceSelector->setSelectedId(1, false);
+        referenceSelector->setSelectedId(id, true);
+        comboBoxChanged(referenceSelector);
+
+    }
 
-    getProcessor()->setParameter(1,-1.0f);
 }
 
 void ReferenceNodeEditor::comboBoxChanged(ComboBox* c)
 {
-    float channel;
-
     int id = c->getSelectedId();
 
-    if (id == 1)
+    if (c == groupSelector)
+    {
+        getProcessor()->setParameter(3, (id == 1) ? 0.0f : float(id));
+        return;
+    }
+
+    bool common = (id == commonAverageId || id == commonMedianId);
+
+    if (id == commonAverageId)
+        getProcessor()->setParameter(2, float(ReferenceNode::COMMON_AVERAGE));
+    else if (id == commonMedianId)
+        getProcessor()->setParameter(2, float(ReferenceNode::COMMON_MEDIAN));
+    else
+        getProcessor()->setParameter(2, float(ReferenceNode::SINGLE_CHANNEL));
+
+    if (common || id == 1)
     {
-        channel = -1.0f;
+        getProcessor()->setParameter(1, -1.0f);
     }
     else
     {
-        channel = float(id) - 2.0f;
+        getProcessor()->setParameter(1, float(id) - 2.0f);
     }
 
-    getProcessor()->setParameter(1,channel);
+    groupSelector->setEnabled(common && !acquisitionIsActive);
 
 }
 
+void ReferenceNodeEditor::startAcquisition()
+{
+    GenericEditor::startAcquisition();
+
+    // the group scratch space is sized on the message thread
+    groupSelector->setEnabled(false);
+}
+
+void ReferenceNodeEditor::stopAcquisition()
+{
+    GenericEditor::stopAcquisition();
+
+    int id = referenceSelector->getSelectedId();
+
+    groupSelector->setEnabled(id == commonAverageId || id == commonMedianId);
+}
+
 void ReferenceNodeEditor::buttonEvent(Button* button)
 {
 
@@ -105,6 +159,10 @@ void ReferenceNodeEditor::saveEditorParameters(XmlElement* xml)
 
     selectedChannel->setAttribute("ID",referenceSelector->getSelectedId());
 
+    XmlElement* grouping = xml->createNewChildElement("GROUPING");
+
+    grouping->setAttribute("ID",groupSelector->getSelectedId());
+
 }
 
 void ReferenceNodeEditor::loadEditorParameters(XmlElement* xml)
@@ -120,5 +178,9 @@ void ReferenceNodeEditor::loadEditorParameters(XmlElement* xml)
             referenceSelector->setSelectedId(id);
 
         }
+        else if (xmlNode->hasTagName("GROUPING"))
+        {
+            groupSelector->setSelectedId(xmlNode->getIntAttribute("ID"));
+        }
     }
 }
\ No newline at end of file
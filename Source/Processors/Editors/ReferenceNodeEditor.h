@@ -47,13 +47,25 @@ public:
 
     void updateSettings();
 
+    void startAcquisition();
+    void stopAcquisition();
+
     void saveEditorParameters(XmlElement* xml);
     void loadEditorParameters(XmlElement* xml);
 
 
 private:
 
+    /** Item IDs for the common reference modes; the IDs of the single
+        channel items (channel + 2) are kept for older configuration files.*/
+    enum
+    {
+        commonAverageId = 10001,
+        commonMedianId = 10002
+    };
+
     ScopedPointer<ComboBox> referenceSelector;
+    ScopedPointer<ComboBox> groupSelector;
 
     int previousChannelCount;
 
@@ -29,10 +29,11 @@
 
 
 SignalGeneratorEditor::SignalGeneratorEditor(GenericProcessor* parentNode, bool useDefaultParameters=false)
-    : GenericEditor(parentNode, useDefaultParameters), amplitudeSlider(0), frequencySlider(0), phaseSlider(0)
+    : GenericEditor(parentNode, useDefaultParameters), amplitudeSlider(0), frequencySlider(0), phaseSlider(0),
+      noiseSlider(0), spikeRateSlider(0)
 
 {
-    desiredWidth = 250;
+    desiredWidth = 370;
 
     int buttonWidth = 31;
     int buttonHeight = 19;
@@ -72,20 +73,36 @@ SignalGeneratorEditor::SignalGeneratorEditor(GenericProcessor* parentNode, bool
     phaseSlider->setTextBoxStyle(Slider::TextBoxBelow, false, 40, 20);
     addAndMakeVisible(phaseSlider);
 
+    noiseSlider = new Slider("Noise Slider");
+    noiseSlider->setBounds(190,60,50,60);
+    noiseSlider->setRange(0,1,0.05);
+    noiseSlider->addListener(this);
+    noiseSlider->setSliderStyle(Slider::Rotary);
+    noiseSlider->setTextBoxStyle(Slider::TextBoxBelow, false, 40, 20);
+    addAndMakeVisible(noiseSlider);
+
+    spikeRateSlider = new Slider("Spike Rate Slider");
+    spikeRateSlider->setBounds(250,60,50,60);
+    spikeRateSlider->setRange(0,100,1);
+    spikeRateSlider->addListener(this);
+    spikeRateSlider->setSliderStyle(Slider::Rotary);
+    spikeRateSlider->setTextBoxStyle(Slider::TextBoxBelow, false, 40, 20);
+    addAndMakeVisible(spikeRateSlider);
+
     numChannelsLabel = new Label("Number of Channels","5");
     numChannelsLabel->setEditable(true);
     numChannelsLabel->addListener(this);
-    numChannelsLabel->setBounds(200,50,25,20);
+    numChannelsLabel->setBounds(320,50,40,20);
     addAndMakeVisible(numChannelsLabel);
 
     upButton = new TriangleButton(1);
     upButton->addListener(this);
-    upButton->setBounds(200,30,20,15);
+    upButton->setBounds(320,30,20,15);
     addAndMakeVisible(upButton);
 
     downButton = new TriangleButton(2);
     downButton->addListener(this);
-    downButton->setBounds(200,75,20,15);
+    downButton->setBounds(320,75,20,15);
     addAndMakeVisible(downButton);
 
 }
@@ -177,6 +194,14 @@ void SignalGeneratorEditor::sliderEvent(Slider* slider)
     {
         paramIndex = 2;
     }
+    else if (slider == noiseSlider)
+    {
+        paramIndex = 4;
+    }
+    else if (slider == spikeRateSlider)
+    {
+        paramIndex = 5;
+    }
 
 
     GenericProcessor* p = getProcessor();
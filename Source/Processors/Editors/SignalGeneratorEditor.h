@@ -34,7 +34,8 @@ class WaveformSelector;
 
   User interface for the SignalGenerator.
 
-  Allows the user to edit the waveform type, amplitude, frequency, and phase of individual channels.
+  Allows the user to edit the waveform type, amplitude, frequency, and phase of individual channels,
+  as well as the level of added noise and the rate of injected spikes.
 
   @see SignalGenerator
 
@@ -59,6 +60,8 @@ private:
     Slider* amplitudeSlider;
     Slider* frequencySlider;
     Slider* phaseSlider;
+    Slider* noiseSlider;
+    Slider* spikeRateSlider;
 
     Array<WaveformSelector*> waveformSelectors;
 
@@ -116,10 +116,25 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     thresholdLabel = new Label("Name","Threshold");
     font.setHeight(10);
     thresholdLabel->setFont(font);
-    thresholdLabel->setBounds(202, 105, 95, 15);
+    thresholdLabel->setBounds(202, 105, 45, 15);
     thresholdLabel->setColour(Label::textColourId, Colours::grey);
     addAndMakeVisible(thresholdLabel);
 
+    // cycles between manual thresholds and k = 4, 5, 6 times the noise level
+    autoThresholdButton = new UtilityButton("MANUAL", titleFont);
+    autoThresholdButton->addListener(this);
+    autoThresholdButton->setRadius(3.0f);
+    autoThresholdButton->setBounds(248,106,48,12);
+    addAndMakeVisible(autoThresholdButton);
+
+    // only keeps the largest of the spikes seen on neighbouring electrodes
+    deduplicateButton = new UtilityButton("DEDUP", Font("Small Text", 13, Font::plain));
+    deduplicateButton->setRadius(3.0f);
+    deduplicateButton->setBounds(136,76,56,18);
+    deduplicateButton->addListener(this);
+    deduplicateButton->setClickingTogglesState(true);
+    addAndMakeVisible(deduplicateButton);
+
     // create a custom channel selector
     deleteAndZero(channelSelector);
 
@@ -160,10 +175,15 @@ void SpikeDetectorEditor::sliderEvent(Slider* slider)
         }
     }
 
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+    // automatic thresholds would overwrite the new value
+    if (processor->getThresholdMultiplier() > 0.0f)
+        return;
+
     //   std::cout << "Slider value changed." << std::endl;
     if (electrodeNum > -1)
     {
-        SpikeDetector* processor = (SpikeDetector*) getProcessor();
         processor->setChannelThreshold(electrodeList->getSelectedItemIndex(),
                                        electrodeNum,
                                        slider->getValue());
@@ -191,7 +211,7 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
             SpikeDetector* processor = (SpikeDetector*) getProcessor();
 
-            thresholdSlider->setActive(true);
+            thresholdSlider->setActive(processor->getThresholdMultiplier() <= 0.0f);
             thresholdSlider->setValue(processor->getChannelThreshold(electrodeList->getSelectedItemIndex(),
                                                                      electrodeButtons.indexOf((ElectrodeButton*) button)));
         }
@@ -330,9 +350,49 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
         return;
     }
+    else if (button == deduplicateButton)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+        processor->setDeduplication(button->getToggleState());
+
+        return;
+    }
+    else if (button == autoThresholdButton)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+        float k = processor->getThresholdMultiplier();
+
+        if (k >= 6.0f)
+            k = 0.0f;
+        else if (k < 4.0f)
+            k = 4.0f;
+        else
+            k = floorf(k) + 1.0f;
+
+        processor->setThresholdMultiplier(k);
+
+        updateAutoThresholdButton();
+
+        thresholdSlider->setActive(false);
+
+        return;
+    }
+
+
 
+}
+
+void SpikeDetectorEditor::updateAutoThresholdButton()
+{
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
 
+    float k = processor->getThresholdMultiplier();
 
+    if (k > 0.0f)
+        autoThresholdButton->setLabel(String(k, 1) + " SD");
+    else
+        autoThresholdButton->setLabel("MANUAL");
 }
 
 void SpikeDetectorEditor::channelChanged(int chan)
@@ -483,6 +543,11 @@ void SpikeDetectorEditor::checkSettings()
 {
     electrodeList->setSelectedItemIndex(0);
 
+    updateAutoThresholdButton();
+
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+    deduplicateButton->setToggleState(processor->isDeduplicating(), false);
+
     getEditorViewport()->makeEditorVisible(this, true, true);
 
 }
@@ -101,6 +101,8 @@ private:
 
     void drawElectrodeButtons(int);
 
+    void updateAutoThresholdButton();
+
     void refreshElectrodeList();
 
     ComboBox* electrodeTypes;
@@ -110,6 +112,8 @@ private:
     TriangleButton* upButton;
     TriangleButton* downButton;
     UtilityButton* plusButton;
+    UtilityButton* autoThresholdButton;
+    UtilityButton* deduplicateButton;
 
     ThresholdSlider* thresholdSlider;
 
@@ -0,0 +1,80 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeSorterEditor.h"
+#include "../SpikeSorter.h"
+
+#include <stdio.h>
+
+SpikeSorterEditor::SpikeSorterEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 170;
+
+    unitLabel = new Label("units", "No units");
+    unitLabel->setBounds(10,35,150,20);
+    unitLabel->setFont(Font("Small Text", 12, Font::plain));
+    unitLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(unitLabel);
+
+    clearButton = new UtilityButton("CLEAR UNITS", Font("Small Text", 13, Font::plain));
+    clearButton->addListener(this);
+    clearButton->setRadius(3.0f);
+    clearButton->setBounds(15,70,100,20);
+    addAndMakeVisible(clearButton);
+
+}
+
+SpikeSorterEditor::~SpikeSorterEditor()
+{
+
+}
+
+void SpikeSorterEditor::buttonEvent(Button* button)
+{
+    if (button == clearButton)
+    {
+        SpikeSorter* processor = (SpikeSorter*) getProcessor();
+        processor->clearAllTemplates();
+    }
+}
+
+void SpikeSorterEditor::updateSettings()
+{
+    updateUnitCount();
+}
+
+void SpikeSorterEditor::updateUnitCount()
+{
+    SpikeSorter* processor = (SpikeSorter*) getProcessor();
+
+    int numUnits = processor->getTotalNumTemplates();
+
+    if (numUnits == 0)
+        unitLabel->setText("No units", dontSendNotification);
+    else if (numUnits == 1)
+        unitLabel->setText("1 unit", dontSendNotification);
+    else
+        unitLabel->setText(String(numUnits) + " units", dontSendNotification);
+}
@@ -0,0 +1,65 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKESORTEREDITOR_H_9B3D57E1__
+#define __SPIKESORTEREDITOR_H_9B3D57E1__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "GenericEditor.h"
+
+class SpikeSorter;
+
+/**
+
+  User interface for the SpikeSorter processor.
+
+  Shows how many units have templates and clears them. Templates are added
+  from the Spike Viewer by shift-clicking a waveform.
+
+  @see SpikeSorter
+
+*/
+
+class SpikeSorterEditor : public GenericEditor
+{
+public:
+    SpikeSorterEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    virtual ~SpikeSorterEditor();
+
+    void buttonEvent(Button* button);
+
+    void updateSettings();
+
+    /** Refreshes the unit count after templates change. */
+    void updateUnitCount();
+
+private:
+
+    ScopedPointer<Label> unitLabel;
+    ScopedPointer<UtilityButton> clearButton;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorterEditor);
+
+};
+
+#endif  // __SPIKESORTEREDITOR_H_9B3D57E1__
@@ -28,12 +28,14 @@
 
 
 EventDetector::EventDetector()
-    : GenericProcessor("Event Detector"), threshold(200.0), bufferZone(5.0f), state(false)
+    : GenericProcessor("Event Detector"), bufferZone(5.0f)
 
 {
 
     parameters.add(Parameter("thresh", 0.0, 500.0, 200.0, 0));
 
+    crossings.ensureStorageAllocated(maxCrossings);
+
 }
 
 EventDetector::~EventDetector()
@@ -41,16 +43,37 @@ EventDetector::~EventDetector()
 
 }
 
+void EventDetector::updateSettings()
+{
+    // channel 0 is used by default, as before; the others keep their thresholds
+    while (thresholds.size() < getNumInputs())
+        thresholds.add(thresholds.size() == 0 ? 200.0f : 0.0f);
+
+    thresholds.resize(getNumInputs());
+
+    states.clearQuick();
+    states.insertMultiple(0, false, getNumInputs());
+}
+
+bool EventDetector::enable()
+{
+    for (int i = 0; i < states.size(); i++)
+        states.set(i, false);
 
+    return true;
+}
 
 void EventDetector::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
 
+    const int chan = (currentChannel >= 0) ? currentChannel : 0;
+
     Parameter& p =  parameters.getReference(parameterIndex);
-    p.setValue(newValue, 0);
+    p.setValue(newValue, chan);
 
-    threshold = newValue;
+    if (chan < thresholds.size())
+        thresholds.set(chan, newValue);
 
     //std::cout << float(p[0]) << std::endl;
 
@@ -63,27 +86,85 @@ void EventDetector::process(AudioSampleBuffer& buffer,
 
     //std::cout << *buffer.getSampleData(0, 0) << std::endl;
 
+    crossings.clearQuick();
+
+    // event channels are one byte wide
+    const int numChannels = jmin(buffer.getNumChannels(), thresholds.size(), 256);
 
-    for (int i = 0; i < nSamples; i++)
+    for (int chan = 0; chan < numChannels; chan++)
     {
+        if (thresholds.getUnchecked(chan) > 0.0f)
+            detectCrossings(chan, buffer.getSampleData(chan), nSamples);
+    }
 
-        if ((*buffer.getSampleData(0, i) < -threshold) && !state)
-        {
+    if (crossings.size() == 0)
+        return;
+
+    CrossingSorter sorter;
+    crossings.sort(sorter);
+
+    // written directly, so there is no allocation per event
+    uint8 data[4];
+    data[0] = TTL;
+    data[1] = nodeId;
+
+    for (int i = 0; i < crossings.size(); i++)
+    {
+        const Crossing& c = crossings.getReference(i);
 
-            // generate midi event
-            //std::cout << "Value = " << *buffer.getSampleData(0, i) << std::endl;
-            addEvent(events, TTL, i);
+        data[2] = c.eventId;
+        data[3] = c.channel;
 
-            state = true;
+        events.addEvent(data, 4, c.sampleNum);
+    }
+
+}
+
+void EventDetector::detectCrossings(int chan, const float* data, int nSamples)
+{
+    const float onLevel = -thresholds.getUnchecked(chan);
+    const float offLevel = onLevel + bufferZone;
+
+    bool state = states.getUnchecked(chan);
+
+    for (int start = 0; start < nSamples; start += chunkSize)
+    {
+        const int end = jmin(start + chunkSize, nSamples);
 
+        // count the samples that would change the state, without branches
+        int candidates = 0;
+
+        if (state)
+        {
+            for (int i = start; i < end; i++)
+                candidates += (data[i] > offLevel);
         }
-        else if ((*buffer.getSampleData(0, i) > -threshold + bufferZone)  && state)
+        else
         {
-            state = false;
+            for (int i = start; i < end; i++)
+                candidates += (data[i] < onLevel);
         }
 
+        if (candidates == 0)
+            continue;
 
-    }
+        for (int i = start; i < end; i++)
+        {
+            const bool changed = state ? (data[i] > offLevel) : (data[i] < onLevel);
 
+            if (changed && crossings.size() < maxCrossings)
+            {
+                state = !state;
+
+                Crossing c;
+                c.sampleNum = i;
+                c.channel = (uint8) chan;
+                c.eventId = state ? 1 : 0;
+
+                crossings.add(c);
+            }
+        }
+    }
 
+    states.setUnchecked(chan, state);
 }
@@ -31,6 +31,18 @@
 
   Searches for threshold crossings and sends out TTL events.
 
+  Every input channel with a non-zero threshold (set per channel through
+  the channel selector) is turned into a TTL line: an "on" event when the
+  signal falls below -threshold, and an "off" event when it comes back above
+  -threshold + bufferZone. The event channel is the input channel number.
+  The state of each line is carried across blocks.
+
+  Samples are tested in chunks of 16 with a branch-free count of candidate
+  samples, which the compiler turns into packed compares; only chunks that
+  contain a transition are walked one sample at a time. Crossings from all
+  channels are collected, sorted by sample, and written to the event buffer
+  once per block without per-event allocation.
+
   @see GenericProcessor
 
 */
@@ -44,13 +56,52 @@ public:
     ~EventDetector();
 
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
+    /** Only reads the continuous channels. */
+    bool isPassThrough()
+    {
+        return true;
+    }
     void setParameter(int parameterIndex, float newValue);
 
+    void updateSettings();
+
+    bool enable();
+
 private:
 
-    float threshold;
     float bufferZone;
-    bool state;
+
+    /** Threshold of each input channel; 0 means the channel is not used. */
+    Array<float> thresholds;
+
+    /** True while a channel is below its threshold. */
+    Array<bool> states;
+
+    struct Crossing
+    {
+        int sampleNum;
+        uint8 channel;
+        uint8 eventId;
+    };
+
+    class CrossingSorter
+    {
+    public:
+        static int compareElements(const Crossing& a, const Crossing& b)
+        {
+            if (a.sampleNum != b.sampleNum)
+                return a.sampleNum - b.sampleNum;
+
+            return int(a.channel) - int(b.channel);
+        }
+    };
+
+    enum { chunkSize = 16, maxCrossings = 4096 };
+
+    Array<Crossing> crossings;
+
+    void detectCrossings(int chan, const float* data, int nSamples);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventDetector);
 
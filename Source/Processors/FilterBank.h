@@ -0,0 +1,303 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FILTERBANK_H_7B3E0D19__
+#define __FILTERBANK_H_7B3E0D19__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../Dsp/Dsp.h"
+
+/**
+
+  Identifies a band-pass design: channels with equal keys share coefficients.
+
+  @see FilterBank
+
+*/
+
+struct FilterBankKey
+{
+    FilterBankKey() : order(0), sampleRate(0.0), lowCut(0.0), highCut(0.0) {}
+
+    FilterBankKey(int order_, double sampleRate_, double lowCut_, double highCut_)
+        : order(order_), sampleRate(sampleRate_), lowCut(lowCut_), highCut(highCut_) {}
+
+    bool operator== (const FilterBankKey& other) const
+    {
+        return order == other.order
+               && sampleRate == other.sampleRate
+               && lowCut == other.lowCut
+               && highCut == other.highCut;
+    }
+
+    /** Returns the parameters for a Butterworth band-pass Design. */
+    Dsp::Params getParams() const;
+
+    int order;
+    double sampleRate;
+    double lowCut;
+    double highCut;
+};
+
+/**
+
+  A set of band-pass filters, one per channel, in which channels with
+  identical settings share a single design.
+
+  FilterNode used to keep a complete filter object for every channel and
+  redesign each one whenever its cutoffs changed, even though in practice
+  nearly all channels use the same band. Here, designs are looked up by
+  (order, sample rate, cutoffs): the first channel to ask for a band pays
+  for the design, and every other channel only gets a new state. Channels
+  that share a design are processed together, two at a time, using the
+  interleaved section-by-section path of Dsp::Cascade.
+
+  Channel settings may be changed from the message thread while the audio
+  thread is processing; the two are serialized with a lock that is only
+  held for the duration of a regroup.
+
+  Use FilterBank::create() to get a bank of the desired precision.
+
+  @see FilterNode, FilterBankOf
+
+*/
+
+class FilterBank
+{
+public:
+
+    enum { maxOrder = 3 };
+
+    typedef Dsp::Butterworth::Design::BandPass <maxOrder> Design;
+
+    virtual ~FilterBank() {}
+
+    /** Creates an empty bank with double- or single-precision state. */
+    static FilterBank* create(bool singlePrecision);
+
+    /** Sets the band used by a given channel, adding the channel if needed.
+        The channel's filter state is kept. */
+    virtual void setBand(int channel, const FilterBankKey& key) = 0;
+
+    /** Removes all channels and designs. */
+    virtual void clear() = 0;
+
+    /** Clears the state of every channel. */
+    virtual void reset() = 0;
+
+    /** Filters every channel of the buffer that has a band assigned. */
+    virtual void process(AudioSampleBuffer& buffer, int nSamples) = 0;
+
+    /** Returns the number of channels with a band assigned. */
+    virtual int getNumChannels() = 0;
+
+    /** Returns the number of distinct designs in use. */
+    virtual int getNumDesigns() = 0;
+
+};
+
+/**
+
+  FilterBank implementation for a given Dsp state realization
+  (e.g. Dsp::DirectFormII, Dsp::TransposedDirectFormIIFloat).
+
+  @see FilterBank
+
+*/
+
+template <class StateType>
+class FilterBankOf : public FilterBank
+{
+public:
+
+    typedef typename Design::template State <StateType> ChannelState;
+
+    FilterBankOf() : numChannels(0) {}
+
+    ~FilterBankOf() {}
+
+    void setBand(int channel, const FilterBankKey& key)
+    {
+        ScopedPointer<Group> newGroup;
+
+        int groupIndex = findGroup(key);
+
+        if (groupIndex < 0)
+        {
+            // design outside the lock, so the audio thread isn't held up
+            newGroup = new Group(key);
+        }
+
+        const ScopedLock sl(lock);
+
+        if (newGroup != nullptr)
+        {
+            groupIndex = groups.size();
+            groups.add(newGroup.release());
+        }
+
+        Group* destination = groups[groupIndex];
+
+        ChannelState* state = nullptr;
+
+        for (int g = 0; g < groups.size(); g++)
+        {
+            const int index = groups[g]->channels.indexOf(channel);
+
+            if (index >= 0)
+            {
+                if (groups[g] == destination)
+                    return;
+
+                groups[g]->channels.remove(index);
+                state = groups[g]->states.removeAndReturn(index);
+
+                if (groups[g]->channels.size() == 0)
+                    groups.remove(g);
+
+                break;
+            }
+        }
+
+        if (state == nullptr)
+        {
+            state = new ChannelState();
+            numChannels++;
+        }
+
+        destination->channels.add(channel);
+        destination->states.add(state);
+    }
+
+    void clear()
+    {
+        const ScopedLock sl(lock);
+
+        groups.clear();
+        numChannels = 0;
+    }
+
+    void reset()
+    {
+        const ScopedLock sl(lock);
+
+        for (int g = 0; g < groups.size(); g++)
+        {
+            for (int i = 0; i < groups[g]->states.size(); i++)
+                groups[g]->states[i]->reset();
+        }
+    }
+
+    void process(AudioSampleBuffer& buffer, int nSamples)
+    {
+        const ScopedLock sl(lock);
+
+        const int numBufferChannels = buffer.getNumChannels();
+
+        for (int g = 0; g < groups.size(); g++)
+        {
+            Group* group = groups[g];
+
+            // channels that aren't in this buffer are skipped; the rest are
+            // taken in pairs
+            float* pending = nullptr;
+            ChannelState* pendingState = nullptr;
+
+            for (int i = 0; i < group->channels.size(); i++)
+            {
+                const int chan = group->channels.getUnchecked(i);
+
+                if (chan >= numBufferChannels)
+                    continue;
+
+                float* samples = buffer.getSampleData(chan);
+                ChannelState* state = group->states.getUnchecked(i);
+
+                if (pending == nullptr)
+                {
+                    pending = samples;
+                    pendingState = state;
+                }
+                else
+                {
+                    group->design.processPair(nSamples, pending, *pendingState,
+                                              samples, *state);
+                    pending = nullptr;
+                }
+            }
+
+            if (pending != nullptr)
+                group->design.process(nSamples, pending, *pendingState);
+        }
+    }
+
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    int getNumDesigns()
+    {
+        return groups.size();
+    }
+
+private:
+
+    /** One design and the channels that use it. */
+    struct Group
+    {
+        Group(const FilterBankKey& key_) : key(key_)
+        {
+            design.setParams(key.getParams());
+        }
+
+        FilterBankKey key;
+        Design design;
+        Array<int> channels;
+        OwnedArray<ChannelState> states; // states are self-referencing, so never copied
+    };
+
+    int findGroup(const FilterBankKey& key)
+    {
+        const ScopedLock sl(lock);
+
+        for (int g = 0; g < groups.size(); g++)
+        {
+            if (groups[g]->key == key)
+                return g;
+        }
+
+        return -1;
+    }
+
+    OwnedArray<Group> groups;
+    int numChannels;
+
+    CriticalSection lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterBankOf);
+
+};
+
+
+#endif  // __FILTERBANK_H_7B3E0D19__
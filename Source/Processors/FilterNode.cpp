@@ -26,10 +26,13 @@
 #include "Editors/FilterEditor.h"
 
 FilterNode::FilterNode()
-    : GenericProcessor("Bandpass Filter"), defaultLowCut(300.0f), defaultHighCut(6000.0f)
+    : GenericProcessor("Bandpass Filter"), defaultLowCut(300.0f), defaultHighCut(6000.0f),
+      useSinglePrecision(false)
 
 {
 
+    filterBank = FilterBank::create(useSinglePrecision);
+
     // // Deprecated "parameters" class // //
     // Array<var> lowCutValues;
     // lowCutValues.add(1.0f);
@@ -124,13 +127,37 @@ AudioProcessorEditor* FilterNode::createEditor()
 // filter->reset()
 // filter->process()
 
+void FilterNode::setSinglePrecision(bool singlePrecision)
+{
+    if (singlePrecision == useSinglePrecision)
+        return;
+
+    // build the new bank with the same cutoffs before touching the live one
+    ScopedPointer<FilterBank> newBank(FilterBank::create(singlePrecision));
+
+    for (int n = 0; n < lowCuts.size(); n++)
+        newBank->setBand(n, FilterBankKey(2, getSampleRate(), lowCuts[n], highCuts[n]));
+
+    {
+        const ScopedLock sl(filterBankLock);
+
+        filterBank.swapWith(newBank);
+        useSinglePrecision = singlePrecision;
+    }
+
+    // the old bank is deleted here, after process() can no longer reach it
+
+    std::cout << "Filters now use " << (useSinglePrecision ? "single" : "double")
+              << " precision." << std::endl;
+}
+
 void FilterNode::updateSettings()
 {
 
-    if (getNumInputs() < 1024 && getNumInputs() != filters.size())
+    if (getNumInputs() != filterBank->getNumChannels())
     {
 
-        filters.clear();
+        filterBank->clear();
         lowCuts.clear();
         highCuts.clear();
 
@@ -139,13 +166,6 @@ void FilterNode::updateSettings()
 
             // std::cout << "Creating filter number " << n << std::endl;
 
-            filters.add(new Dsp::SmoothedFilterDesign
-                        <Dsp::Butterworth::Design::BandPass 	// design type
-                        <3>,								 	// order
-                        1,										// number of channels (must be const)
-                        Dsp::DirectFormII>						// realization
-                        (1));
-
 
             //Parameter& p1 =  parameters.getReference(0);
             //p1.setValue(600.0f, n);
@@ -188,14 +208,8 @@ double FilterNode::getHighCutValueForChannel(int chan)
 void FilterNode::setFilterParameters(double lowCut, double highCut, int chan)
 {
 
-    Dsp::Params params;
-    params[0] = getSampleRate(); // sample rate
-    params[1] = 2; // order
-    params[2] = (highCut + lowCut)/2; // center frequency
-    params[3] = highCut - lowCut; // bandwidth
-
-    if (filters.size() > chan)
-        filters[chan]->setParams(params);
+    // channels with the same band share one design
+    filterBank->setBand(chan, FilterBankKey(2, getSampleRate(), lowCut, highCut));
 
 }
 
@@ -255,11 +269,12 @@ void FilterNode::process(AudioSampleBuffer& buffer,
                          int& nSamples)
 {
 
-    for (int n = 0; n < getNumOutputs(); n++)
-    {
-        float* ptr = buffer.getSampleData(n);
-        filters[n]->process(nSamples, &ptr);
-    }
+    // only held while setSinglePrecision() swaps the bank; the block then
+    // passes through unfiltered
+    const ScopedTryLock sl(filterBankLock);
+
+    if (sl.isLocked())
+        filterBank->process(buffer, nSamples);
 
 }
 
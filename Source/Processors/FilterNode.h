@@ -27,12 +27,17 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "../Dsp/Dsp.h"
 #include "GenericProcessor.h"
+#include "FilterBank.h"
 
 /**
 
-  Filters data using a filter from the DSP library.
+  Filters data using a filter from the DSP library. Channels with the
+  same cutoffs share one design (see FilterBank).
 
-  The user can select the low- and high-frequency cutoffs.
+  The user can select the low- and high-frequency cutoffs, and whether
+  the filters run in single precision (transposed direct form II with
+  float state), which is accurate for spike-band filters but not for
+  cutoffs of a few Hz.
 
   @see GenericProcessor, FilterEditor
 
@@ -61,6 +66,16 @@ public:
 
     void updateSettings();
 
+    /** Switches all channels between double- and single-precision filters.
+        The new bank is built first and then swapped in under filterBankLock,
+        so this is safe during acquisition, but the filters restart from rest. */
+    void setSinglePrecision(bool singlePrecision);
+
+    bool isSinglePrecision()
+    {
+        return useSinglePrecision;
+    }
+
     void saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel);
 
     void loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel);
@@ -68,11 +83,16 @@ public:
 private:
 
     Array<double> lowCuts, highCuts;
-    OwnedArray<Dsp::Filter> filters;
+    ScopedPointer<FilterBank> filterBank;
+
+    /** Held by setSinglePrecision() while it swaps filterBank; process() only tries it. */
+    CriticalSection filterBankLock;
 
     double defaultLowCut;
     double defaultHighCut;
 
+    bool useSinglePrecision;
+
     void setFilterParameters(double, double, int);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterNode);
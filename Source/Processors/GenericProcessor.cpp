@@ -22,12 +22,14 @@
 */
 
 #include "GenericProcessor.h"
+#include "DeadlineMonitor.h"
+#include "LatencyMonitor.h"
 #include "../UI/UIComponent.h"
 
 GenericProcessor::GenericProcessor(const String& name_) : AccessClass(),
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
-     parametersAsXml(nullptr),  name(name_), paramsWereLoaded(false)
+     parametersAsXml(nullptr), latencyStage(nullptr), deadlineMonitor(nullptr), channelsPermuted(false), name(name_), paramsWereLoaded(false)
 {
 }
 
@@ -486,6 +488,7 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
                                 uint8* eventData)
 {
     uint8* data = new uint8[4+numBytes];
+    profile.allocationMade();
 
     data[0] = type;    // event type
     data[1] = nodeId;  // processor ID automatically added
@@ -512,14 +515,38 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
 
+    const int64 startTicks = Time::getHighResolutionTicks();
+
     int nSamples = getNumSamples(eventBuffer); // finds buffer size and sets save
                                                // flag on all TTL events to zero
 
-    process(buffer, eventBuffer, nSamples);
+    if (deadlineMonitor != nullptr
+        && getPriorityClass() == BEST_EFFORT_PRIORITY
+        && deadlineMonitor->isLate())
+    {
+        skipBlock(buffer, eventBuffer, nSamples);
+
+        deadlineMonitor->workSkipped();
+        profile.blockSkipped();
+    }
+    else
+    {
+        process(buffer, eventBuffer, nSamples);
+
+        if (deadlineMonitor != nullptr
+            && getPriorityClass() == HIGH_PRIORITY
+            && deadlineMonitor->isLate())
+            deadlineMonitor->finishedLate();
+    }
+
+    if (latencyStage != nullptr)
+        latencyStage->blockProcessed(eventBuffer, nSamples);
 
     setNumSamples(eventBuffer, nSamples); // adds it back,
     // even if it's unchanged
 
+    profile.blockProcessed(nSamples, Time::getHighResolutionTicks() - startTicks);
+
 }
 
 
@@ -533,6 +560,16 @@ void GenericProcessor::saveToXml(XmlElement* parentElement)
 
     saveCustomParametersToXml(parentElement);
 
+    // the selection state of all channels is stored as three bitmaps
+    BigInteger p, r, a;
+    getEditor()->getChannelSelectionStates(p, r, a);
+
+    XmlElement* channelStates = parentElement->createNewChildElement("CHANNELSTATES");
+    channelStates->setAttribute("count", channels.size());
+    channelStates->setAttribute("param", p.toString(16));
+    channelStates->setAttribute("record", r.toString(16));
+    channelStates->setAttribute("audio", a.toString(16));
+
     // loop through the channels
 
     for (int i = 0; i < channels.size(); i++)
@@ -570,34 +607,18 @@ void GenericProcessor::saveCustomParametersToXml(XmlElement* parentElement)
 void GenericProcessor::saveChannelParametersToXml(XmlElement* parentElement, int channelNumber, bool isEventChannel)
 {
 
-    if (!isEventChannel)
-    {
-        XmlElement* channelInfo = parentElement->createNewChildElement("CHANNEL");
-        channelInfo->setAttribute("name", String(channelNumber));
-        channelInfo->setAttribute("number", channelNumber);
+    // selection states are saved in bulk by saveToXml(), so a channel only
+    // gets its own element if the processor has something to add to it
+    XmlElement* channelInfo = new XmlElement(isEventChannel ? "EVENTCHANNEL" : "CHANNEL");
+    channelInfo->setAttribute("name", String(channelNumber));
+    channelInfo->setAttribute("number", channelNumber);
 
-        bool p, r, a;
+    saveCustomChannelParametersToXml(channelInfo, channelNumber, isEventChannel);
 
-        getEditor()->getChannelSelectionState(channelNumber, &p, &r, &a);
-
-        XmlElement* selectionState = channelInfo->createNewChildElement("SELECTIONSTATE");
-        selectionState->setAttribute("param",p);
-        selectionState->setAttribute("record",r);
-        selectionState->setAttribute("audio",a);
-
-        saveCustomChannelParametersToXml(channelInfo, channelNumber);
-
-    }
+    if (channelInfo->getNumChildElements() > 0 || channelInfo->getNumAttributes() > 2)
+        parentElement->addChildElement(channelInfo);
     else
-    {
-
-        XmlElement* channelInfo = parentElement->createNewChildElement("EVENTCHANNEL");
-        channelInfo->setAttribute("name", String(channelNumber));
-        channelInfo->setAttribute("number", channelNumber);
-
-        saveCustomChannelParametersToXml(channelInfo, channelNumber, true);
-
-    }
+        delete channelInfo;
 
     // deprecated parameter configuration:
     //std::cout <<"Creating Parameters" << std::endl;
@@ -654,6 +675,16 @@ void GenericProcessor::loadFromXml()
                     loadChannelParametersFromXml(xmlNode, true);
 
                 }
+                else if (xmlNode->hasTagName("CHANNELSTATES"))
+                {
+                    BigInteger p, r, a;
+
+                    p.parseString(xmlNode->getStringAttribute("param"), 16);
+                    r.parseString(xmlNode->getStringAttribute("record"), 16);
+                    a.parseString(xmlNode->getStringAttribute("audio"), 16);
+
+                    getEditor()->setChannelSelectionStates(p, r, a);
+                }
                 else if (xmlNode->hasTagName("EDITOR"))
                 {
                     getEditor()->loadEditorParameters(xmlNode);
@@ -28,6 +28,7 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "Editors/GenericEditor.h"
 #include "Parameter.h"
+#include "ProcessorProfile.h"
 #include "../AccessClass.h"
 
 #include <time.h>
@@ -39,6 +40,8 @@ class UIComponent;
 class GenericEditor;
 class Parameter;
 class Channel;
+class LatencyStage;
+class DeadlineMonitor;
 
 /**
 
@@ -241,6 +244,14 @@ public:
                          MidiBuffer& eventBuffer,
                          int& nSamples) = 0;
 
+    /** Called instead of process() when the DeadlineMonitor decides that a
+        best-effort processor must skip a late block. Processors whose output
+        would otherwise be left undefined (e.g. the AudioNode) should
+        override this to leave the buffer in a harmless state.*/
+    virtual void skipBlock(AudioSampleBuffer& continuousBuffer,
+                           MidiBuffer& eventBuffer,
+                           int& nSamples) { }
+
     /** Pointer to a processor's immediate source node.*/
     GenericProcessor* sourceNode;
 
@@ -370,6 +381,49 @@ public:
         return false;
     }
 
+    /** Returns true if a processor never writes to its continuous channels (it
+        may still read them and add events). The ParallelGraphRenderer can
+        then hand it a view of its source's buffer instead of a copy.
+
+        Sinks and utilities are pass-through by default; other processors
+        that only read their input should override this.*/
+    virtual bool isPassThrough()
+    {
+        return isSink() || isSplitter() || isMerger() || isUtility();
+    }
+
+    /** Processors whose output is only a selection and reordering of their
+        input channels (no arithmetic) can return true and set
+        sourceChannels[i] to the input channel that output channel i comes
+        from (-1 for silence). The ParallelGraphRenderer then points the
+        processor's buffer at its source's channels in that order instead of
+        copying them, and sets channelsPermuted for the block so that
+        process() leaves the data alone.
+
+        Called on the audio thread before every block; sourceChannels has
+        room for numChannels entries.*/
+    virtual bool getChannelPermutation(int numChannels, Array<int>& sourceChannels)
+    {
+        return false;
+    }
+
+    enum priorityClasses
+    {
+        CRITICAL_PRIORITY = 0,
+        HIGH_PRIORITY = 1,
+        BEST_EFFORT_PRIORITY = 2
+    };
+
+    /** Returns how important it is for this processor to see every block.
+
+        Critical processors (sources and the RecordNode) and high-priority
+        processors always run. Best-effort processors (displays and audio)
+        may be skipped by the DeadlineMonitor when a callback runs late.*/
+    virtual int getPriorityClass()
+    {
+        return isSource() ? CRITICAL_PRIORITY : HIGH_PRIORITY;
+    }
+
     /** Returns true if a processor is able to send its output to a given processor.
 
         Ideally, this should always return true, but there may be special cases
@@ -579,6 +633,24 @@ public:
     /** Holds loaded parameters */
     XmlElement* parametersAsXml;
 
+    /** Records how long TTL events take to reach this processor (null unless
+        the ProcessorGraph's LatencyMonitor is enabled). */
+    LatencyStage* latencyStage;
+
+    /** Decides whether best-effort work should be skipped (null unless the
+        ProcessorGraph's DeadlineMonitor is enabled). */
+    DeadlineMonitor* deadlineMonitor;
+
+    /** True while processing a block whose channels have already been
+        reordered by the ParallelGraphRenderer (see getChannelPermutation()). */
+    bool channelsPermuted;
+
+    /** Returns the timing and allocation counters for this processor. */
+    ProcessorProfile* getProfile()
+    {
+        return &profile;
+    }
+
 private:
 
     /** Automatically extracts the number of samples in the buffer, then
@@ -588,6 +660,9 @@ private:
     /** The name of the processor.*/
     const String name;
 
+    /** Updated by processBlock() and addEvent(). */
+    ProcessorProfile profile;
+
     /** Saves the record status of individual channels, even when other parameters are updated. */
     Array<bool> recordStatus;
 
@@ -0,0 +1,240 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LatencyMonitor.h"
+#include "GenericProcessor.h"
+
+#include <math.h>
+
+// 4 bins per octave, starting at 1 us
+#define BINS_PER_OCTAVE 4
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < numBins; i++)
+        bins[i] = 0;
+
+    count = 0;
+    sum = 0.0;
+    maxValue = 0.0;
+}
+
+void LatencyHistogram::addSample(double microseconds)
+{
+    int bin = 0;
+
+    if (microseconds > 1.0)
+        bin = jmin(int(log(microseconds) / log(2.0) * BINS_PER_OCTAVE), numBins - 1);
+
+    bins[bin]++;
+    count++;
+    sum += microseconds;
+
+    if (microseconds > maxValue)
+        maxValue = microseconds;
+}
+
+double LatencyHistogram::getMean() const
+{
+    if (count == 0)
+        return 0.0;
+
+    return sum / double(count);
+}
+
+double LatencyHistogram::getBinEdge(int bin)
+{
+    return pow(2.0, double(bin) / BINS_PER_OCTAVE);
+}
+
+double LatencyHistogram::getPercentile(double percentile) const
+{
+    if (count == 0)
+        return 0.0;
+
+    const int64 target = jmax((int64) 1, (int64) ceil(percentile / 100.0 * double(count)));
+
+    int64 cumulative = 0;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        cumulative += bins[i];
+
+        if (cumulative >= target)
+        {
+            // geometric centre of the bin, but never above the true maximum
+            return jmin(sqrt(getBinEdge(i) * getBinEdge(i + 1)), maxValue);
+        }
+    }
+
+    return maxValue;
+}
+
+LatencyStage::LatencyStage(LatencyMonitor* monitor_, GenericProcessor* processor)
+    : monitor(monitor_)
+{
+    name = processor->getName();
+    nodeId = processor->getNodeId();
+    sampleRate = processor->getSampleRate();
+    sourceStage = processor->isSource();
+    sinkStage = processor->isSink();
+}
+
+void LatencyStage::blockProcessed(MidiBuffer& events, int nSamples)
+{
+    if (events.getNumEvents() == 0)
+        return;
+
+    const double elapsed = monitor->getMicrosecondsSinceBlockStart();
+
+    bool foundTtl = false;
+
+    MidiBuffer::Iterator i(events);
+
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        if (*dataptr == GenericProcessor::TTL)
+        {
+            foundTtl = true;
+
+            if (sourceStage || sinkStage)
+            {
+                // the event happened (nSamples - samplePosition) samples before
+                // the block was handed to the ProcessorGraph
+                double delay = 0.0;
+
+                if (sampleRate > 0 && samplePosition < nSamples)
+                    delay = double(nSamples - samplePosition) / sampleRate * 1.0e6;
+
+                if (sourceStage)
+                    buffering.addSample(delay);
+
+                if (sinkStage)
+                    endToEnd.addSample(delay + elapsed);
+            }
+        }
+    }
+
+    if (foundTtl)
+        processing.addSample(elapsed);
+}
+
+LatencyMonitor::LatencyMonitor() : enabled(false), blockStartTicks(0), numBlocks(0)
+{
+
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+
+}
+
+void LatencyMonitor::clear()
+{
+    stages.clear();
+    numBlocks = 0;
+    blockStartTicks = Time::getHighResolutionTicks();
+}
+
+LatencyStage* LatencyMonitor::addStage(GenericProcessor* processor)
+{
+    LatencyStage* stage = new LatencyStage(this, processor);
+    stages.add(stage);
+
+    return stage;
+}
+
+static void writeHistogramLine(OutputStream& stream, const String& stageName,
+                               const String& measure, const LatencyHistogram& h)
+{
+    if (h.getCount() == 0)
+        return;
+
+    stream << stageName.paddedRight(' ', 28)
+           << measure.paddedRight(' ', 14)
+           << String(h.getCount()).paddedLeft(' ', 10)
+           << String(h.getPercentile(50.0), 1).paddedLeft(' ', 12)
+           << String(h.getPercentile(99.0), 1).paddedLeft(' ', 12)
+           << String(h.getMax(), 1).paddedLeft(' ', 12)
+           << newLine;
+}
+
+static void writeHistogramBins(OutputStream& stream, const LatencyHistogram& h)
+{
+    if (h.getCount() == 0)
+        return;
+
+    for (int i = 0; i < LatencyHistogram::numBins; i++)
+    {
+        if (h.getBinCount(i) > 0)
+        {
+            stream << "        " << String(LatencyHistogram::getBinEdge(i), 1).paddedLeft(' ', 12)
+                   << " us  " << String(h.getBinCount(i)) << newLine;
+        }
+    }
+}
+
+void LatencyMonitor::writeReport(OutputStream& stream, bool includeHistograms)
+{
+    stream << "Latency report (" << String(numBlocks) << " callbacks, times in us)" << newLine;
+
+    stream << String("stage").paddedRight(' ', 28)
+           << String("measure").paddedRight(' ', 14)
+           << String("count").paddedLeft(' ', 10)
+           << String("p50").paddedLeft(' ', 12)
+           << String("p99").paddedLeft(' ', 12)
+           << String("max").paddedLeft(' ', 12)
+           << newLine;
+
+    for (int i = 0; i < stages.size(); i++)
+    {
+        LatencyStage* s = stages[i];
+        String stageName = s->getName() + " (" + String(s->getNodeId()) + ")";
+
+        writeHistogramLine(stream, stageName, "buffering", s->buffering);
+        writeHistogramLine(stream, stageName, "processing", s->processing);
+        writeHistogramLine(stream, stageName, "end-to-end", s->endToEnd);
+
+        if (includeHistograms)
+        {
+            writeHistogramBins(stream, s->endToEnd);
+        }
+    }
+}
+
+void LatencyMonitor::printReport()
+{
+    MemoryOutputStream report;
+    writeReport(report, true);
+
+    std::cout << report.toString() << std::endl;
+}
@@ -0,0 +1,237 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __LATENCYMONITOR_H_5A1C94E2__
+#define __LATENCYMONITOR_H_5A1C94E2__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+#include <stdio.h>
+
+class GenericProcessor;
+class LatencyMonitor;
+
+/**
+
+  Log-spaced histogram of durations, in microseconds.
+
+  Bins are spaced by a quarter octave from 1 us to roughly 16 s, so the
+  memory footprint is fixed no matter how long acquisition runs. Only
+  one thread (the audio thread) may call addSample(); the statistics can
+  be read from the message thread at any time, at the cost of being
+  one or two samples out of date.
+
+  @see LatencyMonitor
+
+*/
+
+class LatencyHistogram
+{
+public:
+
+    LatencyHistogram();
+
+    /** Adds a duration (in microseconds) to the histogram. */
+    void addSample(double microseconds);
+
+    /** Clears all counts. */
+    void reset();
+
+    /** Returns the number of samples added since the last reset. */
+    int64 getCount() const
+    {
+        return count;
+    }
+
+    /** Returns the largest duration seen since the last reset. */
+    double getMax() const
+    {
+        return maxValue;
+    }
+
+    /** Returns the mean duration since the last reset. */
+    double getMean() const;
+
+    /** Returns an estimate of the given percentile (0-100), accurate to
+        within the width of one bin (~19%). */
+    double getPercentile(double percentile) const;
+
+    /** Returns the lower edge (in microseconds) of a given bin. */
+    static double getBinEdge(int bin);
+
+    enum { numBins = 96 };
+
+    /** Returns the number of samples in a given bin. */
+    int64 getBinCount(int bin) const
+    {
+        return bins[bin];
+    }
+
+private:
+
+    int64 bins[numBins];
+    int64 count;
+    double sum;
+    double maxValue;
+
+};
+
+/**
+
+  Timing information for one processor boundary in the signal chain.
+
+  Each GenericProcessor holds a pointer to a LatencyStage while the
+  LatencyMonitor is enabled. At the end of every processBlock() call, the stage
+  records how long it has been since the ProcessorGraph callback began,
+  but only for blocks that contain TTL events, so the histograms describe
+  how quickly an event travels through the chain rather than the cost of
+  empty blocks.
+
+  @see LatencyMonitor, GenericProcessor
+
+*/
+
+class LatencyStage
+{
+public:
+
+    LatencyStage(LatencyMonitor* monitor, GenericProcessor* processor);
+
+    /** Called by GenericProcessor::processBlock() after process() returns. */
+    void blockProcessed(MidiBuffer& events, int nSamples);
+
+    /** Returns the name of the processor this stage belongs to. */
+    const String& getName() const
+    {
+        return name;
+    }
+
+    /** Returns the node ID of the processor this stage belongs to. */
+    int getNodeId() const
+    {
+        return nodeId;
+    }
+
+    /** Time from the start of the callback to the end of this processor's
+        process() method, for blocks carrying TTL events. */
+    LatencyHistogram processing;
+
+    /** Time between an event's sample position and the end of the block
+        (sources only), i.e. the delay introduced by buffering. */
+    LatencyHistogram buffering;
+
+    /** Buffering delay plus processing time for each TTL event that reaches
+        a sink (e.g. ArduinoOutput, PulsePalOutput, FPGAOutput). */
+    LatencyHistogram endToEnd;
+
+private:
+
+    LatencyMonitor* monitor;
+
+    String name;
+    int nodeId;
+    float sampleRate;
+    bool sourceStage;
+    bool sinkStage;
+
+};
+
+/**
+
+  Measures how long TTL events take to pass through the signal chain.
+
+  For closed-loop experiments, the quantity of interest is the time between
+  a TTL arriving at a source (SourceNode, or the Event Generator when testing
+  without hardware) and the moment an output processor acts on it. When the
+  monitor is enabled (View > Latency monitor), the ProcessorGraph stamps the
+  start of every callback with a high-resolution clock, and each processor
+  records the time at which it finished a block containing TTL events.
+
+  The per-stage histograms are cleared when acquisition starts and printed
+  (p50/p99/max) when acquisition stops.
+
+  @see LatencyStage, ProcessorGraph, GenericProcessor
+
+*/
+
+class LatencyMonitor
+{
+public:
+
+    LatencyMonitor();
+    ~LatencyMonitor();
+
+    /** Turns latency measurements on or off. Takes effect at the start of
+        the next acquisition. */
+    void setEnabled(bool t)
+    {
+        enabled = t;
+    }
+
+    /** Returns true if latency measurements are turned on. */
+    bool isEnabled()
+    {
+        return enabled;
+    }
+
+    /** Removes all stages; called before acquisition starts. */
+    void clear();
+
+    /** Creates a stage for a given processor (message thread only). */
+    LatencyStage* addStage(GenericProcessor* processor);
+
+    /** Called by the ProcessorGraph at the start of each callback. */
+    void beginBlock()
+    {
+        blockStartTicks = Time::getHighResolutionTicks();
+        numBlocks++;
+    }
+
+    /** Returns the number of microseconds since the current callback began. */
+    double getMicrosecondsSinceBlockStart() const
+    {
+        return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks()
+                                                  - blockStartTicks) * 1.0e6;
+    }
+
+    /** Writes a summary of all stages to a stream. */
+    void writeReport(OutputStream& stream, bool includeHistograms);
+
+    /** Prints a summary of all stages to the console. */
+    void printReport();
+
+private:
+
+    bool enabled;
+
+    int64 blockStartTicks;
+    int64 numBlocks;
+
+    OwnedArray<LatencyStage> stages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyMonitor);
+
+};
+
+
+#endif  // __LATENCYMONITOR_H_5A1C94E2__
@@ -55,6 +55,14 @@ public:
         return true;
     }
 
+    /** Skipping a late block leaves it out of the trace: the next block is
+        drawn straight after the previous one, so the sweep falls behind by
+        that many samples, and TTLs in the skipped block are not shown. */
+    int getPriorityClass()
+    {
+        return BEST_EFFORT_PRIORITY;
+    }
+
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
 
     void setParameter(int, float);
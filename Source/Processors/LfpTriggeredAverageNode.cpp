@@ -25,21 +25,178 @@
 #include "Visualization/LfpTriggeredAverageCanvas.h"
 #include <stdio.h>
 
+TrialAverage::TrialAverage()
+    : numChannels(0), numSamples(0), capacity(0),
+      numTrials(0), totalTrials(0), nextSlot(0),
+      store(1, 1), scratch(1, 1)
+{
+
+}
+
+void TrialAverage::setSize(int numChannels_, int numSamples_, int maxTrials)
+{
+    numChannels = jmax(1, numChannels_);
+    numSamples = jmax(1, numSamples_);
+
+    capacity = jlimit(0, maxTrials, int(maxStoredSamples / (int64(numChannels) * numSamples)));
+
+    mean.malloc(numChannels * numSamples);
+    sumOfSquares.malloc(numChannels * numSamples);
+
+    if (capacity > 0)
+        store.setSize(numChannels * capacity, numSamples);
+    else
+        store.setSize(1, 1);
+
+    scratch.setSize(numChannels, numSamples);
+
+    reset();
+}
+
+void TrialAverage::reset()
+{
+    numTrials = 0;
+    totalTrials = 0;
+    nextSlot = 0;
+
+    clearAccumulators();
+}
+
+void TrialAverage::clearAccumulators()
+{
+    if (mean != nullptr)
+    {
+        zeromem(mean, sizeof(double) * numChannels * numSamples);
+        zeromem(sumOfSquares, sizeof(double) * numChannels * numSamples);
+    }
+}
+
+void TrialAverage::copyTrial(const AudioSampleBuffer& ringBuffer, int startSample,
+                             AudioSampleBuffer& dest, int destChannelOffset)
+{
+    const int ringSize = ringBuffer.getNumSamples();
+    const int firstBlock = jmin(numSamples, ringSize - startSample);
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        dest.copyFrom(destChannelOffset + chan, 0, ringBuffer, chan, startSample, firstBlock);
+
+        if (firstBlock < numSamples)
+            dest.copyFrom(destChannelOffset + chan, firstBlock, ringBuffer, chan, 0, numSamples - firstBlock);
+    }
+}
+
+void TrialAverage::includeTrial(AudioSampleBuffer& source, int channelOffset)
+{
+    numTrials++;
+
+    const double n = double(numTrials);
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        const float* x = source.getSampleData(channelOffset + chan);
+        double* m = mean + chan * numSamples;
+        double* s = sumOfSquares + chan * numSamples;
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            const double delta = x[i] - m[i];
+            m[i] += delta / n;
+            s[i] += delta * (x[i] - m[i]);
+        }
+    }
+}
+
+void TrialAverage::excludeTrial(AudioSampleBuffer& source, int channelOffset)
+{
+    if (numTrials <= 1)
+    {
+        numTrials = 0;
+        clearAccumulators();
+        return;
+    }
+
+    numTrials--;
+
+    const double n = double(numTrials);
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        const float* x = source.getSampleData(channelOffset + chan);
+        double* m = mean + chan * numSamples;
+        double* s = sumOfSquares + chan * numSamples;
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            const double oldMean = m[i];
+            m[i] = oldMean - (x[i] - oldMean) / n;
+            s[i] = jmax(0.0, s[i] - (x[i] - m[i]) * (x[i] - oldMean));
+        }
+    }
+}
+
+void TrialAverage::addTrial(const AudioSampleBuffer& ringBuffer, int startSample)
+{
+    totalTrials++;
+
+    if (capacity == 0)
+    {
+        copyTrial(ringBuffer, startSample, scratch, 0);
+        includeTrial(scratch, 0);
+        return;
+    }
+
+    const int offset = nextSlot * numChannels;
+
+    if (numTrials == capacity)
+        excludeTrial(store, offset); // oldest trial
+
+    copyTrial(ringBuffer, startSample, store, offset);
+    includeTrial(store, offset);
+
+    nextSlot = (nextSlot + 1) % capacity;
+}
+
+void TrialAverage::getAccumulators(AudioSampleBuffer& meanDest, AudioSampleBuffer& squaresDest) const
+{
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        const double* m = mean + chan * numSamples;
+        const double* s = sumOfSquares + chan * numSamples;
+
+        float* md = meanDest.getSampleData(chan);
+        float* sd = squaresDest.getSampleData(chan);
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            md[i] = float(m[i]);
+            sd[i] = float(s[i]);
+        }
+    }
+}
+
+void TrialAverage::getConfidenceInterval(AudioSampleBuffer& squares, int numTrials)
+{
+    const float scale = (numTrials > 1) ? float(1.0 / (double(numTrials - 1) * double(numTrials))) : 0.0f;
+
+    for (int chan = 0; chan < squares.getNumChannels(); chan++)
+    {
+        float* s = squares.getSampleData(chan);
+
+        for (int i = 0; i < squares.getNumSamples(); i++)
+            s[i] = 1.96f * sqrt(s[i] * scale);
+    }
+}
+
 LfpTriggeredAverageNode::LfpTriggeredAverageNode()
     : GenericProcessor("LFP Trig. Avg."),
-      displayBufferIndex(0), displayGain(1), bufferLength(5.0f),
-      abstractFifo(100), ttlState(0)
+      bufferLength(5.0f), windowLength(1.0f), windowSamples(0),
+      samplesWritten(0), gapEnd(0), numPendingTriggers(0), samplesMissed(0)
 {
     std::cout << " LfpTriggeredAverageNode Constructor" << std::endl;
     displayBuffer = new AudioSampleBuffer(8, 100);
-    eventBuffer = new MidiBuffer();
 
-    arrayOfOnes = new float[5000];
-
-    for (int n = 0; n < 5000; n++)
-    {
-        arrayOfOnes[n] = 1;
-    }
+    triggerMask = 1; // TTL channel 1
 
 }
 
@@ -63,15 +220,27 @@ void LfpTriggeredAverageNode::updateSettings()
 
 bool LfpTriggeredAverageNode::resizeBuffer()
 {
-    int nSamples = (int) getSampleRate()*bufferLength;
+    int nWindow = (int) (getSampleRate()*windowLength);
+    int nSamples = (int) (getSampleRate()*bufferLength) + nWindow;
     int nInputs = getNumInputs();
 
     std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
 
-    if (nSamples > 0 && nInputs > 0)
+    if (nWindow > 0 && nInputs > 0)
     {
-        abstractFifo.setTotalSize(nSamples);
-        displayBuffer->setSize(nInputs+1, nSamples); // add an extra channel for TTLs
+        const ScopedLock sl(averageLock);
+
+        displayBuffer->setSize(nInputs, nSamples);
+        displayBuffer->clear();
+
+        windowSamples = nWindow;
+        average.setSize(nInputs, nWindow, 100);
+
+        samplesWritten = 0;
+        gapEnd = 0;
+        numPendingTriggers = 0;
+        samplesMissed = 0;
+
         return true;
     }
     else
@@ -104,6 +273,60 @@ bool LfpTriggeredAverageNode::disable()
     return true;
 }
 
+void LfpTriggeredAverageNode::setWindowLength(float seconds)
+{
+    windowLength = seconds;
+
+    if (getNumInputs() > 0 && getSampleRate() > 0)
+        resizeBuffer();
+}
+
+void LfpTriggeredAverageNode::resetAverage()
+{
+    const ScopedLock sl(averageLock);
+
+    average.reset();
+    numPendingTriggers = 0;
+}
+
+int64 LfpTriggeredAverageNode::getAverage(AudioSampleBuffer& mean, AudioSampleBuffer& interval,
+                                          int64 lastTotalTrials, int& numTrials)
+{
+    int64 totalTrials;
+
+    {
+        const ScopedLock sl(averageLock);
+
+        totalTrials = average.getTotalTrials();
+        numTrials = average.getNumTrials();
+
+        const int nChans = displayBuffer->getNumChannels();
+        const int nSamples = average.getNumSamples();
+
+        if (mean.getNumChannels() != nChans || mean.getNumSamples() != nSamples)
+        {
+            mean.setSize(nChans, nSamples);
+            interval.setSize(nChans, nSamples);
+            mean.clear();
+            interval.clear();
+        }
+        else if (totalTrials == lastTotalTrials)
+        {
+            return totalTrials;
+        }
+
+        if (windowSamples == 0)
+            return totalTrials;
+
+        average.getAccumulators(mean, interval);
+    }
+
+    // the square roots are taken after the audio thread has the lock back
+    TrialAverage::getConfidenceInterval(interval, numTrials);
+
+    return totalTrials;
+}
+
 void LfpTriggeredAverageNode::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -128,178 +351,117 @@ void LfpTriggeredAverageNode::handleEvent(int eventType, MidiMessage& event, int
         // int eventNodeId = *(dataptr+1);
         int eventId = *(dataptr+2);
         int eventChannel = *(dataptr+3);
-        int eventTime = event.getTimeStamp();
-
-        int samplesLeft = totalSamples - eventTime;
-
-        //	std::cout << "Received event from " << eventNodeId << ", channel "
-        //	          << eventChannel << ", with ID " << eventId << std::endl;
-        //
-        int bufferIndex = (displayBufferIndex + eventTime);// % displayBuffer->getNumSamples();
-
-        if (eventId == 1)
-        {
-            ttlState |= (1L << eventChannel);
-        }
-        else
-        {
-            ttlState &= ~(1L << eventChannel);
-        }
-
-        if (samplesLeft + bufferIndex < displayBuffer->getNumSamples())
-        {
-
-            //	std::cout << bufferIndex << " " << samplesLeft << " " << ttlState << std::endl;
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    samplesLeft, 		// numSamples
-                                    float(ttlState));   // gain
-        }
-        else
+        // rising edges on the selected channels start a trial
+        if (eventId == 1 &&
+            eventChannel < 32 &&
+            (triggerMask.get() & (1 << eventChannel)) &&
+            numPendingTriggers < maxPendingTriggers)
         {
-
-            int block2Size = (samplesLeft + bufferIndex) % displayBuffer->getNumSamples();
-            int block1Size = samplesLeft - block2Size;
-
-            //std::cout << "OVERFLOW." << std::endl;
-
-            //std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
-
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block1Size, 		// numSamples
-                                    float(ttlState));   // gain
-
-            //std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
-
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    0,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block2Size, 		// numSamples
-                                    float(ttlState));   // gain
-
-
+            pendingTriggers[numPendingTriggers++] = samplesWritten + sampleNum;
         }
 
-
-        // 	std::cout << "ttlState: " << ttlState << std::endl;
-
-        // std::cout << "Received event from " << eventNodeId <<
-        //              " on channel " << eventChannel <<
-        //             " with value " << eventId <<
-        //             " at timestamp " << event.getTimeStamp() << std::endl;
-
-
     }
-    else if (eventType == TIMESTAMP)
-    {
-
-        const uint8* dataptr = event.getRawData();
-
-        // int eventNodeId = *(dataptr+1);
-        // int eventId = *(dataptr+2);
-        // int eventChannel = *(dataptr+3);
-
-        // update the timestamp for the current buffer:
-        memcpy(&bufferTimestamp, dataptr+4, 4);
+}
 
+void LfpTriggeredAverageNode::processPendingTriggers()
+{
+    const int64 ringSize = displayBuffer->getNumSamples();
+    const int64 preSamples = windowSamples / 2;
 
+    for (int i = 0; i < numPendingTriggers; i++)
+    {
+        const int64 start = pendingTriggers[i] - preSamples;
 
-        //   	double timeInSeconds = double(ts)/Time::getHighResolutionTicksPerSecond();
-        //   	//int64 timestamp = ts[0] << 32 +
-        //   	//				  ts[1] << 16 +
-        //   	//				  ts[2] << 8 +
-        //   	//				  ts[3];
-        //   	//memcpy(ts, dataptr+4, 1);
+        if (start + windowSamples > samplesWritten)
+            continue; // post-trigger data not complete yet
 
-        //   	std::cout << "Time in seconds is " << timeInSeconds << std::endl;
+        // the start of the window may fall before the beginning of
+        // acquisition or a skipped block, or may already have been overwritten
+        if (start >= gapEnd && start >= samplesWritten - ringSize)
+            average.addTrial(*displayBuffer, int(start % ringSize));
 
-        // // std::cout << "Received event from " << eventNodeId <<
-        //    	//              " on channel " << eventChannel <<
-        //    	 //             " with value " << eventId <<
-        //    	 //             " for time: " << ts << std::endl;
+        pendingTriggers[i--] = pendingTriggers[--numPendingTriggers];
     }
 }
 
-void LfpTriggeredAverageNode::initializeEventChannel()
+void LfpTriggeredAverageNode::skipSamples(int numSamples)
 {
-    if (displayBufferIndex + totalSamples < displayBuffer->getNumSamples())
-    {
+    // the skipped triggers are not read, and every pending trial still
+    // waiting for data now overlaps the gap
+    samplesWritten += numSamples;
+    gapEnd = samplesWritten;
+    numPendingTriggers = 0;
+}
 
-        //	std::cout << getNumInputs()+1 << " " << displayBufferIndex << " " << totalSamples << " " << ttlState << std::endl;
-        //
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                totalSamples, 		// numSamples
-                                float(ttlState));   // gain
-    }
-    else
-    {
+void LfpTriggeredAverageNode::skipBlock(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
+{
+    const ScopedTryLock sl(averageLock);
 
-        int block2Size = (displayBufferIndex + totalSamples) % displayBuffer->getNumSamples();
-        int block1Size = totalSamples - block2Size;
+    if (! sl.isLocked())
+    {
+        samplesMissed += nSamples;
+        return;
+    }
 
-        // std::cout << "OVERFLOW." << std::endl;
+    if (windowSamples == 0)
+        return;
 
-        // std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
+    skipSamples(nSamples + samplesMissed.exchange(0));
+}
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block1Size, 		// numSamples
-                                float(ttlState));   // gain
-        // std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
+void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
+{
+    // the message thread holds the lock while it resizes the buffers or
+    // copies the average out; this block is then treated as skipped
+    const ScopedTryLock sl(averageLock);
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                0,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block2Size, 		// numSamples
-                                float(ttlState));   // gain
+    if (! sl.isLocked())
+    {
+        samplesMissed += nSamples;
+        return;
+    }
 
+    if (windowSamples == 0)
+        return;
 
-    }
-}
+    const int missed = samplesMissed.exchange(0);
 
-void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
-{
-    // 1. place any new samples into the displayBuffer
-    //std::cout << "Display node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
+    if (missed > 0)
+        skipSamples(missed);
 
-    totalSamples = nSamples;
-    displayBufferIndexEvents = displayBufferIndex;
+    checkForEvents(events); // see if we got any triggers
 
-    initializeEventChannel();
+    // 1. place any new samples into the circular buffer
+    const int ringSize = displayBuffer->getNumSamples();
+    const int displayBufferIndex = int(samplesWritten % ringSize);
+    const int numChannels = jmin(buffer.getNumChannels(), displayBuffer->getNumChannels());
 
-    checkForEvents(events); // update timestamp, see if we got any TTL events
+    const int numSamples = jmin(nSamples, ringSize);
 
-    int samplesLeft = displayBuffer->getNumSamples() - displayBufferIndex;
+    int samplesLeft = ringSize - displayBufferIndex;
 
-    if (nSamples < samplesLeft)
+    if (numSamples < samplesLeft)
     {
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        for (int chan = 0; chan < numChannels; chan++)
         {
             displayBuffer->copyFrom(chan,  			// destChannel
                                     displayBufferIndex, // destStartSample
                                     buffer, 			// source
                                     chan, 				// source channel
                                     0,					// source start sample
-                                    nSamples); 			// numSamples
+                                    numSamples); 			// numSamples
 
         }
-        displayBufferIndex += (nSamples);
 
     }
     else
     {
 
-        int extraSamples = nSamples - samplesLeft;
+        int extraSamples = numSamples - samplesLeft;
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        for (int chan = 0; chan < numChannels; chan++)
         {
             displayBuffer->copyFrom(chan,  				// destChannel
                                     displayBufferIndex, // destStartSample
@@ -316,10 +478,11 @@ void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& eve
                                     extraSamples);
         }
 
-        displayBufferIndex = extraSamples;
     }
 
+    samplesWritten += numSamples;
 
+    // 2. average any triggers whose windows are now complete
+    processPendingTriggers();
 
 }
-
@@ -31,11 +31,123 @@
 
 class DataViewport;
 
+/**
+
+  Running mean and variance of a set of equal-length, multi-channel trials.
+
+  Statistics are updated incrementally (Welford's method), so adding a
+  trial costs O(channels x samples) and never allocates. Up to
+  getCapacity() trials are kept in a fixed-size store; once the store is
+  full, the oldest trial is removed from the statistics before the newest
+  is added, so the average follows the most recent trials. The
+  accumulators are kept in double precision, so the rounding error left
+  behind by the removals stays far below single-precision resolution and
+  the statistics never have to be rebuilt from the store.
+
+  If the store would exceed maxStoredSamples, its capacity is reduced (down
+  to zero, in which case all trials are averaged cumulatively).
+
+  @see LfpTriggeredAverageNode
+
+*/
+
+class TrialAverage
+{
+public:
+
+    TrialAverage();
+
+    /** Allocates the accumulators and trial store (not on the audio thread). */
+    void setSize(int numChannels, int numSamples, int maxTrials);
+
+    /** Discards all trials. */
+    void reset();
+
+    /** Adds a trial taken from a circular buffer, starting at startSample
+        (wrapping around the end of the buffer if necessary). */
+    void addTrial(const AudioSampleBuffer& ringBuffer, int startSample);
+
+    /** Returns the number of trials contributing to the average. */
+    int getNumTrials() const
+    {
+        return numTrials;
+    }
+
+    /** Returns the number of trials added since the last reset, including
+        those that have since been dropped from the store. */
+    int64 getTotalTrials() const
+    {
+        return totalTrials;
+    }
+
+    /** Returns the number of trials that can be stored. */
+    int getCapacity() const
+    {
+        return capacity;
+    }
+
+    int getNumSamples() const
+    {
+        return numSamples;
+    }
+
+    /** Copies the mean and the sums of squared deviations into two buffers.
+        This is only a copy, so it is cheap enough to do under a lock the
+        audio thread contends for; see getConfidenceInterval(). */
+    void getAccumulators(AudioSampleBuffer& meanDest, AudioSampleBuffer& squaresDest) const;
+
+    /** Turns the sums of squared deviations over numTrials trials, as returned
+        by getAccumulators(), into the half-width of the 95% confidence
+        interval (1.96 x standard error of the mean), in place. */
+    static void getConfidenceInterval(AudioSampleBuffer& squares, int numTrials);
+
+    enum { maxStoredSamples = 16 * 1024 * 1024 };
+
+private:
+
+    /** Copies a trial out of the circular buffer into dest. */
+    void copyTrial(const AudioSampleBuffer& ringBuffer, int startSample,
+                   AudioSampleBuffer& dest, int destChannelOffset);
+
+    void includeTrial(AudioSampleBuffer& source, int channelOffset);
+    void excludeTrial(AudioSampleBuffer& source, int channelOffset);
+
+    /** Zeroes the accumulators. */
+    void clearAccumulators();
+
+    int numChannels;
+    int numSamples;
+    int capacity;
+
+    int numTrials;
+    int64 totalTrials;
+    int nextSlot;
+
+    /** Channel c occupies [c * numSamples, (c+1) * numSamples). */
+    HeapBlock<double> mean;
+    HeapBlock<double> sumOfSquares; // sum of squared deviations from the mean
+
+    /** Trial i occupies channels [i * numChannels, (i+1) * numChannels). */
+    AudioSampleBuffer store;
+
+    /** Used instead of the store when the capacity is zero. */
+    AudioSampleBuffer scratch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrialAverage);
+
+};
+
 /**
 
   Displays the average of a continuous signal, triggered on a certain event channel.
 
-  @see GenericProcessor, LfpTriggeredAverageEditor, LfpDisplayCanvas
+  Incoming data are kept in a circular buffer. When a TTL rising edge
+  arrives on one of the selected trigger channels, the node waits until the
+  post-trigger part of the window has been received, then adds the window
+  (half before, half after the trigger) to a TrialAverage. The
+  LfpTriggeredAverageCanvas draws the mean and its confidence band.
+
+  @see GenericProcessor, LfpTriggeredAverageEditor, LfpTriggeredAverageCanvas
 
 */
 
@@ -54,8 +166,20 @@ public:
         return true;
     }
 
+    /** A late block can be skipped; see skipBlock() for what that costs. */
+    int getPriorityClass()
+    {
+        return BEST_EFFORT_PRIORITY;
+    }
+
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
 
+    /** Keeps the sample count aligned across a skipped block. The block's
+        triggers are lost, and any trial whose window overlaps the gap is
+        discarded instead of being averaged with misaligned data. The same
+        happens to a block that process() cannot get the lock for. */
+    void skipBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
     void setParameter(int, float);
 
     void updateSettings();
@@ -65,38 +189,74 @@ public:
 
     void handleEvent(int, MidiMessage&, int);
 
-    AudioSampleBuffer* getDisplayBufferAddress()
+    /** Sets the length of the averaging window (centred on the trigger).
+        Discards the current average. */
+    void setWindowLength(float seconds);
+
+    float getWindowLength()
     {
-        return displayBuffer;
+        return windowLength;
     }
-    int getDisplayBufferIndex()
+
+    /** Selects the TTL channels that trigger a trial (bit n = channel n). */
+    void setTriggerMask(int mask)
     {
-        return displayBufferIndex;
+        triggerMask = mask;
     }
 
+    /** Discards the current average. */
+    void resetAverage();
+
+    /** Copies the current average into the given buffers if it has changed
+        since lastTotalTrials, and returns the new total trial count. */
+    int64 getAverage(AudioSampleBuffer& mean, AudioSampleBuffer& interval,
+                     int64 lastTotalTrials, int& numTrials);
+
 private:
 
-    void initializeEventChannel();
+    /** Allocates the circular buffer and the TrialAverage for the current
+        settings and window length. */
+    bool resizeBuffer();
 
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
-    ScopedPointer<MidiBuffer> eventBuffer;
+    /** Averages all pending triggers whose windows are complete. */
+    void processPendingTriggers();
 
-    int displayBufferIndex;
-    int displayBufferIndexEvents;
+    /** Advances the sample count over samples that were never written, and
+        drops the triggers they make unusable. */
+    void skipSamples(int numSamples);
+
+    ScopedPointer<AudioSampleBuffer> displayBuffer;
 
-    float displayGain; //
     float bufferLength; // s
+    float windowLength; // s
 
-    AbstractFifo abstractFifo;
+    int windowSamples;
 
-    int64 bufferTimestamp;
-    int ttlState;
-    float* arrayOfOnes;
-    int totalSamples;
+    /** Total number of samples written into the displayBuffer, including
+        skipped blocks (whose part of the buffer holds stale data). */
+    int64 samplesWritten;
 
-    //Time timer;
+    /** End of the most recent skipped block; windows starting before this
+        are not averaged. */
+    int64 gapEnd;
 
-    bool resizeBuffer();
+    /** Absolute sample numbers of triggers waiting for post-trigger data. */
+    enum { maxPendingTriggers = 64 };
+    int64 pendingTriggers[maxPendingTriggers];
+    int numPendingTriggers;
+
+    Atomic<int> triggerMask;
+
+    /** Samples in blocks that arrived while the message thread held the
+        lock; accounted for as a skipped block once the lock is free. */
+    Atomic<int> samplesMissed;
+
+    TrialAverage average;
+
+    /** Held by the message thread while resizing or copying the average out.
+        The audio thread only tries it, and treats a block that arrives while
+        it is held as skipped (see samplesMissed). */
+    CriticalSection averageLock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpTriggeredAverageNode);
 
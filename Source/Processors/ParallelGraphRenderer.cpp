@@ -0,0 +1,539 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ParallelGraphRenderer.h"
+#include "GenericProcessor.h"
+
+ParallelGraphWorker::ParallelGraphWorker(ParallelGraphRenderer* renderer_, int index)
+    : Thread("Graph worker " + String(index)), renderer(renderer_)
+{
+
+}
+
+ParallelGraphWorker::~ParallelGraphWorker()
+{
+    signalThreadShouldExit();
+    startEvent.signal();
+    stopThread(1000);
+}
+
+void ParallelGraphWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        startEvent.wait(-1);
+
+        if (threadShouldExit())
+            break;
+
+        renderer->runTasks();
+    }
+}
+
+int ParallelGraphRenderer::findIdentitySource(const RenderNode* r)
+{
+    if (r->inputs.size() == 0 || r->inputs.size() != r->numChannels)
+        return -1;
+
+    const int source = r->inputs.getReference(0).node;
+
+    if (nodes[source]->numChannels < r->numChannels)
+        return -1;
+
+    for (int i = 0; i < r->inputs.size(); i++)
+    {
+        const Input& input = r->inputs.getReference(i);
+
+        if (input.node != source
+            || input.sourceChannel != i
+            || input.destChannel != i)
+            return -1;
+    }
+
+    return source;
+}
+
+struct ParallelGraphRenderer::InputSorter
+{
+    static int compareElements(const Input& a, const Input& b)
+    {
+        return a.destChannel - b.destChannel;
+    }
+};
+
+ParallelGraphRenderer::ParallelGraphRenderer()
+    : numSamples(0), viewNumSamples(0), maxBlockSize(0), maxParallelism(1),
+      enabled(false), built(false)
+{
+
+}
+
+ParallelGraphRenderer::~ParallelGraphRenderer()
+{
+    clear();
+}
+
+void ParallelGraphRenderer::clear()
+{
+    workers.clear(); // each worker stops its thread
+
+    built = false;
+    nodes.clear();
+    order.clear();
+    outputs.clear();
+    maxParallelism = 1;
+}
+
+void ParallelGraphRenderer::build(AudioProcessorGraph& graph, int outputNodeId)
+{
+    clear();
+
+    // one render node per processor
+    HashMap<int, int> indexForId;
+
+    for (int i = 0; i < graph.getNumNodes(); i++)
+    {
+        AudioProcessorGraph::Node* node = graph.getNode(i);
+
+        if (node->nodeId == (uint32) outputNodeId)
+            continue;
+
+        RenderNode* r = new RenderNode();
+        r->processor = node->getProcessor();
+        r->numChannels = jmax(1,
+                              r->processor->getNumInputChannels(),
+                              r->processor->getNumOutputChannels());
+
+        r->generic = dynamic_cast<GenericProcessor*>(r->processor);
+        r->passThrough = (r->generic != nullptr && r->generic->isPassThrough());
+
+        indexForId.set(node->nodeId, nodes.size());
+        nodes.add(r);
+    }
+
+    // connections become inputs and dependencies
+    for (int i = 0; i < graph.getNumConnections(); i++)
+    {
+        const AudioProcessorGraph::Connection* c = graph.getConnection(i);
+
+        if (!indexForId.contains(c->sourceNodeId))
+            continue;
+
+        const int source = indexForId[c->sourceNodeId];
+
+        if (c->destNodeId == (uint32) outputNodeId)
+        {
+            if (c->sourceChannelIndex != AudioProcessorGraph::midiChannelIndex)
+            {
+                Input output = { source, c->sourceChannelIndex, c->destChannelIndex, true };
+                outputs.add(output);
+            }
+
+            continue;
+        }
+
+        if (!indexForId.contains(c->destNodeId))
+            continue;
+
+        const int dest = indexForId[c->destNodeId];
+        RenderNode* d = nodes[dest];
+
+        if (c->sourceChannelIndex == AudioProcessorGraph::midiChannelIndex)
+        {
+            d->eventInputs.addIfNotAlreadyThere(source);
+        }
+        else if (c->destChannelIndex < d->numChannels)
+        {
+            Input input = { source, c->sourceChannelIndex, c->destChannelIndex, false };
+            d->inputs.add(input);
+        }
+
+        if (!nodes[source]->successors.contains(dest))
+        {
+            nodes[source]->successors.add(dest);
+            d->numPredecessors++;
+        }
+    }
+
+    // the first input to a channel is copied, the others are added
+    InputSorter sorter;
+
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        RenderNode* r = nodes[n];
+        r->inputs.sort(sorter, true);
+
+        int lastChannel = -1;
+
+        for (int i = 0; i < r->inputs.size(); i++)
+        {
+            Input& input = r->inputs.getReference(i);
+            input.add = (input.destChannel == lastChannel);
+            lastChannel = input.destChannel;
+        }
+
+        for (int chan = 0; chan < r->numChannels; chan++)
+        {
+            bool connected = false;
+
+            for (int i = 0; i < r->inputs.size(); i++)
+            {
+                if (r->inputs.getReference(i).destChannel == chan)
+                {
+                    connected = true;
+                    break;
+                }
+            }
+
+            if (!connected)
+                r->unconnectedChannels.add(chan);
+        }
+
+        // other processors that read channels 0..n-1 of one source may
+        // reorder that source's channel pointers instead of copying
+        if (!r->passThrough && r->generic != nullptr)
+        {
+            r->permuteFrom = findIdentitySource(r);
+            r->permutation.ensureStorageAllocated(r->numChannels);
+        }
+    }
+
+    // a pass-through node that reads channels 0..n-1 of one source, in
+    // order, can use that source's channels in place
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        RenderNode* r = nodes[n];
+
+        if (r->passThrough)
+            r->aliasOf = findIdentitySource(r);
+    }
+
+    // topological levels: nodes on the same level can run at the same time
+    Array<int> level;
+    Array<int> remaining;
+    Array<int> ready;
+
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        level.add(0);
+        remaining.add(nodes[n]->numPredecessors);
+
+        if (nodes[n]->numPredecessors == 0)
+            ready.add(n);
+    }
+
+    int numVisited = 0;
+    order.clear();
+
+    while (ready.size() > 0)
+    {
+        const int n = ready.remove(0);
+        order.add(n);
+        numVisited++;
+
+        for (int s = 0; s < nodes[n]->successors.size(); s++)
+        {
+            const int succ = nodes[n]->successors[s];
+
+            level.set(succ, jmax(level[succ], level[n] + 1));
+            remaining.set(succ, remaining[succ] - 1);
+
+            if (remaining[succ] == 0)
+                ready.add(succ);
+        }
+    }
+
+    if (numVisited != nodes.size())
+    {
+        std::cout << "Parallel renderer: the signal chain contains a cycle; using the standard renderer."
+                  << std::endl;
+        nodes.clear();
+        order.clear();
+        outputs.clear();
+        return;
+    }
+
+    HashMap<int, int> nodesPerLevel;
+
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        const int count = nodesPerLevel[level[n]] + 1;
+        nodesPerLevel.set(level[n], count);
+        maxParallelism = jmax(maxParallelism, count);
+    }
+
+    readyQueue.calloc(jmax(1, nodes.size()));
+    readIndex.set(nodes.size()); // nothing to do until the first callback
+
+    const int numWorkers = jmin((int) maxWorkers,
+                                SystemStats::getNumCpus() - 1,
+                                maxParallelism - 1);
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        ParallelGraphWorker* worker = new ParallelGraphWorker(this, i);
+        workers.add(worker);
+        worker->startThread(9);
+    }
+
+    int numAliased = 0;
+    int numPermutable = 0;
+
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        if (nodes[n]->aliasOf >= 0)
+            numAliased++;
+
+        if (nodes[n]->permuteFrom >= 0)
+            numPermutable++;
+    }
+
+    std::cout << "Parallel renderer: " << nodes.size() << " nodes (" << numAliased
+              << " reading in place, " << numPermutable << " may reorder in place), up to "
+              << maxParallelism << " at a time, " << numWorkers << " worker threads." << std::endl;
+
+    built = true;
+
+    if (maxBlockSize > 0)
+        prepare(maxBlockSize);
+}
+
+void ParallelGraphRenderer::prepare(int maxBlockSize_)
+{
+    maxBlockSize = maxBlockSize_;
+
+    // sources come first, so aliases can be resolved in one pass
+    for (int i = 0; i < order.size(); i++)
+    {
+        RenderNode* r = nodes[order[i]];
+
+        if (r->aliasOf >= 0)
+        {
+            r->storage.free();
+            r->channels = nodes[r->aliasOf]->channels;
+        }
+        else
+        {
+            r->storage.calloc((size_t) r->numChannels * (size_t) jmax(1, maxBlockSize));
+            r->ownChannels.malloc(r->numChannels);
+
+            for (int chan = 0; chan < r->numChannels; chan++)
+                r->ownChannels[chan] = r->storage + chan * jmax(1, maxBlockSize);
+
+            r->channels = r->ownChannels;
+        }
+
+        r->events.ensureSize(eventBufferBytes);
+    }
+
+    viewNumSamples = 0;
+}
+
+bool ParallelGraphRenderer::render(AudioSampleBuffer& output)
+{
+    if (!built || nodes.size() == 0 || output.getNumSamples() > maxBlockSize)
+        return false;
+
+    numSamples = output.getNumSamples();
+
+    const int numNodes = nodes.size();
+
+    if (numSamples != viewNumSamples)
+    {
+        // only happens when the block size changes
+        for (int n = 0; n < numNodes; n++)
+            nodes[n]->buffer.setDataToReferTo(nodes[n]->channels, nodes[n]->numChannels, numSamples);
+
+        viewNumSamples = numSamples;
+    }
+
+    for (int n = 0; n < numNodes; n++)
+    {
+        readyQueue[n].set(0);
+        nodes[n]->pending.set(nodes[n]->numPredecessors);
+    }
+
+    writeIndex.set(0);
+    numCompleted.set(0);
+    readIndex.set(0);
+
+    for (int n = 0; n < numNodes; n++)
+    {
+        if (nodes[n]->numPredecessors == 0)
+            pushReady(n);
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->startRender();
+
+    runTasks();
+
+    // wait for the workers to finish the nodes they have taken
+    while (numCompleted.get() < numNodes)
+        Thread::yield();
+
+    output.clear();
+
+    for (int i = 0; i < outputs.size(); i++)
+    {
+        const Input& o = outputs.getReference(i);
+        AudioSampleBuffer& source = nodes[o.node]->buffer;
+
+        if (o.destChannel < output.getNumChannels() && o.sourceChannel < source.getNumChannels())
+            output.addFrom(o.destChannel, 0, source, o.sourceChannel, 0, numSamples);
+    }
+
+    return true;
+}
+
+void ParallelGraphRenderer::pushReady(int index)
+{
+    const int slot = (++writeIndex) - 1;
+    readyQueue[slot].set(index + 1);
+}
+
+void ParallelGraphRenderer::runTasks()
+{
+    const int numNodes = nodes.size();
+
+    for (;;)
+    {
+        const int slot = (++readIndex) - 1;
+
+        if (slot >= numNodes)
+            return;
+
+        // every slot is eventually filled, since every node becomes ready
+        int value;
+
+        while ((value = readyQueue[slot].get()) == 0)
+            Thread::yield();
+
+        processNode(value - 1);
+    }
+}
+
+bool ParallelGraphRenderer::permuteChannels(RenderNode* node)
+{
+    // the buffer keeps its own copy of the channel pointers (set up when
+    // the block size changes), which is rewritten here without allocating
+    float** view = node->buffer.getArrayOfChannels();
+
+    if (!node->generic->getChannelPermutation(node->numChannels, node->permutation))
+    {
+        for (int chan = 0; chan < node->numChannels; chan++)
+            view[chan] = node->channels[chan];
+
+        return false;
+    }
+
+    // the source's current view, which may itself be a permutation
+    const AudioSampleBuffer& source = nodes[node->permuteFrom]->buffer;
+    float** sourceChannels = source.getArrayOfChannels();
+
+    for (int chan = 0; chan < node->numChannels; chan++)
+    {
+        const int s = (chan < node->permutation.size()) ? node->permutation.getUnchecked(chan) : -1;
+
+        if (s >= 0 && s < source.getNumChannels())
+        {
+            view[chan] = sourceChannels[s];
+        }
+        else
+        {
+            view[chan] = node->channels[chan];
+            FloatVectorOperations::clear(view[chan], numSamples);
+        }
+    }
+
+    return true;
+}
+
+void ParallelGraphRenderer::processNode(int index)
+{
+    RenderNode* node = nodes[index];
+    AudioSampleBuffer& buffer = node->buffer;
+
+    bool permuted = false;
+
+    if (node->permuteFrom >= 0)
+    {
+        permuted = permuteChannels(node);
+    }
+    else if (node->aliasOf >= 0)
+    {
+        // follow the source's current view, in case it was permuted
+        float** view = buffer.getArrayOfChannels();
+        float** sourceView = nodes[node->aliasOf]->buffer.getArrayOfChannels();
+
+        for (int chan = 0; chan < node->numChannels; chan++)
+            view[chan] = sourceView[chan];
+    }
+
+    // aliased and permuted nodes already see their source's output
+    for (int i = 0; node->aliasOf < 0 && !permuted && i < node->inputs.size(); i++)
+    {
+        const Input& input = node->inputs.getReference(i);
+        AudioSampleBuffer& source = nodes[input.node]->buffer;
+
+        if (input.sourceChannel >= source.getNumChannels())
+        {
+            if (!input.add)
+                buffer.clear(input.destChannel, 0, numSamples);
+        }
+        else if (input.add)
+        {
+            buffer.addFrom(input.destChannel, 0, source, input.sourceChannel, 0, numSamples);
+        }
+        else
+        {
+            buffer.copyFrom(input.destChannel, 0, source, input.sourceChannel, 0, numSamples);
+        }
+    }
+
+    for (int i = 0; node->aliasOf < 0 && !permuted && i < node->unconnectedChannels.size(); i++)
+        buffer.clear(node->unconnectedChannels.getUnchecked(i), 0, numSamples);
+
+    node->events.clear();
+
+    for (int i = 0; i < node->eventInputs.size(); i++)
+        node->events.addEvents(nodes[node->eventInputs.getUnchecked(i)]->events, 0, -1, 0);
+
+    if (node->generic != nullptr)
+        node->generic->channelsPermuted = permuted;
+
+    node->processor->processBlock(buffer, node->events);
+
+    if (node->generic != nullptr)
+        node->generic->channelsPermuted = false;
+
+    for (int i = 0; i < node->successors.size(); i++)
+    {
+        const int s = node->successors.getUnchecked(i);
+
+        if (--(nodes[s]->pending) == 0)
+            pushReady(s);
+    }
+
+    ++numCompleted;
+}
@@ -0,0 +1,235 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PARALLELGRAPHRENDERER_H_E41D7A36__
+#define __PARALLELGRAPHRENDERER_H_E41D7A36__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+class ParallelGraphRenderer;
+class GenericProcessor;
+
+/**
+
+  Worker thread that helps a ParallelGraphRenderer process one callback.
+
+  @see ParallelGraphRenderer
+
+*/
+
+class ParallelGraphWorker : public Thread
+{
+public:
+
+    ParallelGraphWorker(ParallelGraphRenderer* renderer, int index);
+    ~ParallelGraphWorker();
+
+    /** Wakes the thread up for one callback. */
+    void startRender()
+    {
+        startEvent.signal();
+    }
+
+    void run();
+
+private:
+
+    ParallelGraphRenderer* renderer;
+    WaitableEvent startEvent;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelGraphWorker);
+
+};
+
+/**
+
+  Processes the nodes of the ProcessorGraph on several threads.
+
+  AudioProcessorGraph renders every node in turn on the audio thread, so two
+  signal chains (or two branches after a Splitter) take the sum of their
+  processing times, even though they never touch each other's data. When
+  enabled (View > Parallel signal chains), this class takes over
+  ProcessorGraph::processBlock():
+
+  - build() turns the graph's connections into a dependency graph, with one
+    node per processor. Each node gets its own buffer and event buffer.
+    Its inputs are copied (or summed) from the outputs of its
+    predecessors, as AudioProcessorGraph does.
+
+  - A pass-through processor (see GenericProcessor::isPassThrough()) that
+    reads all of its channels, in order, from a single source is not
+    given a copy: its buffer refers to the source's channels. Display
+    sinks, detectors and the ends of Splitter branches then cost no
+    data movement at all.
+
+  - Likewise, a processor connected that way whose current output is a
+    reordering of its input (see GenericProcessor::getChannelPermutation(),
+    e.g. a Channel Map without referencing) gets its source's channel
+    pointers in the new order. The permutation can change from one block
+    to the next, so aliased nodes copy their source's pointers every block.
+
+  - On each callback, nodes whose predecessors are all done are put on a
+    ready queue, and are taken from it by the audio thread and a small
+    pool of workers. Splitter fan-out and separate tabs become separate
+    tasks. A Merger, the RecordNode and the AudioNode only become ready
+    once everything upstream has finished, so the join happens
+    before any of them runs.
+
+  The audio thread always takes part, so the worst case is the same
+  serial order as before. If a callback is larger than the size given to
+  prepare(), render() returns false and the caller falls back to
+  AudioProcessorGraph.
+
+  @see ProcessorGraph
+
+*/
+
+class ParallelGraphRenderer
+{
+public:
+
+    ParallelGraphRenderer();
+    ~ParallelGraphRenderer();
+
+    /** Turns parallel rendering on or off. Takes effect at the start of the
+        next acquisition. */
+    void setEnabled(bool t)
+    {
+        enabled = t;
+    }
+
+    /** Returns true if parallel rendering has been requested. */
+    bool isEnabled()
+    {
+        return enabled;
+    }
+
+    /** Builds the dependency graph from the connections of a graph, and starts
+        the worker threads (message thread, acquisition stopped). The node
+        with outputNodeId is the audio output; its inputs are copied to the
+        buffer passed to render(). */
+    void build(AudioProcessorGraph& graph, int outputNodeId);
+
+    /** Allocates buffers for blocks of up to maxBlockSize samples. */
+    void prepare(int maxBlockSize);
+
+    /** Stops the workers and forgets the graph. */
+    void clear();
+
+    /** Processes one callback. Returns false if nothing was done. */
+    bool render(AudioSampleBuffer& output);
+
+    /** Returns the number of nodes that can run at the same time, at most. */
+    int getMaxParallelism()
+    {
+        return maxParallelism;
+    }
+
+private:
+
+    friend class ParallelGraphWorker;
+
+    /** Takes nodes from the ready queue until the queue is exhausted. */
+    void runTasks();
+
+    struct RenderNode;
+
+    void processNode(int index);
+
+    /** Points a node's buffer at its source's channels if the processor
+        currently reorders its input; otherwise at its own storage. Returns
+        true if the channels were permuted. */
+    bool permuteChannels(RenderNode* node);
+
+    /** Returns the source node if every channel of a node is connected, in
+        order, to the same channel of a single source; otherwise -1. */
+    int findIdentitySource(const RenderNode* node);
+
+    void pushReady(int index);
+
+    struct Input
+    {
+        int node;
+        int sourceChannel;
+        int destChannel;
+        bool add; // sum into destChannel rather than copy
+    };
+
+    struct InputSorter;
+
+    struct RenderNode
+    {
+        AudioProcessor* processor;
+        GenericProcessor* generic; // processor, if it is a GenericProcessor
+        int numChannels;
+        bool passThrough;
+        int aliasOf; // node whose channels are used in place, or -1
+        int permuteFrom; // node whose channels may be used reordered, or -1
+        Array<int> permutation; // filled by getChannelPermutation()
+
+        HeapBlock<float> storage;
+        HeapBlock<float*> ownChannels;
+        float** channels; // ownChannels, or those of aliasOf
+
+        AudioSampleBuffer buffer; // refers to channels, for the current block size
+        MidiBuffer events;
+
+        Array<Input> inputs;
+        Array<int> unconnectedChannels;
+        Array<int> eventInputs;
+        Array<int> successors;
+
+        int numPredecessors;
+        Atomic<int> pending;
+
+        RenderNode() : processor(nullptr), generic(nullptr), numChannels(0), passThrough(false),
+            aliasOf(-1), permuteFrom(-1), channels(nullptr), buffer(1, 1), numPredecessors(0) {}
+    };
+
+    OwnedArray<RenderNode> nodes;
+    Array<int> order; // topological
+    Array<Input> outputs;
+
+    HeapBlock<Atomic<int> > readyQueue; // node index + 1, or 0 if not yet published
+    Atomic<int> readIndex;
+    Atomic<int> writeIndex;
+    Atomic<int> numCompleted;
+
+    int numSamples;
+    int viewNumSamples;
+    int maxBlockSize;
+    int maxParallelism;
+
+    bool enabled;
+    bool built;
+
+    OwnedArray<ParallelGraphWorker> workers;
+
+    enum { maxWorkers = 3, eventBufferBytes = 32768 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelGraphRenderer);
+
+};
+
+
+#endif  // __PARALLELGRAPHRENDERER_H_E41D7A36__
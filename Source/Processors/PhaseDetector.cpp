@@ -22,12 +22,16 @@
 */
 
 #include <stdio.h>
+#include <math.h>
 #include "PhaseDetector.h"
 #include "Editors/PhaseDetectorEditor.h"
 
+// length of each output pulse, in samples
+#define PULSE_LENGTH 1000
+
 PhaseDetector::PhaseDetector()
-    : GenericProcessor("Phase Detector"), activeModule(-1),
-      risingPos(false), risingNeg(false), fallingPos(false), fallingNeg(false)
+    : GenericProcessor("Phase Detector"), activeModule(-1), sampleCount(0),
+      minCrossingInterval(0.0)
       
 {
 
@@ -54,11 +58,14 @@ void PhaseDetector::addModule()
     m.outputChan = -1;
     m.gateChan = -1;
     m.isActive = true;
-    m.lastSample = 0.0f;
     m.type = NONE;
-    m.samplesSinceTrigger = 5000;
-    m.wasTriggered = false;
-    m.phase = NO_PHASE;
+    m.targetPhase = 0.0f;
+    m.anchorTime = -1.0;
+    m.anchorPhase = 0.0f;
+    m.nextTrigger = -1.0;
+    m.lastTriggerTime = -1;
+    m.offTime = -1;
+    m.isMeasuring = false;
 
     modules.add(m);
 }
@@ -100,9 +107,16 @@ void PhaseDetector::setParameter(int parameterIndex, float newValue)
             default:
                 module.type = NONE;
         }
+
+        // sine convention: the rising zero crossing is 0 degrees
+        module.targetPhase = float((int(module.type) * 90) % 360);
+        module.nextTrigger = -1.0;
+
     } else if (parameterIndex == 2) // inputChan
     {
         module.inputChan = (int) newValue;
+        module.anchorTime = -1.0;
+        module.nextTrigger = -1.0;
     } else if (parameterIndex == 3) // outputChan
     {
         module.outputChan = (int) newValue;
@@ -121,11 +135,83 @@ void PhaseDetector::setParameter(int parameterIndex, float newValue)
 
 void PhaseDetector::updateSettings()
 {
+    trackers.clear();
+
+    for (int i = 0; i < getNumInputs(); i++)
+    {
+        ChannelTracker* t = new ChannelTracker();
+        t->crossings.ensureStorageAllocated(256);
+        trackers.add(t);
+    }
+
+    resetTrackers();
+}
 
+void PhaseDetector::resetTrackers()
+{
+    for (int i = 0; i < trackers.size(); i++)
+    {
+        ChannelTracker* t = trackers[i];
+
+        t->lastSample = 0.0f;
+        t->hasCrossing = false;
+        t->lastRising = false;
+        t->lastCrossing = -1.0;
+        t->lastRisingTime = -1.0;
+        t->lastFallingTime = -1.0;
+        t->numIntervals = 0;
+        t->intervalIndex = 0;
+        t->period = 0.0;
+        t->isUsed = false;
+        t->crossings.clearQuick();
+    }
 }
 
 bool PhaseDetector::enable()
 {
+    sampleCount = 0;
+
+    // allows oscillations of up to 1 kHz
+    minCrossingInterval = getSampleRate() * 0.0005;
+
+    resetTrackers();
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        DetectorModule& module = modules.getReference(i);
+
+        module.anchorTime = -1.0;
+        module.nextTrigger = -1.0;
+        module.lastTriggerTime = -1;
+        module.offTime = -1;
+        module.isMeasuring = false;
+        module.numTriggers = 0;
+        module.numMeasured = 0;
+        module.errorSum = 0.0;
+        module.absErrorSum = 0.0;
+        module.periodSum = 0.0;
+    }
+
+    return true;
+}
+
+bool PhaseDetector::disable()
+{
+    for (int i = 0; i < modules.size(); i++)
+    {
+        const DetectorModule& module = modules.getReference(i);
+
+        if (module.numMeasured == 0)
+            continue;
+
+        const double meanError = module.errorSum / module.numMeasured;
+        const double meanPeriod = module.periodSum / module.numMeasured;
+
+        std::cout << "Phase detector " << i + 1 << ": " << module.numTriggers << " pulses, mean phase error "
+                  << meanError << " deg (" << meanError / 360.0 * meanPeriod / getSampleRate() * 1000.0
+                  << " ms), mean absolute error " << module.absErrorSum / module.numMeasured << " deg" << std::endl;
+    }
+
     return true;
 }
 
@@ -168,110 +254,250 @@ void PhaseDetector::process(AudioSampleBuffer& buffer,
 
     checkForEvents(events);
 
+    const int numChannels = jmin(buffer.getNumChannels(), trackers.size());
+
+    for (int i = 0; i < trackers.size(); i++)
+        trackers[i]->isUsed = false;
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        const DetectorModule& module = modules.getReference(i);
+
+        if (module.inputChan >= 0 && module.inputChan < numChannels)
+            trackers[module.inputChan]->isUsed = true;
+    }
+
+    // each input channel is scanned once, however many modules read it
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        if (trackers[chan]->isUsed)
+            detectCrossings(trackers[chan], buffer.getSampleData(chan), nSamples);
+    }
+
     // loop through the modules
     for (int i = 0; i < modules.size(); i++)
     {
         DetectorModule& module = modules.getReference(i);
 
-        // check to see if it's active and has a channel
-        if (module.isActive && module.outputChan >= 0 &&
-            module.inputChan >= 0 && 
-            module.inputChan < buffer.getNumChannels())
+        // check to see if it has a channel
+        if (module.outputChan >= 0 &&
+            module.inputChan >= 0 &&
+            module.inputChan < numChannels)
         {
+            processModule(module, trackers[module.inputChan], events, nSamples);
+        }
 
-            for (int i = 0; i < nSamples; i++)
-            {
-                float sample = *buffer.getSampleData(module.inputChan, i);
+    }
+
+    sampleCount += nSamples;
+
+}
+
+void PhaseDetector::detectCrossings(ChannelTracker* t, const float* data, int nSamples)
+{
+    t->crossings.clearQuick();
+
+    float previous = t->lastSample;
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        const float sample = data[i];
+
+        if ((previous <= 0.0f && sample > 0.0f) || (previous >= 0.0f && sample < 0.0f))
+        {
+            // interpolate between the two samples on either side of zero
+            const double fraction = previous / (previous - sample);
+
+            addCrossing(t, double(sampleCount + i - 1) + fraction, sample > 0.0f);
+        }
+
+        previous = sample;
+    }
+
+    t->lastSample = previous;
+}
+
+void PhaseDetector::addCrossing(ChannelTracker* t, double time, bool rising)
+{
+    if (t->hasCrossing)
+    {
+        // hysteresis: crossings must alternate, and cannot be much closer
+        // together than half a period
+        if (rising == t->lastRising)
+            return;
+
+        if (time - t->lastCrossing < jmax(0.25 * t->period, minCrossingInterval))
+            return;
+    }
 
-                if (sample < module.lastSample && sample > 0 && module.phase != FALLING_POS)
-                {
+    double& previous = rising ? t->lastRisingTime : t->lastFallingTime;
 
-                    if (module.type == PEAK)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
+    if (previous >= 0.0)
+    {
+        const double interval = time - previous;
+
+        if (t->period > 0.0 && interval > 3.0 * t->period)
+        {
+            // the oscillation stopped for a while; start over
+            t->numIntervals = 0;
+            t->intervalIndex = 0;
+        }
+        else
+        {
+            t->intervals[t->intervalIndex] = interval;
+            t->intervalIndex = (t->intervalIndex + 1) % NUM_INTERVALS;
+            t->numIntervals = jmin(t->numIntervals + 1, NUM_INTERVALS);
+        }
 
-                    module.phase = FALLING_POS;
+        estimateFrequency(t);
+    }
 
-                } else if (sample < 0 && module.lastSample >= 0 && module.phase != FALLING_NEG)
-                {
+    previous = time;
 
-                    if (module.type == FALLING_ZERO)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
+    t->hasCrossing = true;
+    t->lastRising = rising;
+    t->lastCrossing = time;
 
-                     module.phase = FALLING_NEG;
+    Crossing c;
+    c.time = time;
+    c.period = t->period;
+    c.rising = rising;
 
-                } else if (sample > module.lastSample && sample < 0 && module.phase != RISING_NEG)
-                {
+    t->crossings.add(c);
+}
 
-                    if (module.type == TROUGH)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
+void PhaseDetector::estimateFrequency(ChannelTracker* t)
+{
+    if (t->numIntervals == 0)
+    {
+        t->period = 0.0;
+        return;
+    }
 
-                    module.phase = RISING_NEG;
+    double sum = 0.0;
 
-                } else if (sample > 0 && module.lastSample <= 0 && module.phase != RISING_POS)
-                {
+    for (int i = 0; i < t->numIntervals; i++)
+    {
+        sum += t->intervals[i];
+    }
 
-                    if (module.type == RISING_ZERO)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
+    t->period = sum / double(t->numIntervals);
 
-                    module.phase = RISING_POS;
+}
 
-                }
+void PhaseDetector::processModule(DetectorModule& module, ChannelTracker* t, MidiBuffer& events, int nSamples)
+{
+    const int64 lastSample = sampleCount + nSamples - 1;
 
-                module.lastSample = sample;
+    for (int i = 0; i < t->crossings.size(); i++)
+    {
+        const Crossing& c = t->crossings.getReference(i);
 
-                if (module.wasTriggered)
-                {
-                    if (module.samplesSinceTrigger > 1000)
-                    {
-                        addEvent(events, TTL, i, 0, module.outputChan);
-                        module.wasTriggered = false;
-                    }
-                    else
-                    {
-                        module.samplesSinceTrigger++;
-                    }
-                }
+        // a pulse predicted from an earlier crossing goes out first
+        if (module.nextTrigger >= 0.0 && module.nextTrigger <= c.time)
+            fireTrigger(module, events);
 
-            }
+        measurePhase(module, c);
 
-            
-        }
+        module.anchorTime = c.time;
+        module.anchorPhase = c.rising ? 0.0f : 180.0f;
 
+        scheduleTrigger(module, c);
     }
 
+    if (module.nextTrigger >= 0.0 && module.nextTrigger <= double(lastSample))
+        fireTrigger(module, events);
+
+    if (module.offTime >= 0 && module.offTime <= lastSample)
+    {
+        addEvent(events, TTL, jmax(0, int(module.offTime - sampleCount)), 0, module.outputChan);
+        module.offTime = -1;
+    }
+}
+
+void PhaseDetector::scheduleTrigger(DetectorModule& module, const Crossing& c)
+{
+    if (module.type == NONE || c.period <= 0.0)
+    {
+        module.nextTrigger = -1.0;
+        return;
+    }
+
+    float delta = module.targetPhase - module.anchorPhase;
+
+    if (delta < 0.0f)
+        delta += 360.0f;
+
+    double time = c.time + double(delta) / 360.0 * c.period;
+
+    // at most one pulse per cycle, even if the new estimate is a little
+    // earlier than the one that has already fired
+    if (module.lastTriggerTime >= 0 && time - double(module.lastTriggerTime) < 0.5 * c.period)
+        time += c.period;
+
+    module.nextTrigger = time;
 }
 
-void PhaseDetector::estimateFrequency()
+void PhaseDetector::fireTrigger(DetectorModule& module, MidiBuffer& events)
 {
+    const int64 triggerTime = jmax(sampleCount, (int64) ceil(module.nextTrigger));
 
-    // int N = (numPeakIntervals < NUM_INTERVALS) ? numPeakIntervals
-    //         : NUM_INTERVALS;
+    module.nextTrigger = -1.0;
 
-    // int sum = 0;
+    if (!module.isActive)
+        return;
 
-    // for (int i = 0; i < N; i++)
-    // {
-    //     sum += peakIntervals[i];
-    // }
+    // finish the previous pulse if it is still high
+    if (module.offTime >= 0 && module.offTime <= triggerTime)
+    {
+        addEvent(events, TTL, jmax(0, int(module.offTime - sampleCount)), 0, module.outputChan);
+    }
 
-    // estimatedFrequency = getSampleRate()/(float(sum)/float(N));
+    addEvent(events, TTL, int(triggerTime - sampleCount), 1, module.outputChan);
 
+    module.offTime = triggerTime + PULSE_LENGTH;
+    module.lastTriggerTime = triggerTime;
+    module.numTriggers++;
 
+    module.isMeasuring = module.anchorTime >= 0.0;
+    module.measuredTime = triggerTime;
+    module.measuredAnchorTime = module.anchorTime;
+    module.measuredAnchorPhase = module.anchorPhase;
 }
 
+void PhaseDetector::measurePhase(DetectorModule& module, const Crossing& c)
+{
+    if (!module.isMeasuring)
+        return;
+
+    if (double(module.measuredTime) > c.time)
+    {
+        // the pulse went out after this crossing; use it as the reference
+        module.measuredAnchorTime = c.time;
+        module.measuredAnchorPhase = c.rising ? 0.0f : 180.0f;
+        return;
+    }
+
+    // consecutive crossings are half a cycle apart
+    const double halfCycle = c.time - module.measuredAnchorTime;
+
+    if (halfCycle > 0.0)
+    {
+        double error = module.measuredAnchorPhase
+                       + 180.0 * (double(module.measuredTime) - module.measuredAnchorTime) / halfCycle
+                       - module.targetPhase;
+
+        while (error > 180.0)
+            error -= 360.0;
+
+        while (error <= -180.0)
+            error += 360.0;
+
+        module.numMeasured++;
+        module.errorSum += error;
+        module.absErrorSum += fabs(error);
+        module.periodSum += 2.0 * halfCycle;
+    }
+
+    module.isMeasuring = false;
+}
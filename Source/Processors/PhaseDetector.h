@@ -32,7 +32,23 @@
 
 /**
 
-  Uses peaks to estimate the phase of a continuous signal.
+  Triggers TTL pulses at a chosen phase of an oscillation.
+
+  Each input channel that feeds at least one module is scanned once per
+  block for zero crossings, which are located to a fraction of a sample by
+  linear interpolation. Crossings must alternate in direction and be at
+  least a quarter of a period apart, so noise near zero does not cause
+  chatter. The period is the mean of the last few intervals between
+  crossings of the same direction.
+
+  A module predicts when its target phase (peak, falling zero, trough or
+  rising zero) will occur from the most recent crossing and the current
+  period, and fires on the first sample at or after that time. The phase
+  at which each pulse actually occurred is measured once the following
+  crossing arrives, and the error is reported when acquisition stops.
+
+  Modules only visit the crossings of their channel, so any number of
+  them can share an input at little extra cost.
 
   @see GenericProcessor, PhaseDetectorEditor
 
@@ -47,6 +63,12 @@ public:
     ~PhaseDetector();
 
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
+    /** Only reads the continuous channels. */
+    bool isPassThrough()
+    {
+        return true;
+    }
     void setParameter(int parameterIndex, float newValue);
 
     AudioProcessorEditor* createEditor();
@@ -57,6 +79,7 @@ public:
     }
 
     bool enable();
+    bool disable();
 
     void updateSettings();
 
@@ -69,8 +92,27 @@ private:
         NONE, PEAK, FALLING_ZERO, TROUGH, RISING_ZERO 
     };
 
-    enum PhaseType {
-        NO_PHASE, RISING_POS, FALLING_POS, FALLING_NEG, RISING_NEG
+    struct Crossing {
+
+        double time; // in samples since acquisition started
+        double period; // estimated period at this crossing (0 if unknown)
+        bool rising;
+    };
+
+    struct ChannelTracker {
+
+        float lastSample;
+        bool hasCrossing;
+        bool lastRising;
+        double lastCrossing;
+        double lastRisingTime;
+        double lastFallingTime;
+        double intervals[NUM_INTERVALS];
+        int numIntervals;
+        int intervalIndex;
+        double period;
+        bool isUsed;
+        Array<Crossing> crossings; // accepted in the current block
     };
 
     struct DetectorModule {
@@ -79,22 +121,55 @@ private:
         int gateChan;
         int outputChan;
         bool isActive;
-        float lastSample;
-        int samplesSinceTrigger;
-        bool wasTriggered;
         ModuleType type;
-        PhaseType phase;
+        float targetPhase; // degrees; 0 = rising zero crossing, 90 = peak
+
+        // most recent crossing of the input channel
+        double anchorTime;
+        float anchorPhase;
+
+        double nextTrigger; // -1 if none is scheduled
+        int64 lastTriggerTime;
+        int64 offTime;
+
+        // the last pulse, until the crossing after it tells us its true phase
+        bool isMeasuring;
+        int64 measuredTime;
+        double measuredAnchorTime;
+        float measuredAnchorPhase;
+
+        int numTriggers;
+        int numMeasured;
+        double errorSum; // degrees
+        double absErrorSum; // degrees
+        double periodSum; // samples
     };
 
     Array<DetectorModule> modules;
 
+    OwnedArray<ChannelTracker> trackers;
+
     int activeModule;
 
+    int64 sampleCount;
+
+    /** Crossings closer together than this (in samples) are ignored until
+        the period is known. */
+    double minCrossingInterval;
+
     void handleEvent(int eventType, MidiMessage& event, int sampleNum);
 
-    bool risingPos, risingNeg, fallingPos, fallingNeg;
+    void resetTrackers();
+
+    void detectCrossings(ChannelTracker* t, const float* data, int nSamples);
+    void addCrossing(ChannelTracker* t, double time, bool rising);
+
+    void estimateFrequency(ChannelTracker* t);
 
-    void estimateFrequency();
+    void processModule(DetectorModule& module, ChannelTracker* t, MidiBuffer& events, int nSamples);
+    void scheduleTrigger(DetectorModule& module, const Crossing& c);
+    void fireTrigger(DetectorModule& module, MidiBuffer& events);
+    void measurePhase(DetectorModule& module, const Crossing& c);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PhaseDetector);
 
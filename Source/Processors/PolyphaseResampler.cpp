@@ -0,0 +1,313 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PolyphaseResampler.h"
+
+#include <math.h>
+
+// zero crossings of the sinc on each side of the centre tap
+#define ZERO_CROSSINGS 8
+
+// passband edge as a fraction of the output Nyquist frequency
+#define ROLLOFF 0.9
+
+// Kaiser window shape (about -80 dB stopband)
+#define KAISER_BETA 8.0
+
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+
+        if (term < sum * 1.0e-12)
+            break;
+    }
+
+    return sum;
+}
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0)
+    {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+PolyphaseFilterTable::PolyphaseFilterTable(int upFactor_, int downFactor_)
+    : upFactor(upFactor_), downFactor(downFactor_)
+{
+    const int L = upFactor;
+    const int M = downFactor;
+
+    tapsPerPhase = (int) ceil(2.0 * ZERO_CROSSINGS * jmax(L, M) / (ROLLOFF * L));
+    tapsPerPhase = (tapsPerPhase + 3) & ~3;
+
+    const int numTaps = tapsPerPhase * L;
+
+    // cutoff in cycles per sample at the up-sampled rate
+    const double fc = 0.5 * ROLLOFF / double(jmax(L, M));
+    const double centre = 0.5 * double(numTaps - 1);
+    const double windowNorm = besselI0(KAISER_BETA);
+
+    HeapBlock<double> prototype(numTaps);
+    double sum = 0.0;
+
+    for (int i = 0; i < numTaps; i++)
+    {
+        const double t = double(i) - centre;
+        const double sinc = (t == 0.0) ? 2.0 * fc : sin(2.0 * double_Pi * fc * t) / (double_Pi * t);
+
+        const double r = t / (centre + 1.0);
+        const double window = besselI0(KAISER_BETA * sqrt(jmax(0.0, 1.0 - r * r))) / windowNorm;
+
+        prototype[i] = sinc * window;
+        sum += prototype[i];
+    }
+
+    // unity gain at DC for every phase
+    const double scale = double(L) / sum;
+
+    coefficients.calloc(numTaps);
+
+    for (int p = 0; p < L; p++)
+    {
+        float* phase = coefficients + p * tapsPerPhase;
+
+        for (int j = 0; j < tapsPerPhase; j++)
+            phase[j] = float(prototype[p + (tapsPerPhase - 1 - j) * L] * scale);
+    }
+}
+
+PolyphaseFilterTable::Ptr PolyphaseFilterTable::getTable(int upFactor, int downFactor)
+{
+    static ReferenceCountedArray<PolyphaseFilterTable> cache;
+
+    for (int i = 0; i < cache.size(); i++)
+    {
+        PolyphaseFilterTable* t = cache.getUnchecked(i);
+
+        if (t->upFactor == upFactor && t->downFactor == downFactor)
+            return t;
+    }
+
+    std::cout << "Designing polyphase filter for L/M = "
+              << upFactor << "/" << downFactor << std::endl;
+
+    PolyphaseFilterTable* t = new PolyphaseFilterTable(upFactor, downFactor);
+    cache.add(t);
+
+    return t;
+}
+
+PolyphaseResampler::PolyphaseResampler()
+    : outputRate(0.0), history(1, 1), nextPosition(0)
+{
+
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+
+}
+
+void PolyphaseResampler::setRates(double inputRate, double requestedRate, bool allowUpsampling)
+{
+    if (inputRate <= 0.0 || requestedRate <= 0.0 ||
+        fabs(requestedRate - inputRate) < 1.0e-6 ||
+        (requestedRate > inputRate && !allowUpsampling))
+    {
+        table = nullptr;
+        outputRate = inputRate;
+        return;
+    }
+
+    // up-sampling to an audio rate needs a larger L to be exact
+    // (e.g. 30000 -> 44100 is 147/100)
+    const int maxL = (requestedRate > inputRate) ? (int) maxUpsamplingFactor : (int) maxUpFactor;
+
+    int L = 0;
+    int M = 0;
+
+    // exact ratio for integer rates (e.g. 30000 -> 2500 gives 1/12)
+    const int in = roundToInt(inputRate);
+    const int out = roundToInt(requestedRate);
+
+    if (fabs(inputRate - in) < 1.0e-6 && fabs(requestedRate - out) < 1.0e-6)
+    {
+        const int g = greatestCommonDivisor(in, out);
+
+        if (out / g <= maxL)
+        {
+            L = out / g;
+            M = in / g;
+        }
+    }
+
+    // otherwise, the closest ratio with a small up-sampling factor
+    if (L == 0)
+    {
+        double bestError = 1.0e30;
+
+        for (int l = 1; l <= maxL; l++)
+        {
+            int m = jmax(1, roundToInt(l * inputRate / requestedRate));
+
+            if (m == l)
+                m = (requestedRate > inputRate) ? l - 1 : l + 1;
+
+            if (m < 1)
+                continue;
+            const double error = fabs(inputRate * l / m - requestedRate);
+
+            if (error < bestError)
+            {
+                bestError = error;
+                L = l;
+                M = m;
+            }
+        }
+    }
+
+    table = PolyphaseFilterTable::getTable(L, M);
+    outputRate = inputRate * L / M;
+
+    reset();
+}
+
+void PolyphaseResampler::prepare(int numChannels, int maxBlockSize)
+{
+    const int historyLength = (table != nullptr) ? table->getTapsPerPhase() - 1 : 0;
+
+    history.setSize(jmax(1, numChannels), historyLength + maxBlockSize);
+
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    history.clear();
+    nextPosition = 0;
+}
+
+int PolyphaseResampler::getMaxOutputSamples(int numInputSamples) const
+{
+    if (table == nullptr)
+        return numInputSamples;
+
+    return int((int64(numInputSamples) * table->getUpFactor()) / table->getDownFactor()) + 1;
+}
+
+int PolyphaseResampler::process(AudioSampleBuffer& buffer, int numInputSamples)
+{
+    if (table == nullptr)
+        return numInputSamples;
+
+    jassert(table->getUpFactor() <= table->getDownFactor());
+
+    return processChannels(buffer.getArrayOfChannels(), buffer.getArrayOfChannels(),
+                           buffer.getNumChannels(), numInputSamples);
+}
+
+int PolyphaseResampler::process(const AudioSampleBuffer& source, int numInputSamples,
+                                AudioSampleBuffer& dest)
+{
+    jassert(dest.getNumChannels() >= source.getNumChannels());
+    jassert(dest.getNumSamples() >= getMaxOutputSamples(numInputSamples));
+
+    if (table == nullptr)
+    {
+        for (int chan = 0; chan < source.getNumChannels(); chan++)
+            dest.copyFrom(chan, 0, source, chan, 0, numInputSamples);
+
+        return numInputSamples;
+    }
+
+    return processChannels(source.getArrayOfChannels(), dest.getArrayOfChannels(),
+                           source.getNumChannels(), numInputSamples);
+}
+
+int PolyphaseResampler::processChannels(const float* const* input, float* const* output,
+                                        int numChannels, int numInputSamples)
+{
+    const int L = table->getUpFactor();
+    const int M = table->getDownFactor();
+    const int taps = table->getTapsPerPhase();
+    const int historyLength = taps - 1;
+
+    if (history.getNumChannels() < numChannels ||
+        history.getNumSamples() < historyLength + numInputSamples)
+    {
+        // only happens if prepare() was given too small a block size
+        history.setSize(numChannels, historyLength + numInputSamples, true, true);
+    }
+
+    const int64 end = int64(numInputSamples) * L;
+    const int numOutputSamples = (nextPosition < end) ? int((end - nextPosition + M - 1) / M) : 0;
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        float* w = history.getSampleData(chan);
+        float* data = output[chan];
+
+        memcpy(w + historyLength, input[chan], numInputSamples * sizeof(float));
+
+        int64 pos = nextPosition;
+
+        for (int out = 0; out < numOutputSamples; out++, pos += M)
+        {
+            const float* c = table->getPhase(int(pos % L));
+            const float* x = w + int(pos / L);
+
+            // four independent accumulators, so the compiler can vectorise
+            float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+
+            for (int j = 0; j < taps; j += 4)
+            {
+                s0 += c[j] * x[j];
+                s1 += c[j+1] * x[j+1];
+                s2 += c[j+2] * x[j+2];
+                s3 += c[j+3] * x[j+3];
+            }
+
+            // safe to overwrite: the input has been copied into the history
+            data[out] = (s0 + s1) + (s2 + s3);
+        }
+
+        memmove(w, w + numInputSamples, historyLength * sizeof(float));
+    }
+
+    // first position at or beyond the end of this block, relative to the next one
+    nextPosition += int64(numOutputSamples) * M - end;
+
+    return numOutputSamples;
+}
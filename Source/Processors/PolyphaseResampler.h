@@ -0,0 +1,185 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __POLYPHASERESAMPLER_H_C28E5A10__
+#define __POLYPHASERESAMPLER_H_C28E5A10__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Polyphase decomposition of a windowed-sinc low-pass filter, used to
+  convert between sample rates by a rational factor L/M.
+
+  Tables are expensive to design for large decimation factors, so they are
+  shared: getTable() returns a cached copy for a given (L, M) pair, which
+  means that every ResamplingNode using e.g. 30 kHz -> 1 kHz (L/M = 1/30)
+  refers to the same coefficients, and restarting acquisition does not
+  redesign the filter.
+
+  Each phase is stored reversed and zero-padded to a multiple of 4 taps,
+  so that the inner loop of PolyphaseResampler::process() is a forward,
+  unit-stride dot product.
+
+  @see PolyphaseResampler
+
+*/
+
+class PolyphaseFilterTable : public ReferenceCountedObject
+{
+public:
+
+    typedef ReferenceCountedObjectPtr<PolyphaseFilterTable> Ptr;
+
+    /** Returns the (possibly cached) table for an up-sampling factor L and
+        a down-sampling factor M. Message thread only. */
+    static Ptr getTable(int upFactor, int downFactor);
+
+    /** Returns the coefficients for a given phase (0 <= phase < L). */
+    const float* getPhase(int phase) const
+    {
+        return coefficients + phase * tapsPerPhase;
+    }
+
+    /** Returns the number of taps in each phase (a multiple of 4). */
+    int getTapsPerPhase() const
+    {
+        return tapsPerPhase;
+    }
+
+    int getUpFactor() const
+    {
+        return upFactor;
+    }
+
+    int getDownFactor() const
+    {
+        return downFactor;
+    }
+
+private:
+
+    PolyphaseFilterTable(int upFactor, int downFactor);
+
+    int upFactor;
+    int downFactor;
+    int tapsPerPhase;
+
+    HeapBlock<float> coefficients;
+
+    JUCE_DECLARE_NON_COPYABLE(PolyphaseFilterTable);
+
+};
+
+/**
+
+  Changes the sample rate of a multi-channel buffer by a rational factor.
+
+  The resampler keeps the last few input samples of every channel and the
+  position of the next output sample (in units of 1/L input samples)
+  between calls, so the number of output samples is exact over any number
+  of blocks: after N input samples, exactly ceil(N * L / M) outputs have
+  been produced, regardless of how the input was split into blocks.
+
+  The in-place process() only supports down-sampling (output rate <= input
+  rate), because the output is written back into the input buffer. Up-sampling
+  (e.g. to the audio device rate in the AudioNode) uses the variant that
+  writes into a separate buffer.
+
+  @see ResamplingNode, AudioNode, PolyphaseFilterTable
+
+*/
+
+class PolyphaseResampler
+{
+public:
+
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Chooses the rational factor L/M closest to outputRate / inputRate
+        (with L <= maxUpFactor, or maxUpsamplingFactor when up-sampling) and
+        fetches its filter table. Unless allowUpsampling is true, an output
+        rate at or above the input rate bypasses the resampler. Message thread
+        only; the caller must make sure process() is not running. */
+    void setRates(double inputRate, double outputRate, bool allowUpsampling = false);
+
+    /** Returns the actual output rate, which may differ slightly from the
+        requested one if the ratio was not exactly representable. */
+    double getOutputRate() const
+    {
+        return outputRate;
+    }
+
+    /** Returns true if the input is passed through unchanged. */
+    bool isBypassed() const
+    {
+        return table == nullptr;
+    }
+
+    /** Allocates the per-channel history. */
+    void prepare(int numChannels, int maxBlockSize);
+
+    /** Clears the history and restarts the output phase. */
+    void reset();
+
+    /** Resamples the first numInputSamples of every channel in place and
+        returns the number of output samples. */
+    int process(AudioSampleBuffer& buffer, int numInputSamples);
+
+    /** Resamples the first numInputSamples of every channel of source into
+        dest, which must have at least as many channels and room for
+        getMaxOutputSamples(numInputSamples) samples. Returns the number of
+        output samples. */
+    int process(const AudioSampleBuffer& source, int numInputSamples, AudioSampleBuffer& dest);
+
+    /** Returns an upper bound on the number of samples produced from a block
+        of numInputSamples. */
+    int getMaxOutputSamples(int numInputSamples) const;
+
+    enum { maxUpFactor = 64, maxUpsamplingFactor = 512 };
+
+private:
+
+    /** Shared by both versions of process(); input and output may alias. */
+    int processChannels(const float* const* input, float* const* output,
+                        int numChannels, int numInputSamples);
+
+    PolyphaseFilterTable::Ptr table;
+
+    double outputRate;
+
+    /** Last (tapsPerPhase - 1) input samples of every channel, followed by
+        space for the current block. */
+    AudioSampleBuffer history;
+
+    /** Position of the next output sample relative to the start of the
+        next block, in units of 1/L input samples. */
+    int64 nextPosition;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler);
+
+};
+
+
+#endif  // __POLYPHASERESAMPLER_H_C28E5A10__
@@ -41,6 +41,7 @@
 #include "SourceNode.h"
 #include "EventDetector.h"
 #include "SpikeDetector.h"
+#include "SpikeSorter.h"
 #include "PhaseDetector.h"
 #include "WiFiOutput.h"
 #include "FileReader.h"
@@ -250,6 +251,23 @@ Array<GenericProcessor*> ProcessorGraph::getListOfProcessors()
 
 }
 
+Array<GenericProcessor*> ProcessorGraph::getAllProcessors()
+{
+
+    Array<GenericProcessor*> a;
+
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        Node* node = getNode(i);
+
+        if (node->nodeId != OUTPUT_NODE_ID)
+            a.add((GenericProcessor*) node->getProcessor());
+    }
+
+    return a;
+
+}
+
 void ProcessorGraph::clearConnections()
 {
 
@@ -515,6 +533,11 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             std::cout << "Creating a new spike detector." << std::endl;
             processor = new SpikeDetector();
         }
+        else if (subProcessorType.equalsIgnoreCase("Spike Sorter"))
+        {
+            std::cout << "Creating a new spike sorter." << std::endl;
+            processor = new SpikeSorter();
+        }
         else if (subProcessorType.equalsIgnoreCase("Event Detector"))
         {
             std::cout << "Creating a new event detector." << std::endl;
@@ -696,6 +719,34 @@ bool ProcessorGraph::enableProcessors()
         }
     }
 
+    latencyMonitor.clear();
+    deadlineMonitor.clear();
+
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        Node* node = getNode(i);
+
+        if (node->nodeId != OUTPUT_NODE_ID)
+        {
+            GenericProcessor* p = (GenericProcessor*) node->getProcessor();
+
+            p->getProfile()->clearCounters();
+
+            if (latencyMonitor.isEnabled())
+                p->latencyStage = latencyMonitor.addStage(p);
+            else
+                p->latencyStage = nullptr;
+
+            if (deadlineMonitor.isEnabled())
+                p->deadlineMonitor = &deadlineMonitor;
+            else
+                p->deadlineMonitor = nullptr;
+        }
+    }
+
+    if (parallelRenderer.isEnabled())
+        parallelRenderer.build(*this, OUTPUT_NODE_ID);
+
     getEditorViewport()->signalChainCanBeEdited(false);
 
     //	sendActionMessage("Acquisition started.");
@@ -728,8 +779,16 @@ bool ProcessorGraph::disableProcessors()
         }
     }
 
+    parallelRenderer.clear();
+
     getEditorViewport()->signalChainCanBeEdited(true);
 
+    if (latencyMonitor.isEnabled())
+        latencyMonitor.printReport();
+
+    if (deadlineMonitor.isEnabled())
+        deadlineMonitor.printReport();
+
     //	sendActionMessage("Acquisition ended.");
 
     return true;
@@ -770,6 +829,28 @@ void ProcessorGraph::setRecordState(bool isRecording)
 }
 
 
+void ProcessorGraph::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    if (latencyMonitor.isEnabled())
+        latencyMonitor.beginBlock();
+
+    if (deadlineMonitor.isEnabled())
+        deadlineMonitor.beginBlock(buffer.getNumSamples(), getSampleRate());
+
+    if (!parallelRenderer.render(buffer))
+        AudioProcessorGraph::processBlock(buffer, midiMessages);
+
+    if (deadlineMonitor.isEnabled())
+        deadlineMonitor.endBlock();
+}
+
+void ProcessorGraph::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+    AudioProcessorGraph::prepareToPlay(sampleRate, estimatedSamplesPerBlock);
+
+    parallelRenderer.prepare(estimatedSamplesPerBlock);
+}
+
 AudioNode* ProcessorGraph::getAudioNode()
 {
 
@@ -27,6 +27,9 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 
 #include "../AccessClass.h"
+#include "DeadlineMonitor.h"
+#include "LatencyMonitor.h"
+#include "ParallelGraphRenderer.h"
 
 class GenericProcessor;
 class RecordNode;
@@ -85,6 +88,36 @@ public:
 
     Array<GenericProcessor*> getListOfProcessors();
 
+    /** Like getListOfProcessors(), but also includes the RecordNode, AudioNode
+        and ResamplingNode. */
+    Array<GenericProcessor*> getAllProcessors();
+
+    /** Stamps the start of the callback for the LatencyMonitor and the
+        DeadlineMonitor, then processes all nodes, in parallel if the
+        ParallelGraphRenderer is enabled. */
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
+    /** Prepares all nodes, and the parallel renderer's buffers. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    /** Returns the renderer used to process independent branches concurrently. */
+    ParallelGraphRenderer* getParallelRenderer()
+    {
+        return &parallelRenderer;
+    }
+
+    /** Returns the monitor used to measure TTL-to-output latency. */
+    LatencyMonitor* getLatencyMonitor()
+    {
+        return &latencyMonitor;
+    }
+
+    /** Returns the monitor that skips best-effort work in late callbacks. */
+    DeadlineMonitor* getDeadlineMonitor()
+    {
+        return &deadlineMonitor;
+    }
+
 private:
 
     int currentNodeId;
@@ -101,6 +134,12 @@ private:
 
     void clearConnections();
 
+    LatencyMonitor latencyMonitor;
+
+    DeadlineMonitor deadlineMonitor;
+
+    ParallelGraphRenderer parallelRenderer;
+
 };
 
 
@@ -0,0 +1,65 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessorProfile.h"
+
+ProcessorProfile::ProcessorProfile()
+{
+    clearCounters();
+}
+
+void ProcessorProfile::clearCounters()
+{
+    numBlocks = 0;
+    numSamples = 0;
+    numAllocations = 0;
+    numSkipped = 0;
+    totalTicks = 0;
+    maxTicks = 0;
+    lastTicks = 0;
+
+    resetPending = 0;
+}
+
+void ProcessorProfile::getSnapshot(Snapshot& s) const
+{
+    if (resetPending.get() != 0)
+    {
+        s.numBlocks = 0;
+        s.numSamples = 0;
+        s.numAllocations = 0;
+        s.numSkipped = 0;
+        s.totalSeconds = 0.0;
+        s.maxSeconds = 0.0;
+        s.lastSeconds = 0.0;
+        return;
+    }
+
+    s.numBlocks = numBlocks.get();
+    s.numSamples = numSamples.get();
+    s.numAllocations = numAllocations.get();
+    s.numSkipped = numSkipped.get();
+    s.totalSeconds = Time::highResolutionTicksToSeconds(totalTicks.get());
+    s.maxSeconds = Time::highResolutionTicksToSeconds(maxTicks.get());
+    s.lastSeconds = Time::highResolutionTicksToSeconds(lastTicks.get());
+}
@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROCESSORPROFILE_H_3E8B61D7__
+#define __PROCESSORPROFILE_H_3E8B61D7__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Per-processor timing and allocation counters.
+
+  Every GenericProcessor owns a ProcessorProfile, which is updated at the
+  end of each processBlock() call with the time spent in that processor
+  (measured with the high-resolution tick counter), the number of samples
+  in the block, the number of heap allocations made by addEvent(), and
+  the number of blocks skipped by the DeadlineMonitor.
+
+  The audio thread is the only writer. All counters are Atomic, so the
+  ProfilerPanel can read them from the message thread without taking a
+  lock; a snapshot may mix values from two consecutive blocks, which is
+  harmless for display purposes. Resetting from the message thread only
+  raises a flag, and the counters are cleared by the audio thread at the
+  start of the next block.
+
+  @see GenericProcessor, ProfilerPanel
+
+*/
+
+class ProcessorProfile
+{
+public:
+
+    ProcessorProfile();
+
+    /** A copy of the counters at a given moment. */
+    struct Snapshot
+    {
+        int64 numBlocks;
+        int64 numSamples;
+        int64 numAllocations;
+        int64 numSkipped;
+        double totalSeconds;
+        double maxSeconds;
+        double lastSeconds;
+    };
+
+    /** Records one processBlock() call (audio thread only). */
+    void blockProcessed(int nSamples, int64 elapsedTicks)
+    {
+        if (resetPending.get() != 0)
+            clearCounters();
+
+        numBlocks += 1;
+        numSamples += nSamples;
+        totalTicks += elapsedTicks;
+        lastTicks = elapsedTicks;
+
+        if (elapsedTicks > maxTicks.get())
+            maxTicks = elapsedTicks;
+    }
+
+    /** Records a block skipped because the callback ran late. */
+    void blockSkipped()
+    {
+        numSkipped += 1;
+    }
+
+    /** Records a heap allocation made on the audio thread. */
+    void allocationMade()
+    {
+        numAllocations += 1;
+    }
+
+    /** Copies the current counters into a Snapshot (any thread). */
+    void getSnapshot(Snapshot& s) const;
+
+    /** Asks the audio thread to clear the counters before the next block. */
+    void reset()
+    {
+        resetPending = 1;
+    }
+
+    /** Clears the counters immediately. Only safe while callbacks are stopped. */
+    void clearCounters();
+
+private:
+
+    Atomic<int64> numBlocks;
+    Atomic<int64> numSamples;
+    Atomic<int64> numAllocations;
+    Atomic<int64> numSkipped;
+    Atomic<int64> totalTicks;
+    Atomic<int64> maxTicks;
+    Atomic<int64> lastTicks;
+
+    Atomic<int> resetPending;
+
+    JUCE_DECLARE_NON_COPYABLE(ProcessorProfile);
+
+};
+
+
+#endif  // __PROCESSORPROFILE_H_3E8B61D7__
@@ -59,6 +59,18 @@ public:
     */
     void process(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer, int& nSamples);
 
+    /** Only reads the continuous channels. */
+    bool isPassThrough()
+    {
+        return true;
+    }
+
+    /** Recording must never be skipped. */
+    int getPriorityClass()
+    {
+        return CRITICAL_PRIORITY;
+    }
+
 
     /** Overrides implementation in GenericProcessor; used to change recording parameters
         on the fly.
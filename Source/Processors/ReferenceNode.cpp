@@ -26,9 +26,111 @@
 #include "Editors/ReferenceNodeEditor.h"
 
 
+MedianNetwork::MedianNetwork() : numInputs(0)
+{
+
+}
+
+void MedianNetwork::build(int n)
+{
+    numInputs = n;
+    comparators.clearQuick();
+
+    if (numInputs < 3)
+        return;
+
+    int size = 1;
+
+    while (size < numInputs)
+        size <<= 1;
+
+    // Batcher's odd-even merge sort for the next power of two; the missing
+    // inputs behave like +inf, so any comparator touching them does nothing
+    Array<int> network;
+
+    for (int p = 1; p < size; p <<= 1)
+    {
+        for (int k = p; k >= 1; k >>= 1)
+        {
+            for (int j = k % p; j + k < size; j += 2*k)
+            {
+                for (int i = 0; i < jmin(k, size - j - k); i++)
+                {
+                    if ((i + j) / (2*p) == (i + j + k) / (2*p) && i + j + k < numInputs)
+                    {
+                        network.add(i + j);
+                        network.add(i + j + k);
+                    }
+                }
+            }
+        }
+    }
+
+    // walk backwards from the middle element(s), keeping only the
+    // comparators that can change them
+    Array<bool> needed;
+    needed.insertMultiple(0, false, numInputs);
+    needed.set((numInputs - 1) / 2, true);
+    needed.set(numInputs / 2, true);
+
+    Array<int> pruned;
+
+    for (int c = network.size() - 2; c >= 0; c -= 2)
+    {
+        const int a = network[c];
+        const int b = network[c+1];
+
+        if (needed[a] || needed[b])
+        {
+            pruned.add(b);
+            pruned.add(a);
+            needed.set(a, true);
+            needed.set(b, true);
+        }
+    }
+
+    for (int c = pruned.size() - 1; c >= 0; c--)
+        comparators.add(pruned[c]);
+
+}
+
+void MedianNetwork::apply(float* rows, int stride, int numSamples, float* median) const
+{
+    if (numInputs == 0)
+        return;
+
+    for (int c = 0; c < comparators.size(); c += 2)
+    {
+        float* lo = rows + comparators.getUnchecked(c)*stride;
+        float* hi = rows + comparators.getUnchecked(c+1)*stride;
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            const float x = lo[i];
+            const float y = hi[i];
+            lo[i] = y < x ? y : x;
+            hi[i] = y < x ? x : y;
+        }
+    }
+
+    const float* lower = rows + ((numInputs - 1) / 2)*stride;
+    const float* upper = rows + (numInputs / 2)*stride;
+
+    if (lower == upper)
+    {
+        FloatVectorOperations::copy(median, lower, numSamples);
+    }
+    else
+    {
+        for (int i = 0; i < numSamples; i++)
+            median[i] = 0.5f * (lower[i] + upper[i]);
+    }
+}
+
 
 ReferenceNode::ReferenceNode()
-    : GenericProcessor("Digital Ref"), referenceChannel(-1), referenceBuffer(1,10000)
+    : GenericProcessor("Digital Ref"), referenceChannel(-1), referenceMode(SINGLE_CHANNEL),
+      groupSize(0), numGroupedChannels(0), referenceBuffer(1,10000)
 {
 
 }
@@ -51,8 +153,21 @@ AudioProcessorEditor* ReferenceNode::createEditor()
 
 void ReferenceNode::updateSettings()
 {
+    updateGroups();
+}
+
+void ReferenceNode::updateGroups()
+{
+    numGroupedChannels = getNumInputs();
 
+    const int length = (groupSize > 0) ? jmin(groupSize, numGroupedChannels) : numGroupedChannels;
 
+    tile.allocate(jmax(length, 1) * tileSize, true);
+
+    groupNetwork.build(length);
+
+    if (length > 0)
+        lastGroupNetwork.build(numGroupedChannels % length);
 
 }
 
@@ -60,9 +175,74 @@ void ReferenceNode::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
 
-    referenceChannel = (int) newValue;
+    if (parameterIndex == 2)
+    {
+        referenceMode = (int) newValue;
+
+        std::cout << "Reference mode set to " << referenceMode << std::endl;
+    }
+    else if (parameterIndex == 3)
+    {
+        // only changed while acquisition is stopped
+        groupSize = (int) newValue;
+        updateGroups();
+
+        std::cout << "Reference group size set to " << groupSize << std::endl;
+    }
+    else
+    {
+        referenceChannel = (int) newValue;
+
+        std::cout << "Reference set to " << referenceChannel << std::endl;
+    }
+
+}
+
+void ReferenceNode::subtractCommonReference(AudioSampleBuffer& buffer, int nSamples, bool median)
+{
+    const int numChannels = numGroupedChannels;
+
+    if (numChannels == 0 || buffer.getNumChannels() < numChannels)
+        return;
+
+    const int length = (groupSize > 0) ? jmin(groupSize, numChannels) : numChannels;
 
-    std::cout << "Reference set to " << referenceChannel << std::endl;
+    float* reference = referenceBuffer.getSampleData(0);
+
+    for (int start = 0; start < nSamples; start += tileSize)
+    {
+        const int n = jmin((int) tileSize, nSamples - start);
+
+        for (int first = 0; first < numChannels; first += length)
+        {
+            const int count = jmin(length, numChannels - first);
+
+            // pass 1: the reference for every sample in this tile
+            if (median)
+            {
+                for (int i = 0; i < count; i++)
+                    FloatVectorOperations::copy(tile + i*tileSize, buffer.getSampleData(first + i, start), n);
+
+                if (count == length)
+                    groupNetwork.apply(tile, tileSize, n, reference);
+                else
+                    lastGroupNetwork.apply(tile, tileSize, n, reference);
+            }
+            else
+            {
+                FloatVectorOperations::copy(reference, buffer.getSampleData(first, start), n);
+
+                for (int i = 1; i < count; i++)
+                    FloatVectorOperations::add(reference, buffer.getSampleData(first + i, start), n);
+
+                FloatVectorOperations::multiply(reference, 1.0f / float(count), n);
+            }
+
+            // pass 2: subtract it while the group is still in the cache
+            for (int i = 0; i < count; i++)
+                FloatVectorOperations::addWithMultiply(buffer.getSampleData(first + i, start), reference, -1.0f, n);
+        }
+    }
 
 }
 
@@ -71,7 +251,11 @@ void ReferenceNode::process(AudioSampleBuffer& buffer,
                             int& nSamples)
 {
 
-    if (referenceChannel > -1)
+    if (referenceMode == COMMON_AVERAGE || referenceMode == COMMON_MEDIAN)
+    {
+        subtractCommonReference(buffer, nSamples, referenceMode == COMMON_MEDIAN);
+    }
+    else if (referenceChannel > -1)
     {
         referenceBuffer.clear(0, 0, nSamples);
 
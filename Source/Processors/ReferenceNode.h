@@ -30,11 +30,57 @@
 #include "GenericProcessor.h"
 
 
+/**
+
+  Compare-exchange network that finds the median of a fixed number of inputs.
+
+  The network is Batcher's odd-even merge sort, pruned to the comparators that
+  can affect the middle element(s). Each comparator is applied to a whole row
+  of samples at once, so the inner loop is a branch-free min/max that the
+  compiler vectorizes.
+
+  @see ReferenceNode
+
+*/
+
+class MedianNetwork
+{
+public:
+
+    MedianNetwork();
+
+    /** Builds the network for a given number of inputs (message thread only). */
+    void build(int numInputs);
+
+    /** Sorts the rows far enough to find the median of each column, and writes
+        it to median. The rows are overwritten. */
+    void apply(float* rows, int stride, int numSamples, float* median) const;
+
+    /** Returns the number of compare-exchange operations in the network. */
+    int getNumComparators() const
+    {
+        return comparators.size() / 2;
+    }
+
+private:
+
+    int numInputs;
+
+    Array<int> comparators;
+
+};
+
 /**
 
   Digital reference node
 
-  @see GenericProcessor
+  Subtracts either a single reference channel or a common reference from every
+  channel. The common average (CAR) or common median (CMR) is computed
+  separately for each group of adjacent channels (e.g. one shank or one
+  headstage), in tiles of tileSize samples so each group stays in the cache
+  between computing the reference and subtracting it.
+
+  @see GenericProcessor, MedianNetwork
 
 */
 
@@ -47,8 +93,18 @@ public:
     ~ReferenceNode();
 
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
+    /** Parameter 1 sets the reference channel (-1 for none), parameter 2 the
+        reference mode and parameter 3 the group size (0 for all channels).*/
     void setParameter(int parameterIndex, float newValue);
 
+    enum ReferenceMode
+    {
+        SINGLE_CHANNEL = 0,
+        COMMON_AVERAGE,
+        COMMON_MEDIAN
+    };
+
     AudioProcessorEditor* createEditor();
 
     bool hasEditor() const
@@ -60,10 +116,26 @@ public:
 
 private:
 
+    /** Sizes the scratch space and median networks for the current groups. */
+    void updateGroups();
+
+    void subtractCommonReference(AudioSampleBuffer& buffer, int nSamples, bool median);
+
+    enum { tileSize = 64 };
+
     int referenceChannel;
+    int referenceMode;
+    int groupSize;
+
+    int numGroupedChannels;
 
     AudioSampleBuffer referenceBuffer;
 
+    HeapBlock<float> tile;
+
+    MedianNetwork groupNetwork;
+    MedianNetwork lastGroupNetwork;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReferenceNode);
 
 };
@@ -28,21 +28,18 @@
 
 ResamplingNode::ResamplingNode()
     : GenericProcessor("Resampler"),
-      targetSampleRate(5000.0f), ratio(1.0)
+      targetSampleRate(5000.0f), sourceBufferSampleRate(0.0)
 {
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     parameters.add(Parameter("Hz",500.0f, 10000.0f, targetSampleRate, 0, true));
 
-    tempBuffer = new AudioSampleBuffer(16, TEMP_BUFFER_WIDTH);
+    resampler = new PolyphaseResampler();
 
 }
 
 ResamplingNode::~ResamplingNode()
 {
-    filter = 0;
+
 }
 
 AudioProcessorEditor* ResamplingNode::createEditor()
@@ -65,16 +62,21 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 
         targetSampleRate = newValue;
 
-        settings.sampleRate = targetSampleRate;
+        if (sourceBufferSampleRate <= 0)
+            return; // not connected yet; applied in updateSettings()
 
-        ratio = sourceBufferSampleRate / targetSampleRate;
+        // the filter table is designed (or fetched from the cache) outside
+        // the lock, so the audio thread is only blocked for the swap
+        PolyphaseResampler* newResampler = new PolyphaseResampler();
+        newResampler->setRates(sourceBufferSampleRate, targetSampleRate);
+        newResampler->prepare(getNumInputs(), TEMP_BUFFER_WIDTH);
 
-        for (int i = 0; i < channels.size(); i++)
         {
-            channels[i]->sampleRate = targetSampleRate;
+            const ScopedLock sl(resamplerLock);
+            resampler = newResampler;
         }
 
-        updateFilter();
+        updateChannelSampleRates();
 
         //std::cout << "Got parameter update." << std::endl;
     }
@@ -86,10 +88,7 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 bool ResamplingNode::enable()
 {
 
-
-    tempBuffer->clear();
-
-    updateFilter();
+    resampler->reset();
 
     return true;
 
@@ -99,137 +98,37 @@ void ResamplingNode::updateSettings()
 {
 
     sourceBufferSampleRate = settings.sampleRate;
-    settings.sampleRate = targetSampleRate;
 
-    if (getNumInputs() > 0)
-        tempBuffer->setSize(getNumInputs(), TEMP_BUFFER_WIDTH);
+    resampler = new PolyphaseResampler();
+    resampler->setRates(sourceBufferSampleRate, targetSampleRate);
+    resampler->prepare(getNumInputs(), TEMP_BUFFER_WIDTH);
 
-    ratio = sourceBufferSampleRate / targetSampleRate;
+    if (resampler->isBypassed())
+        std::cout << "Resampler: target rate is not below the source rate; data will be passed through." << std::endl;
 
-    for (int i = 0; i < channels.size(); i++)
-    {
-        channels[i]->sampleRate = targetSampleRate;
-    }
-
-    updateFilter();
+    updateChannelSampleRates();
 
 }
 
-
-void ResamplingNode::updateFilter()
+void ResamplingNode::updateChannelSampleRates()
 {
+    // the actual rate can differ slightly from targetSampleRate if
+    // the ratio had to be approximated
+    settings.sampleRate = resampler->getOutputRate();
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * targetSampleRate  // downsample
-                        : targetSampleRate / 2; // upsample
-
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : targetSampleRate;  // upsample
-
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
-
-    filter->setParams(params);
-
+    for (int i = 0; i < channels.size(); i++)
+    {
+        channels[i]->sampleRate = settings.sampleRate;
+    }
 }
 
-// void ResamplingNode::releaseResources()
-// {
-// 	//fclose(file);
-// }
-
 void ResamplingNode::process(AudioSampleBuffer& buffer,
                              MidiBuffer& midiMessages,
                              int& nSamples)
 {
 
-    //std::cout << "Resampling node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
-
-    // save data at the beginning of each round of processing
-    //writeContinuousBuffer(buffer.getSampleData(0), nSamples, 0);
-
-
-    int nSamps = float(nSamples);
-    int valuesNeeded = int(nSamps / ratio);
-
-    if (ratio > 1.0001)
-    {
-        // pre-apply filter before downsampling
-        filter->process(nSamples, buffer.getArrayOfChannels());
-    }
-
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-    int tempBufferPos;
-
-    // code modified from "juce_ResamplingAudioSource.cpp":
-
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
-    {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
-
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
-
-        }
-
-        subSampleOffset += ratio;
-
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
-    }
-
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
-
-
-    if (ratio < 0.9999)
-    {
-
-        filter->process(tempBufferPos, tempBuffer->getArrayOfChannels());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
-    }
-    else if (ratio <= 1.0001)
-    {
-
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
-
-    }
-
-    // copy the tempBuffer back into the original buffer
-    buffer = AudioSampleBuffer(tempBuffer->getArrayOfChannels(), 2, tempBufferPos);//buffer.getNumSamples());
+    const ScopedLock sl(resamplerLock);
 
-    nSamples = valuesNeeded;
+    nSamples = resampler->process(buffer, nSamples);
 
 }
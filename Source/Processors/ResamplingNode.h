@@ -26,8 +26,8 @@
 
 
 #include "../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "GenericProcessor.h"
+#include "PolyphaseResampler.h"
 
 #define TEMP_BUFFER_WIDTH 5000
 
@@ -35,9 +35,12 @@
 
   Changes the sample rate of continuous data.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  Uses a polyphase FIR filter (see PolyphaseResampler) to decimate by a
+  rational factor, e.g. 30 kHz -> 1 kHz for LFP extraction. Only
+  down-sampling is supported; if the target rate is not below the
+  source rate, data are passed through unchanged.
 
-  @see GenericProcessor
+  @see GenericProcessor, PolyphaseResampler
 
 */
 
@@ -55,8 +58,6 @@ public:
 
     void updateSettings();
 
-    void updateFilter();
-
     bool enable();
 
     AudioProcessorEditor* createEditor();
@@ -67,24 +68,18 @@ public:
 
 private:
 
-    // sample rate, timebase, and ratio info:
+    /** Copies the resampler's output rate into the settings and channels. */
+    void updateChannelSampleRates();
+
+    // sample rate info:
     double targetSampleRate;
-    double sourceBufferSampleRate; //, destBufferSampleRate;
-    double ratio; //, lastRatio;
-    //double destBufferTimebaseSecs;
-    //int destBufferWidth;
+    double sourceBufferSampleRate;
 
     // major objects:
-    Dsp::Filter* filter;
-    //ScopedPointer<AudioSampleBuffer> destBuffer;
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
-
-    // is the destBuffer a temp buffer or not?
-    //bool destBufferIsTempBuffer;
-    //bool isTransmitting;
+    ScopedPointer<PolyphaseResampler> resampler;
 
-    // indexing objects that persist between rounds:
-    //int destBufferPos;
+    /** Held by process() and while setParameter() swaps in a new resampler. */
+    CriticalSection resamplerLock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingNode);
 
@@ -0,0 +1,453 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SignalChainBenchmark.h"
+
+#include "GenericProcessor.h"
+#include "FilterNode.h"
+#include "FilterBank.h"
+#include "ReferenceNode.h"
+#include "SpikeDetector.h"
+#include "ChannelMappingNode.h"
+#include "ResamplingNode.h"
+#include "RecordNode.h"
+
+#include <stdio.h>
+
+// number of distinct blocks of synthetic data that are cycled through
+#define NUM_DATA_BLOCKS 4
+
+// largest allowed float/double filter difference, relative to the peak output
+#define FILTER_TOLERANCE 1.0e-4
+
+/**
+
+  Supplies the channel count and sample rate to the processor under test.
+
+  The data itself is copied into the buffer by the benchmark loop, so
+  process() does nothing.
+
+*/
+
+class BenchmarkSource : public GenericProcessor
+{
+public:
+    BenchmarkSource(int numChannels_, float sampleRate_)
+        : GenericProcessor("Benchmark Source"), numChannels(numChannels_), rate(sampleRate_)
+    {
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples) {}
+
+    bool isSource()
+    {
+        return true;
+    }
+
+    int getDefaultNumOutputs()
+    {
+        return numChannels;
+    }
+
+    float getDefaultSampleRate()
+    {
+        return rate;
+    }
+
+private:
+    int numChannels;
+    float rate;
+};
+
+static Array<int> parseIntegerList(const String& s)
+{
+    StringArray tokens;
+    tokens.addTokens(s, ",", "");
+
+    Array<int> values;
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        int v = tokens[i].getIntValue();
+
+        if (v > 0)
+            values.add(v);
+    }
+
+    return values;
+}
+
+SignalChainBenchmark::SignalChainBenchmark()
+    : sampleRate(30000.0f), secondsPerTest(2.0)
+{
+    channelCounts.add(32);
+    channelCounts.add(64);
+    channelCounts.add(128);
+    channelCounts.add(256);
+    channelCounts.add(512);
+    channelCounts.add(1024);
+    channelCounts.add(2048);
+
+    bufferSizes.add(256);
+    bufferSizes.add(1024);
+}
+
+SignalChainBenchmark::~SignalChainBenchmark()
+{
+
+}
+
+void SignalChainBenchmark::parseCommandLine(const StringArray& parameters)
+{
+    for (int i = 0; i < parameters.size() - 1; i++)
+    {
+        const String& value = parameters[i+1];
+
+        if (parameters[i] == "--channels")
+            channelCounts = parseIntegerList(value);
+        else if (parameters[i] == "--buffers")
+            bufferSizes = parseIntegerList(value);
+        else if (parameters[i] == "--rate")
+            sampleRate = jmax(1000.0f, value.getFloatValue());
+        else if (parameters[i] == "--seconds")
+            secondsPerTest = jmax(0.1, value.getDoubleValue());
+        else if (parameters[i] == "--csv")
+            csvFile = File::getCurrentWorkingDirectory().getChildFile(value.unquoted());
+    }
+}
+
+int SignalChainBenchmark::getNumProcessorTypes()
+{
+    return 6;
+}
+
+GenericProcessor* SignalChainBenchmark::createProcessor(int index)
+{
+    switch (index)
+    {
+        case 0:
+            return new FilterNode();
+        case 1:
+            return new ReferenceNode();
+        case 2:
+            return new SpikeDetector();
+        case 3:
+            return new ChannelMappingNode();
+        case 4:
+            return new ResamplingNode();
+        default:
+            return new RecordNode();
+    }
+}
+
+void SignalChainBenchmark::generateData(AudioSampleBuffer& data, int bufferSize)
+{
+    // roughly Gaussian background noise (10 uV rms), plus biphasic
+    // transients at ~20 Hz per channel so that the SpikeDetector has
+    // threshold crossings to extract
+
+    const int numSamples = data.getNumSamples();
+    const float spikeProbability = 20.0f / sampleRate;
+
+    for (int chan = 0; chan < data.getNumChannels(); chan++)
+    {
+        float* ptr = data.getSampleData(chan);
+
+        for (int n = 0; n < numSamples; n++)
+        {
+            ptr[n] = (random.nextFloat() + random.nextFloat() + random.nextFloat() - 1.5f) * 20.0f;
+        }
+
+        for (int n = 0; n < numSamples - 40; n++)
+        {
+            if (random.nextFloat() < spikeProbability)
+            {
+                for (int k = 0; k < 30; k++)
+                {
+                    float t = float(k) / 30.0f;
+                    ptr[n+k] += -150.0f * sinf(t * float_Pi) * (1.0f - 1.5f * t);
+                }
+
+                n += 40;
+            }
+        }
+    }
+}
+
+SignalChainBenchmark::Result SignalChainBenchmark::runTest(int processorIndex, int numChannels, int bufferSize)
+{
+    Result r;
+    r.numChannels = numChannels;
+    r.bufferSize = bufferSize;
+    r.numBlocks = 0;
+    r.deadlineMisses = 0;
+    r.totalSeconds = 0.0;
+    r.maxBlockSeconds = 0.0;
+
+    ScopedPointer<BenchmarkSource> source = new BenchmarkSource(numChannels, sampleRate);
+    source->setNodeId(100);
+    source->createEditor();
+    source->update();
+
+    ScopedPointer<GenericProcessor> processor = createProcessor(processorIndex);
+    r.processorName = processor->getName();
+
+    processor->setNodeId(101);
+    processor->createEditor();
+    processor->setSourceNode(source);
+    processor->update();
+
+    if (processorIndex == 1)
+    {
+        // subtract channel 0 from all channels
+        processor->setParameter(0, 0.0f);
+    }
+    else if (processorIndex == 2)
+    {
+        // tile the input with tetrodes
+        SpikeDetector* sd = (SpikeDetector*) processor.get();
+
+        while (sd->addElectrode(4)) {}
+    }
+    else if (processorIndex == 5)
+    {
+        // opening files requires the ControlPanel and EditorViewport
+        r.note = "not recording to disk";
+    }
+
+    processor->enable();
+
+    AudioSampleBuffer data(numChannels, bufferSize * NUM_DATA_BLOCKS);
+    generateData(data, bufferSize);
+
+    AudioSampleBuffer buffer(numChannels, bufferSize);
+    MidiBuffer events;
+
+    const double deadline = double(bufferSize) / sampleRate;
+    const int64 numBlocks = jmax((int64) 1, (int64) (secondsPerTest * sampleRate / bufferSize));
+
+    // AudioProcessor::processBlock() is public; GenericProcessor's override is not
+    AudioProcessor* ap = processor;
+
+    for (int64 block = 0; block < numBlocks; block++)
+    {
+        const int offset = int(block % NUM_DATA_BLOCKS) * bufferSize;
+
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.copyFrom(chan, 0, data, chan, offset, bufferSize);
+
+        events.clear();
+
+        uint8 bufferSizeEvent[2];
+        bufferSizeEvent[0] = GenericProcessor::BUFFER_SIZE;
+        bufferSizeEvent[1] = source->getNodeId();
+        events.addEvent(bufferSizeEvent, 2, bufferSize);
+
+        const int64 start = Time::getHighResolutionTicks();
+
+        ap->processBlock(buffer, events);
+
+        const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        r.totalSeconds += elapsed;
+        r.numBlocks++;
+
+        if (elapsed > r.maxBlockSeconds)
+            r.maxBlockSeconds = elapsed;
+
+        if (elapsed > deadline)
+            r.deadlineMisses++;
+    }
+
+    processor->disable();
+
+    return r;
+}
+
+bool SignalChainBenchmark::checkFilterPrecision()
+{
+    // an odd number of channels exercises both the paired and the
+    // single-channel paths of Dsp::Cascade
+    const int numChannels = 5;
+    const int bufferSize = bufferSizes.size() > 0 ? bufferSizes[0] : 1024;
+    const int numBlocks = jmax(1, int(sampleRate / bufferSize));
+
+    const FilterBankKey key(2, sampleRate, 300.0, jmin(6000.0, 0.4 * sampleRate));
+
+    ScopedPointer<FilterBank> doubleBank = FilterBank::create(false);
+    ScopedPointer<FilterBank> floatBank = FilterBank::create(true);
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        doubleBank->setBand(chan, key);
+        floatBank->setBand(chan, key);
+    }
+
+    AudioSampleBuffer data(numChannels, bufferSize * NUM_DATA_BLOCKS);
+    generateData(data, bufferSize);
+
+    AudioSampleBuffer doubleBuffer(numChannels, bufferSize);
+    AudioSampleBuffer floatBuffer(numChannels, bufferSize);
+
+    double maxError = 0.0;
+    double peak = 0.0;
+
+    for (int block = 0; block < numBlocks; block++)
+    {
+        const int offset = (block % NUM_DATA_BLOCKS) * bufferSize;
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            doubleBuffer.copyFrom(chan, 0, data, chan, offset, bufferSize);
+            floatBuffer.copyFrom(chan, 0, data, chan, offset, bufferSize);
+        }
+
+        doubleBank->process(doubleBuffer, bufferSize);
+        floatBank->process(floatBuffer, bufferSize);
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            const float* d = doubleBuffer.getSampleData(chan);
+            const float* f = floatBuffer.getSampleData(chan);
+
+            for (int n = 0; n < bufferSize; n++)
+            {
+                maxError = jmax(maxError, (double) fabsf(d[n] - f[n]));
+                peak = jmax(peak, (double) fabsf(d[n]));
+            }
+        }
+    }
+
+    const bool passed = maxError <= FILTER_TOLERANCE * peak;
+
+    std::cout << "Filter precision (" << key.lowCut << "-" << key.highCut << " Hz, float vs. double): "
+              << "max error " << maxError << ", peak " << peak
+              << (passed ? " -- OK" : " -- FAILED") << std::endl;
+
+    return passed;
+}
+
+bool SignalChainBenchmark::run()
+{
+    results.clear();
+
+    const bool filtersPassed = checkFilterPrecision();
+
+    for (int p = 0; p < getNumProcessorTypes(); p++)
+    {
+        for (int c = 0; c < channelCounts.size(); c++)
+        {
+            for (int b = 0; b < bufferSizes.size(); b++)
+            {
+                std::cout << "Benchmark: processor " << p + 1 << "/" << getNumProcessorTypes()
+                          << ", " << channelCounts[c] << " channels, "
+                          << bufferSizes[b] << " samples per buffer" << std::endl;
+
+                results.add(runTest(p, channelCounts[c], bufferSizes[b]));
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << "Signal chain benchmark (" << sampleRate << " Hz, "
+              << secondsPerTest << " s of data per test)" << std::endl;
+
+    std::cout << String("processor").paddedRight(' ', 18)
+              << String("channels").paddedLeft(' ', 9)
+              << String("buffer").paddedLeft(' ', 8)
+              << String("samples/s").paddedLeft(' ', 14)
+              << String("ns/ch-sample").paddedLeft(' ', 14)
+              << String("x realtime").paddedLeft(' ', 12)
+              << String("max (us)").paddedLeft(' ', 11)
+              << String("misses").paddedLeft(' ', 14)
+              << std::endl;
+
+    for (int i = 0; i < results.size(); i++)
+        printResult(results.getReference(i));
+
+    if (csvFile != File::nonexistent)
+        writeCsv(csvFile);
+
+    return filtersPassed;
+}
+
+void SignalChainBenchmark::printResult(const Result& r)
+{
+    String line = r.processorName.paddedRight(' ', 18)
+                  + String(r.numChannels).paddedLeft(' ', 9)
+                  + String(r.bufferSize).paddedLeft(' ', 8);
+
+    if (r.numBlocks > 0 && r.totalSeconds > 0.0)
+    {
+        const double samples = double(r.numBlocks) * r.bufferSize;
+
+        line += String(samples / r.totalSeconds, 0).paddedLeft(' ', 14)
+                + String(r.totalSeconds * 1.0e9 / (samples * r.numChannels), 3).paddedLeft(' ', 14)
+                + String(samples / sampleRate / r.totalSeconds, 1).paddedLeft(' ', 12)
+                + String(r.maxBlockSeconds * 1.0e6, 1).paddedLeft(' ', 11)
+                + (String(r.deadlineMisses) + "/" + String(r.numBlocks)).paddedLeft(' ', 14);
+    }
+
+    if (r.note.isNotEmpty())
+        line += "  " + r.note;
+
+    std::cout << line << std::endl;
+}
+
+void SignalChainBenchmark::writeCsv(const File& file)
+{
+    file.deleteFile();
+
+    ScopedPointer<FileOutputStream> stream(file.createOutputStream());
+
+    if (stream == nullptr)
+    {
+        std::cout << "Could not write " << file.getFullPathName() << std::endl;
+        return;
+    }
+
+    *stream << "processor,channels,buffer_size,sample_rate,blocks,total_s,"
+            << "samples_per_s,ns_per_channel_sample,max_block_us,deadline_misses,note" << newLine;
+
+    for (int i = 0; i < results.size(); i++)
+    {
+        const Result& r = results.getReference(i);
+        const double samples = double(r.numBlocks) * r.bufferSize;
+
+        *stream << r.processorName << ","
+                << r.numChannels << ","
+                << r.bufferSize << ","
+                << String(sampleRate) << ","
+                << String(r.numBlocks) << ","
+                << String(r.totalSeconds, 6) << ","
+                << String(r.totalSeconds > 0.0 ? samples / r.totalSeconds : 0.0, 1) << ","
+                << String(samples > 0.0 ? r.totalSeconds * 1.0e9 / (samples * r.numChannels) : 0.0, 4) << ","
+                << String(r.maxBlockSeconds * 1.0e6, 2) << ","
+                << String(r.deadlineMisses) << ","
+                << r.note << newLine;
+    }
+
+    stream->flush();
+
+    std::cout << "Results written to " << file.getFullPathName() << std::endl;
+}
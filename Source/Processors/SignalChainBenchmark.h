@@ -0,0 +1,125 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SIGNALCHAINBENCHMARK_H_0F6D2B94__
+#define __SIGNALCHAINBENCHMARK_H_0F6D2B94__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+class GenericProcessor;
+
+/**
+
+  Measures the throughput of individual processors without the GUI.
+
+  Started with "open-ephys --benchmark". For every combination of processor,
+  channel count and buffer size, the benchmark connects the processor to a
+  synthetic source, feeds it blocks of noise with occasional spike-shaped
+  transients, and times each processBlock() call. Results are printed as a
+  table and can optionally be written to a CSV file.
+
+  Options (all optional):
+
+      --channels 32,128,512,2048    channel counts to test
+      --buffers 256,1024            buffer sizes (samples per block)
+      --rate 30000                  sample rate of the synthetic source
+      --seconds 2                   amount of simulated data per test
+      --csv results.csv             also write the results to a file
+
+  A "deadline miss" is a block that took longer to process than the
+  real-time duration of the block (buffer size / sample rate).
+
+  Before the timings, the single-precision FilterBank (FilterNode's "F32"
+  option) is checked against the double-precision one on the same data; the
+  largest difference must stay below FILTER_TOLERANCE times the peak output;
+  if it does not, the timings are still run, but the application exits
+  with a return value of 1.
+
+  @see ProcessorProfile
+
+*/
+
+class SignalChainBenchmark
+{
+public:
+
+    SignalChainBenchmark();
+    ~SignalChainBenchmark();
+
+    /** Reads the options listed above from the command line. */
+    void parseCommandLine(const StringArray& parameters);
+
+    /** Runs all tests and prints the results. Returns false if the filter
+        precision check failed. */
+    bool run();
+
+    /** Compares single- and double-precision spike-band filtering and prints
+        the largest difference. Returns true if it is within tolerance. */
+    bool checkFilterPrecision();
+
+private:
+
+    /** The result of one test. */
+    struct Result
+    {
+        String processorName;
+        int numChannels;
+        int bufferSize;
+        int64 numBlocks;
+        int64 deadlineMisses;
+        double totalSeconds;
+        double maxBlockSeconds;
+        String note;
+    };
+
+    /** Creates one of the processors under test (index < getNumProcessorTypes()). */
+    GenericProcessor* createProcessor(int index);
+
+    /** Returns the number of processor types that are tested. */
+    int getNumProcessorTypes();
+
+    /** Runs a single test. */
+    Result runTest(int processorIndex, int numChannels, int bufferSize);
+
+    /** Fills the synthetic data buffer. */
+    void generateData(AudioSampleBuffer& data, int bufferSize);
+
+    void printResult(const Result& r);
+    void writeCsv(const File& file);
+
+    Array<int> channelCounts;
+    Array<int> bufferSizes;
+    float sampleRate;
+    double secondsPerTest;
+    File csvFile;
+
+    Array<Result> results;
+
+    Random random;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalChainBenchmark);
+
+};
+
+
+#endif  // __SIGNALCHAINBENCHMARK_H_0F6D2B94__
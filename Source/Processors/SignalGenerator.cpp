@@ -27,19 +27,21 @@
 #include <math.h>
 #include "Visualization/SpikeObject.h"
 
-#ifdef WIN32
-#define copysign(x,y) _copysign(x,y)
-#endif
+// samples at the end of each spike shape that are faded out
+#define SPIKE_TAPER 30
 
 SignalGenerator::SignalGenerator()
     : GenericProcessor("Signal Generator"),
-      nOut(5), defaultFrequency(10.0), defaultAmplitude(0.5f),
-      previousPhase(1000), spikeDelay(0)
+      nOut(5), defaultFrequency(10.0), defaultAmplitude(0.5f)
 {
     parameters.add(Parameter("Amplitude", 0.0005f, 500.0f, .5f, 0, true));
     parameters.add(Parameter("Frequency", 0.01, 10000.0, 10, 1, true));
     parameters.add(Parameter("Phase", -double_Pi, double_Pi, 0, 2, true));
     parameters.add(Parameter("Waveform Type", waveformParameter, 0, 3, true));
+    parameters.add(Parameter("Noise", 0.0, 500.0, 0, 4, true));
+    parameters.add(Parameter("Spike Rate", 0.0, 100.0, 0, 5, true));
+
+    createTables();
 }
 
 
@@ -62,6 +64,66 @@ AudioProcessorEditor* SignalGenerator::createEditor()
     return editor;
 }
 
+void SignalGenerator::createTables()
+{
+    wavetables.malloc(4 * (tableSize + 1));
+
+    for (int i = 0; i <= tableSize; i++)
+    {
+        const double x = double(i % tableSize) / double(tableSize); // fraction of a cycle
+
+        wavetables[TRIANGLE*(tableSize + 1) + i] = float(x < 0.25 ? 4.0*x : (x < 0.75 ? 2.0 - 4.0*x : 4.0*x - 4.0));
+        wavetables[SINE*(tableSize + 1) + i] = float(std::sin(2.0 * double_Pi * x));
+        wavetables[SQUARE*(tableSize + 1) + i] = (x < 0.5) ? 1.0f : -1.0f;
+        wavetables[SAW*(tableSize + 1) + i] = float(2.0 * x - 1.0);
+    }
+
+    // Box-Muller
+    noiseTable.malloc(noiseTableSize);
+
+    for (int i = 0; i < noiseTableSize; i += 2)
+    {
+        const double r = std::sqrt(-2.0 * std::log(1.0 - random.nextDouble()));
+        const double theta = 2.0 * double_Pi * random.nextDouble();
+
+        noiseTable[i] = float(r * std::cos(theta));
+        noiseTable[i + 1] = float(r * std::sin(theta));
+    }
+
+    spikeTable.malloc(5 * N_WAVEFORM_SAMPLES);
+
+    for (int k = 0; k < 5; k++)
+    {
+        double peak = 0.0;
+
+        for (int i = 0; i < N_WAVEFORM_SAMPLES; i++)
+            peak = jmax(peak, SPIKE_WAVEFORMS[k][i] - SPIKE_WAVEFORMS[k][0]);
+
+        for (int i = 0; i < N_WAVEFORM_SAMPLES; i++)
+        {
+            double taper = 1.0;
+
+            if (i >= N_WAVEFORM_SAMPLES - SPIKE_TAPER)
+                taper = 0.5 + 0.5 * std::cos(double_Pi * (i - (N_WAVEFORM_SAMPLES - SPIKE_TAPER) + 1) / SPIKE_TAPER);
+
+            spikeTable[k*N_WAVEFORM_SAMPLES + i] = float(-(SPIKE_WAVEFORMS[k][i] - SPIKE_WAVEFORMS[k][0]) / peak * taper);
+        }
+    }
+}
+
+uint32 SignalGenerator::getPhaseIncrement(double freq)
+{
+    return (uint32) (int64) (freq / getSampleRate() * 4294967296.0);
+}
+
+int SignalGenerator::getSpikeInterval(int chan)
+{
+    // exponential intervals, counted from the end of the previous spike
+    const double meanInterval = getSampleRate() / spikeRate[chan];
+
+    return (int) jmin(-std::log(1.0 - random.nextDouble()) * meanInterval, 2.0e9);
+}
+
 void SignalGenerator::updateSettings()
 {
 
@@ -73,8 +135,14 @@ void SignalGenerator::updateSettings()
         frequency.add(defaultFrequency);
         amplitude.add(defaultAmplitude);
         phase.add(0);
-        phasePerSample.add(double_Pi * 2.0 / (getSampleRate() / frequency.getLast()));
+        noiseLevel.add(0.0f);
+        spikeRate.add(0.0f);
+        phaseIncrement.add(getPhaseIncrement(frequency.getLast()));
+        phaseOffset.add(0);
         currentPhase.add(0);
+        samplesUntilSpike.add(0);
+        spikePosition.add(-1);
+        spikeShape.add(0);
     }
 
     sampleRateRatio = getSampleRate() / 44100.0;
@@ -101,12 +169,13 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
         else if (parameterIndex == 1)
         {
             frequency.set(currentChannel,newValue);
-            phasePerSample.set(currentChannel, double_Pi * 2.0 / (getSampleRate() / frequency[currentChannel]));
+            phaseIncrement.set(currentChannel, getPhaseIncrement(newValue));
             parameterPointer->setValue(newValue, currentChannel);
         }
         else if (parameterIndex == 2)
         {
             phase.set(currentChannel, newValue/360.0f * (double_Pi * 2.0));
+            phaseOffset.set(currentChannel, (uint32) (int64) (newValue/360.0 * 4294967296.0));
             parameterPointer->setValue(newValue/360.0f * (double_Pi * 2.0), currentChannel);
         }
         else if (parameterIndex == 3)
@@ -114,6 +183,17 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
             waveformType.set(currentChannel, (int) newValue);
             parameterPointer->setValue(newValue, currentChannel);
         }
+        else if (parameterIndex == 4)
+        {
+            noiseLevel.set(currentChannel, newValue*100.0f);
+            parameterPointer->setValue(newValue*100.0f, currentChannel);
+        }
+        else if (parameterIndex == 5)
+        {
+            spikeRate.set(currentChannel, newValue);
+            samplesUntilSpike.set(currentChannel, newValue > 0.0f ? getSpikeInterval(currentChannel) : 0);
+            parameterPointer->setValue(newValue, currentChannel);
+        }
         //updateWaveform(currentChannel);
     }
 
@@ -190,152 +270,114 @@ void SignalGenerator::process(AudioSampleBuffer& buffer,
 
     nSamps = int((float) buffer.getNumSamples() * sampleRateRatio);
 
-    for (int i = 0; i < nSamps; ++i)
-    {
-        for (int j = buffer.getNumChannels(); --j >= 0;)
-        {
+    const int numChannels = jmin(buffer.getNumChannels(), waveformType.size());
 
-            float sample;
-
-            switch (waveformType[j])
-            {
-                case SINE:
-                    sample = amplitude[j] * (float) std::sin(currentPhase[j] + phase[j]);
-                    break;
-                case SQUARE:
-                    sample = amplitude[j] * copysign(1,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case TRIANGLE:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1) *
-                             copysign(2,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case SAW:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1);
-                    break;
-                case NOISE:
-                    // sample = amplitude[j] * (float(rand()) / float(RAND_MAX)-0.5f);
-                    // break;
-                case SPIKE:
-                    sample = generateSpikeSample(amplitude[j], currentPhase[j], phase[j]);
-                    break;
-                default:
-                    sample = 0;
-            }
+    for (int j = 0; j < numChannels; j++)
+    {
+        float* data = buffer.getSampleData(j);
 
-            currentPhase.set(j,currentPhase[j] + phasePerSample[j]);
+        renderOscillator(j, data, nSamps);
 
-            if (currentPhase[j] > double_Pi*2)
-                currentPhase.set(j,0);
+        if (noiseLevel.getUnchecked(j) > 0.0f)
+            addNoise(j, data, nSamps);
 
-            // dereference pointer to one of the buffer's samples
-            *buffer.getSampleData(j, i) = sample;
-        }
+        if (spikeRate.getUnchecked(j) > 0.0f)
+            addSpikes(j, data, nSamps);
     }
 
+}
 
-    // for (int chan = 0; chan < buffer.getNumChannels(); chan++)
-    // {
-
-    // 	int dataSize = waveforms[chan].size();
-    // 	int destSample = -dataSize;
-    // 	int lastSample = dataSize;
-
-    // 	while (lastSample < nSamps)
-    // 	{
-
-    // 		destSample += dataSize;
-
-    // 		//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
-
-    // 		// buffer.copyFrom(chan,
-    // 		//  				destSample,
-    // 		//  				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 		//  				dataSize - currentSample[chan]);
-
-    // 		lastSample += dataSize;
-
-    // 		currentSample.set(chan,0);
-
-    // 		//std::cout << "DONE" << std::endl;
-    // 	}
-
-    // 	//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
-
-    // 	if (destSample < 0)
-    // 		destSample = 0;
-
-    // 	int samplesLeft = nSamps - destSample;
-
-    // 	if (samplesLeft < dataSize - currentSample[chan])
-    // 	{
-    // 	 	// buffer.copyFrom(chan,
-    // 	 	// 			destSample,
-    // 	 	// 			waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 	// 			samplesLeft);
-
-    // 	 	currentSample.set(chan, currentSample[chan] + samplesLeft);
-
-    // 	} else {
+void SignalGenerator::renderOscillator(int j, float* data, int nSamples)
+{
+    const int type = waveformType.getUnchecked(j);
 
-    // 		int samps = dataSize - currentSample[chan];
+    if (type < TRIANGLE || type > SAW)
+    {
+        FloatVectorOperations::clear(data, nSamples);
+        return;
+    }
 
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 // 				samps);
+    const float* table = wavetables + type*(tableSize + 1);
+    const float amp = (float) amplitude.getUnchecked(j);
+    const uint32 increment = phaseIncrement.getUnchecked(j);
+    const uint32 offset = phaseOffset.getUnchecked(j);
 
-    // 		destSample += samps;
-    // 		samplesLeft -= samps;
+    uint32 p = currentPhase.getUnchecked(j);
 
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer(),
-    // 	 // 				samplesLeft);
+    for (int i = 0; i < nSamples; i++)
+    {
+        const uint32 q = p + offset;
+        const int index = int(q >> (32 - tableBits));
+        const float fraction = float(q & ((1u << (32 - tableBits)) - 1)) * (1.0f / float(1u << (32 - tableBits)));
 
-    // 		currentSample.set(chan, samplesLeft);
-    // 	}
+        data[i] = amp * (table[index] + fraction * (table[index + 1] - table[index]));
 
-    // }
+        p += increment; // wraps around at the end of each cycle
+    }
 
+    currentPhase.setUnchecked(j, p);
 }
-float SignalGenerator::generateSpikeSample(double amp, double phase, double noise)
+
+void SignalGenerator::addNoise(int j, float* data, int nSamples)
 {
+    const float level = noiseLevel.getUnchecked(j);
 
+    // a different stretch of the table for every channel and block
+    int offset = random.nextInt(noiseTableSize);
+    int done = 0;
 
-    // if the current phase is less than the previous phase we've probably wrapped and its time to select a new spike
-    // if we've delayed long enough then draw a new spike otherwise wait until spikeDelay==0
-    if (phase < previousPhase)
+    while (done < nSamples)
     {
-        spikeIdx = rand()%5;
+        const int n = jmin(nSamples - done, noiseTableSize - offset);
+
+        FloatVectorOperations::addWithMultiply(data + done, noiseTable + offset, level, n);
 
-        if (spikeDelay <= 0)
-            spikeDelay = rand()%200 + 50;
-        if (spikeDelay > 0)
-            spikeDelay --;
+        done += n;
+        offset = 0;
     }
+}
 
+void SignalGenerator::addSpikes(int j, float* data, int nSamples)
+{
+    const float amp = (float) amplitude.getUnchecked(j);
 
-    previousPhase = phase;
+    int position = spikePosition.getUnchecked(j);
+    int wait = samplesUntilSpike.getUnchecked(j);
 
-    int shift = -9500;//1000 + 32768;
-    int gain = 8000;
+    int i = 0;
 
-    double r = ((rand() % 201) - 100) / 1000.0; // Generate random number between -.1 and .1
-    noise = r  * noise / (double_Pi * 2); // Shrink the range of r based upon the value of noise
+    while (i < nSamples)
+    {
+        if (position >= 0)
+        {
+            const int n = jmin(nSamples - i, N_WAVEFORM_SAMPLES - position);
 
-    int sampIdx = (int)(phase / (2 * double_Pi) * (N_WAVEFORM_SAMPLES-1));  // bind between 0 and N_SAMP-1, too tired to figure out the proper math
-    //sampIdx = sampIdx + 8;
+            FloatVectorOperations::addWithMultiply(data + i,
+                                                   spikeTable + spikeShape.getUnchecked(j)*N_WAVEFORM_SAMPLES + position,
+                                                   amp, n);
 
-    // Right now only sample from the 3rd waveform. I need to figure out a way to only sample from a single spike until the phase wraps
-    float baseline = shift + gain *  SPIKE_WAVEFORMS[spikeIdx][1] ;
+            position += n;
+            i += n;
 
-    float sample = shift + gain * (SPIKE_WAVEFORMS[spikeIdx][sampIdx] + noise);  // * pow( WAVEFORM_SCALE[sampIdx], amp / 200.0 ) ) ;
-    float dV = sample  - baseline;
-    dV = dV * (1 + amp / 250);
-    sample = baseline + dV;
+            if (position == N_WAVEFORM_SAMPLES)
+            {
+                position = -1;
+                wait = getSpikeInterval(j);
+            }
+        }
+        else if (wait >= nSamples - i)
+        {
+            wait -= nSamples - i;
+            break;
+        }
+        else
+        {
+            i += wait;
+            position = 0;
+            spikeShape.setUnchecked(j, random.nextInt(5));
+        }
+    }
 
-    if (spikeDelay==0)
-        return sample;
-    else
-        return baseline;
+    spikePosition.setUnchecked(j, position);
+    samplesUntilSpike.setUnchecked(j, wait);
 }
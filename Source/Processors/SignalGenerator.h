@@ -33,6 +33,14 @@
 
   Outputs synthesized data of one of 5 different waveform types.
 
+  Each channel is a phase accumulator reading a one-cycle wavetable (with
+  linear interpolation), so a block costs a few operations per sample
+  whatever the waveform. Gaussian noise, read from a precomputed table at a
+  random offset, and spikes (the SPIKE_WAVEFORMS shapes, at Poisson times)
+  can be added to any channel, which makes it cheap to generate realistic
+  test signals on hundreds of channels. The "noise" waveform turns the
+  oscillator off, leaving only the noise and spikes.
+
   @see GenericProcessor, SignalGeneratorEditor
 
 */
@@ -88,17 +96,34 @@ private:
     double defaultFrequency;
     double defaultAmplitude;
 
-    float generateSpikeSample(double amp, double phase, double noise);
-
     float sampleRateRatio;
 
+    enum { tableBits = 12, tableSize = 1 << tableBits, noiseTableSize = 1 << 15 };
+
+    /** One cycle of each periodic waveform, with one extra sample for interpolation. */
+    HeapBlock<float> wavetables;
+
+    /** Unit-variance Gaussian noise. */
+    HeapBlock<float> noiseTable;
+
+    /** SPIKE_WAVEFORMS, negative-going with a peak of -1 and tapered to zero. */
+    HeapBlock<float> spikeTable;
+
+    Random random;
+
+    void createTables();
+
+    void renderOscillator(int chan, float* data, int nSamples);
+    void addNoise(int chan, float* data, int nSamples);
+    void addSpikes(int chan, float* data, int nSamples);
+
     //void updateWaveform(int chan);
 
     void initializeParameters();
 
     enum wvfrm
     {
-        TRIANGLE, SINE, SQUARE, SAW, NOISE, SPIKE
+        TRIANGLE, SINE, SQUARE, SAW, NOISE
     };
 
     Array<var> waveformParameter;
@@ -106,12 +131,21 @@ private:
     Array<double> frequency;
     Array<double> amplitude;
     Array<double> phase;
-    Array<double> phasePerSample;
-    Array<double> currentPhase;
+    Array<float> noiseLevel;
+    Array<float> spikeRate;
+
+    // oscillator state; a full cycle is 2^32
+    Array<uint32> phaseIncrement;
+    Array<uint32> phaseOffset;
+    Array<uint32> currentPhase;
+
+    // spike state
+    Array<int> samplesUntilSpike;
+    Array<int> spikePosition; // -1 between spikes
+    Array<int> spikeShape;
 
-    double previousPhase;
-    int spikeIdx;
-    int spikeDelay;
+    uint32 getPhaseIncrement(double freq);
+    int getSpikeInterval(int chan);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalGenerator);
 
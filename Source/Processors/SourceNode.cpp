@@ -33,10 +33,14 @@
 #include "Channel.h"
 #include <stdio.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 SourceNode::SourceNode(const String& name_)
     : GenericProcessor(name_),
       sourceCheckInterval(2000), wasDisabled(true), dataThread(0),
-      inputBuffer(0), ttlState(0)
+      inputBuffer(0), eventCodeBufferSize(0), eventChannelState(0), ttlState(0)
 {
 
     std::cout << "creating source node." << std::endl;
@@ -65,18 +69,13 @@ SourceNode::SourceNode(const String& name_)
             enabledState(false);
         }
 
-        numEventChannels = dataThread->getNumEventChannels();
-        eventChannelState = new int[numEventChannels];
-        for (int i = 0; i < numEventChannels; i++)
-        {
-            eventChannelState[i] = 0;
-        }
+        // one bit of each 16-bit event code per channel
+        numEventChannels = jmin(dataThread->getNumEventChannels(), 16);
 
     }
     else
     {
         enabledState(false);
-        eventChannelState = 0;
         numEventChannels = 0;
     }
 
@@ -84,7 +83,6 @@ SourceNode::SourceNode(const String& name_)
     startTimer(sourceCheckInterval);
 
     timestamp = 0;
-    eventCodeBuffer = new int16[10000]; //10000 samples per buffer max?
 
 
 }
@@ -98,9 +96,6 @@ SourceNode::~SourceNode()
         dataThread->stopThread(500);
     }
 
-
-    if (eventChannelState)
-        delete[] eventChannelState;
 }
 
 DataThread* SourceNode::getThread()
@@ -285,6 +280,15 @@ bool SourceNode::enable()
 
 }
 
+void SourceNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
+{
+    if (estimatedSamplesPerBlock > eventCodeBufferSize)
+    {
+        eventCodeBuffer.malloc(estimatedSamplesPerBlock);
+        eventCodeBufferSize = estimatedSamplesPerBlock;
+    }
+}
+
 bool SourceNode::disable()
 {
 
@@ -329,6 +333,13 @@ void SourceNode::process(AudioSampleBuffer& buffer,
     events.clear();
     buffer.clear();
 
+    if (buffer.getNumSamples() > eventCodeBufferSize)
+    {
+        // only if the device sends bigger blocks than prepareToPlay() said
+        eventCodeBuffer.malloc(buffer.getNumSamples());
+        eventCodeBufferSize = buffer.getNumSamples();
+    }
+
     nSamples = inputBuffer->readAllFromBuffer(buffer, &timestamp, eventCodeBuffer, buffer.getNumSamples());
 
     //std::cout << *buffer.getSampleData(0) << std::endl;
@@ -361,49 +372,95 @@ void SourceNode::process(AudioSampleBuffer& buffer,
 
 
     // fill event buffer
-    for (int i = 0; i < nSamples; i++)
+    addTtlEvents(events, nSamples);
+
+}
+
+// index of the lowest set bit; x must not be zero
+static inline int lowestSetBit(uint32 x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (int) index;
+#else
+    int index = 0;
+
+    while ((x & 1) == 0)
     {
-        for (int c = 0; c < numEventChannels; c++)
+        x >>= 1;
+        index++;
+    }
+
+    return index;
+#endif
+}
+
+void SourceNode::addTtlEvents(MidiBuffer& events, int nSamples)
+{
+    if (numEventChannels == 0)
+        return;
+
+    const uint32 mask = (1u << numEventChannels) - 1;
+
+    // the state and mask repeated in each 16-bit lane of a 64-bit word
+    const uint64 lanes = 0x0001000100010001ULL;
+    const uint64 maskPattern = uint64(mask) * lanes;
+
+    uint32 state = eventChannelState;
+    uint64 statePattern = uint64(state) * lanes;
+
+    // written directly, so there is no allocation per event
+    uint8 data[4];
+    data[0] = TTL;
+    data[1] = nodeId;
+
+    int i = 0;
+
+    while (i < nSamples)
+    {
+        // skip unchanged samples four at a time
+        while (i + 4 <= nSamples)
         {
-            int state = eventCodeBuffer[i] & (1 << c);
+            uint64 word;
+            memcpy(&word, eventCodeBuffer + i, 8);
 
-            if (eventChannelState[c] != state)
+            if ((word ^ statePattern) & maskPattern)
+                break;
+
+            i += 4;
+        }
+
+        if (i >= nSamples)
+            break;
+
+        uint32 diff = (uint32(uint16(eventCodeBuffer[i])) ^ state) & mask;
+
+        if (diff != 0)
+        {
+            state ^= diff;
+            statePattern = uint64(state) * lanes;
+
+            // one event per line that changed, ON (1) or OFF (0)
+            while (diff != 0)
             {
-                if (state == 0)
-                {
-
-                    //std::cout << "OFF" << std::endl;
-                    //std::cout << c << std::endl;
-                    // signal channel state is OFF
-                    addEvent(events, // MidiBuffer
-                             TTL,    // eventType
-                             i,      // sampleNum
-                             0,	     // eventID
-                             c		 // eventChannel
-                            );
-                }
-                else
-                {
-
-                    // std::cout << "ON" << std::endl;
-                    // std::cout << c << std::endl;
-
-                    // signal channel state is ON
-                    addEvent(events, // MidiBuffer
-                             TTL,    // eventType
-                             i,      // sampleNum
-                             1,		 // eventID
-                             c		 // eventChannel
-                            );
-
-
-                }
-
-                eventChannelState[c] = state;
+                const int c = lowestSetBit(diff);
+
+                data[2] = uint8((state >> c) & 1);
+                data[3] = uint8(c);
+
+                events.addEvent(data, 4, i);
+
+                diff &= diff - 1;
             }
         }
+
+        i++;
     }
 
+    eventChannelState = state;
 }
 
 
@@ -69,6 +69,9 @@ public:
     bool enable();
     bool disable();
 
+    /** Sizes the event code buffer for the expected block size. */
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
     bool isReady();
 
     bool isSource()
@@ -103,8 +106,16 @@ private:
     DataBuffer* inputBuffer;
 
     uint64 timestamp;
-    int16* eventCodeBuffer;
-    int* eventChannelState;
+
+    /** The TTL word of each sample in the current block. */
+    HeapBlock<int16> eventCodeBuffer;
+    int eventCodeBufferSize;
+
+    /** One bit per event channel, as of the last sample processed. */
+    uint32 eventChannelState;
+
+    /** Emits an event for every line that differs between consecutive TTL words. */
+    void addTtlEvents(MidiBuffer& events, int nSamples);
 
 
     int ttlState;
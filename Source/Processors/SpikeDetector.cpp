@@ -26,9 +26,111 @@
 
 #include "Channel.h"
 
+#include <math.h>
+
+NoiseEstimator::NoiseEstimator()
+{
+    reset();
+}
+
+void NoiseEstimator::reset()
+{
+    for (int i = 0; i < numBins; i++)
+        bins[i] = 0.0f;
+
+    binWidth = 0.25f;
+    offset = 0;
+    numSinceUpdate = 0;
+    sigma = 0.0f;
+}
+
+void NoiseEstimator::addSamples(const float* data, int numSamples)
+{
+    float scale = 1.0f / binWidth;
+
+    int i = offset;
+
+    for (; i < numSamples; i += decimation)
+    {
+        // large values (and NaNs) land in the last bin
+        const float bin = fabsf(data[i]) * scale;
+
+        bins[bin < float(numBins) ? int(bin) : numBins - 1] += 1.0f;
+
+        if (++numSinceUpdate >= updateInterval)
+        {
+            update();
+            scale = 1.0f / binWidth;
+        }
+    }
+
+    offset = i - numSamples;
+}
+
+void NoiseEstimator::update()
+{
+    numSinceUpdate = 0;
+
+    float total = 0.0f;
+
+    for (int i = 0; i < numBins; i++)
+        total += bins[i];
+
+    if (total <= 0.0f)
+        return;
+
+    // the median of |x|, interpolated within its bin
+    const float target = 0.5f * total;
+    float cumulative = 0.0f;
+    int medianBin = 0;
+
+    while (medianBin < numBins - 1 && cumulative + bins[medianBin] < target)
+        cumulative += bins[medianBin++];
+
+    const float fraction = (bins[medianBin] > 0.0f) ? (target - cumulative) / bins[medianBin] : 0.0f;
+
+    sigma = (float(medianBin) + fraction) * binWidth / 0.6745f;
+
+    // forget old samples; 0.99 per update is a half-life of ~70 updates
+    for (int i = 0; i < numBins; i++)
+        bins[i] *= 0.99f;
+
+    if (medianBin >= numBins / 2)
+    {
+        // too coarse a range: merge pairs of bins
+        for (int i = 0; i < numBins / 2; i++)
+            bins[i] = bins[2*i] + bins[2*i + 1];
+
+        for (int i = numBins / 2; i < numBins; i++)
+            bins[i] = 0.0f;
+
+        binWidth *= 2.0f;
+    }
+    else if (medianBin < numBins / 8)
+    {
+        // too fine a range: split each bin, and fold the top half into the last bin
+        float overflow = 0.0f;
+
+        for (int i = numBins / 2; i < numBins; i++)
+            overflow += bins[i];
+
+        for (int i = numBins / 2 - 1; i >= 0; i--)
+        {
+            bins[2*i + 1] = 0.5f * bins[i];
+            bins[2*i] = 0.5f * bins[i];
+        }
+
+        bins[numBins - 1] += overflow;
+
+        binWidth *= 0.5f;
+    }
+
+}
+
 SpikeDetector::SpikeDetector()
     : GenericProcessor("Spike Detector"),
-      overflowBuffer(2,100), dataBuffer(overflowBuffer),
+      overflowBuffer(2,100), dataBuffer(overflowBuffer), thresholdMultiplier(0.0f),
+      deduplicate(false), probeRadius(50.0f), deduplicationWindow(10),
       overflowBufferSize(100), currentElectrode(-1)
 {
     //// the standard form:
@@ -65,6 +167,10 @@ SpikeDetector::SpikeDetector()
 
     spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
 
+    // never reallocated inside process()
+    candidates.ensureStorageAllocated(maxCandidates);
+    recentSpikes.ensureStorageAllocated(maxCandidates);
+
 }
 
 SpikeDetector::~SpikeDetector()
@@ -147,6 +253,7 @@ bool SpikeDetector::addElectrode(int nChans)
     newElectrode->thresholds = new double[nChans];
     newElectrode->isActive = new bool[nChans];
     newElectrode->channels = new int[nChans];
+    newElectrode->noise = new NoiseEstimator[nChans];
 
     for (int i = 0; i < nChans; i++)
     {
@@ -209,6 +316,7 @@ void SpikeDetector::setChannel(int electrodeIndex, int channelNum, int newChanne
               " to " << newChannel << std::endl;
 
     *(electrodes[electrodeIndex]->channels+channelNum) = newChannel;
+    electrodes[electrodeIndex]->noise[channelNum].reset();
 }
 
 int SpikeDetector::getNumChannels(int index)
@@ -256,6 +364,97 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
     return *(electrodes[electrodeNum]->thresholds+channelNum);
 }
 
+void SpikeDetector::setThresholdMultiplier(float k)
+{
+    setParameter(97, k);
+}
+
+void SpikeDetector::setDeduplication(bool t)
+{
+    setParameter(96, t ? 1.0f : 0.0f);
+}
+
+void SpikeDetector::setSitePosition(int chan, float x, float y)
+{
+    if (chan < 0)
+        return;
+
+    // sites that haven't been set keep their default (linear) positions
+    while (siteX.size() <= chan)
+    {
+        float defaultX, defaultY;
+        getSitePosition(siteX.size(), defaultX, defaultY);
+
+        siteX.add(defaultX);
+        siteY.add(defaultY);
+    }
+
+    siteX.set(chan, x);
+    siteY.set(chan, y);
+}
+
+void SpikeDetector::getSitePosition(int chan, float& x, float& y)
+{
+    if (chan < siteX.size())
+    {
+        x = siteX.getUnchecked(chan);
+        y = siteY.getUnchecked(chan);
+    }
+    else
+    {
+        x = 0.0f;
+        y = 20.0f * float(chan);
+    }
+}
+
+bool SpikeDetector::areNeighbours(int electrodeA, int electrodeB)
+{
+    Electrode* a = electrodes[electrodeA];
+    Electrode* b = electrodes[electrodeB];
+
+    const float radiusSquared = probeRadius * probeRadius;
+
+    for (int i = 0; i < a->numChannels; i++)
+    {
+        float xa, ya;
+        getSitePosition(*(a->channels+i), xa, ya);
+
+        for (int j = 0; j < b->numChannels; j++)
+        {
+            float xb, yb;
+            getSitePosition(*(b->channels+j), xb, yb);
+
+            if ((xa - xb) * (xa - xb) + (ya - yb) * (ya - yb) <= radiusSquared)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+void SpikeDetector::updateAutoThresholds(AudioSampleBuffer& buffer, int nSamples)
+{
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        Electrode* electrode = electrodes[i];
+
+        for (int chan = 0; chan < electrode->numChannels; chan++)
+        {
+            int currentChannel = *(electrode->channels+chan);
+
+            if (currentChannel >= buffer.getNumChannels())
+                continue;
+
+            NoiseEstimator& noise = electrode->noise[chan];
+
+            noise.addSamples(buffer.getSampleData(currentChannel), nSamples);
+
+            if (noise.hasEstimate())
+                *(electrode->thresholds+chan) = thresholdMultiplier * noise.getSigma();
+        }
+    }
+}
+
 void SpikeDetector::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -271,6 +470,16 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
+    else if (parameterIndex == 96)
+    {
+        deduplicate = (newValue != 0.0f);
+    }
+    else if (parameterIndex == 97)
+    {
+        thresholdMultiplier = jmax(0.0f, newValue);
+
+        std::cout << "Threshold multiplier set to " << thresholdMultiplier << std::endl;
+    }
 }
 
 
@@ -278,6 +487,10 @@ bool SpikeDetector::enable()
 {
 
     useOverflowBuffer = false;
+
+    candidates.clearQuick();
+    recentSpikes.clearQuick();
+
     return true;
 }
 
@@ -389,6 +602,9 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
     checkForEvents(events); // need to find any timestamp events before extracting spikes
 
+    if (thresholdMultiplier > 0.0f)
+        updateAutoThresholds(buffer, nSamples);
+
     //std::cout << dataBuffer.getMagnitude(0,nSamples) << std::endl;
 
     for (int i = 0; i < electrodes.size(); i++)
@@ -435,39 +651,22 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
                         }
 
                         peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples+1);
-
-                        SpikeObject newSpike;
-                        newSpike.timestamp = peakIndex;
-                        newSpike.source = i;
-                        newSpike.nChannels = electrode->numChannels;
-
-                        currentIndex = 0;
 
-                        // package spikes;
-                        for (int channel = 0; channel < electrode->numChannels; channel++)
+                        if (deduplicate && candidates.size() < maxCandidates)
                         {
-
-                            addWaveformToSpikeObject(&newSpike,
-                                                     peakIndex,
-                                                     i,
-                                                     channel);
-
-                            // if (*(electrode->isActive+currentChannel))
-                            // {
-
-                            //     createSpikeEvent(peakIndex,       // peak index
-                            //                      i,               // electrodeNumber
-                            //                      currentChannel,  // channel number
-                            //                      events);         // event buffer
-
-
-                            // } // end if channel is active
-
+                            // emitted by resolveCandidates() once all electrodes are done
+                            SpikeCandidate candidate;
+                            candidate.electrode = i;
+                            candidate.peakIndex = peakIndex;
+                            candidate.amplitude = -getCurrentSample(currentChannel);
+                            candidate.emitted = false;
+
+                            candidates.add(candidate);
+                        }
+                        else
+                        {
+                            emitSpike(i, peakIndex, events);
                         }
-
-                       //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
-                            addSpikeEvent(&newSpike, events, peakIndex);
 
                         // advance the sample index
                         sampleIndex = peakIndex + electrode->postPeakSamples;
@@ -486,6 +685,10 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
     } // end cycle through electrodes
 
+    // must happen before the overflow buffer is overwritten
+    if (deduplicate)
+        resolveCandidates(events, nSamples);
+
     // copy end of this buffer into the overflow buffer
 
     //std::cout << "Copying buffer" << std::endl;
@@ -519,6 +722,103 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
 
 
+}
+
+void SpikeDetector::emitSpike(int electrodeIndex, int peakIndex, MidiBuffer& events)
+{
+    Electrode* electrode = electrodes[electrodeIndex];
+
+    sampleIndex = peakIndex - (electrode->prePeakSamples+1);
+
+    SpikeObject newSpike;
+    newSpike.timestamp = peakIndex;
+    newSpike.source = electrodeIndex;
+    newSpike.nChannels = electrode->numChannels;
+    newSpike.sortedId = 0;
+
+    currentIndex = 0;
+
+    // package spikes;
+    for (int channel = 0; channel < electrode->numChannels; channel++)
+    {
+
+        addWaveformToSpikeObject(&newSpike,
+                                 peakIndex,
+                                 electrodeIndex,
+                                 channel);
+
+    }
+
+    //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
+    addSpikeEvent(&newSpike, events, peakIndex);
+
+}
+
+void SpikeDetector::resolveCandidates(MidiBuffer& events, int nSamples)
+{
+    CandidateSorter sorter;
+    candidates.sort(sorter);
+
+    int windowStart = 0;
+
+    for (int i = 0; i < candidates.size(); i++)
+    {
+        SpikeCandidate& c = candidates.getReference(i);
+
+        while (candidates.getReference(windowStart).peakIndex < c.peakIndex - deduplicationWindow)
+            windowStart++;
+
+        bool isLargest = true;
+
+        // a neighbour already fired at the end of the last block
+        for (int j = 0; j < recentSpikes.size() && isLargest; j++)
+        {
+            const SpikeCandidate& r = recentSpikes.getReference(j);
+
+            if (abs(c.peakIndex - r.peakIndex) <= deduplicationWindow &&
+                areNeighbours(c.electrode, r.electrode))
+                isLargest = false;
+        }
+
+        // a neighbour has a larger peak nearby (ties go to the lower electrode)
+        for (int j = windowStart; j < candidates.size() && isLargest; j++)
+        {
+            const SpikeCandidate& o = candidates.getReference(j);
+
+            if (o.peakIndex > c.peakIndex + deduplicationWindow)
+                break;
+
+            if (o.electrode != c.electrode &&
+                (o.amplitude > c.amplitude ||
+                 (o.amplitude == c.amplitude && o.electrode < c.electrode)) &&
+                areNeighbours(c.electrode, o.electrode))
+                isLargest = false;
+        }
+
+        if (isLargest)
+        {
+            emitSpike(c.electrode, c.peakIndex, events);
+            c.emitted = true;
+        }
+    }
+
+    // remember the spikes that could have duplicates in the next block,
+    // in that block's sample numbers
+    recentSpikes.clearQuick();
+
+    for (int i = 0; i < candidates.size(); i++)
+    {
+        SpikeCandidate c = candidates.getUnchecked(i);
+
+        if (c.emitted && c.peakIndex > nSamples - overflowBufferSize)
+        {
+            c.peakIndex -= nSamples;
+            recentSpikes.add(c);
+        }
+    }
+
+    candidates.clearQuick();
+
 }
 
 float SpikeDetector::getNextSample(int& chan)
@@ -600,6 +900,22 @@ bool SpikeDetector::samplesAvailable(int& nSamples)
 void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
 {
 
+    XmlElement* autoNode = parentElement->createNewChildElement("AUTOTHRESHOLD");
+    autoNode->setAttribute("multiplier", thresholdMultiplier);
+
+    XmlElement* probeNode = parentElement->createNewChildElement("PROBE");
+    probeNode->setAttribute("deduplicate", deduplicate);
+    probeNode->setAttribute("radius", probeRadius);
+    probeNode->setAttribute("window", deduplicationWindow);
+
+    for (int i = 0; i < siteX.size(); i++)
+    {
+        XmlElement* siteNode = probeNode->createNewChildElement("SITE");
+        siteNode->setAttribute("ch", i);
+        siteNode->setAttribute("x", siteX[i]);
+        siteNode->setAttribute("y", siteY[i]);
+    }
+
     for (int i = 0; i < electrodes.size(); i++)
     {
         XmlElement* electrodeNode = parentElement->createNewChildElement("ELECTRODE");
@@ -632,7 +948,26 @@ void SpikeDetector::loadCustomParametersFromXml()
 
         forEachXmlChildElement(*parametersAsXml, xmlNode)
         {
-            if (xmlNode->hasTagName("ELECTRODE"))
+            if (xmlNode->hasTagName("AUTOTHRESHOLD"))
+            {
+                setThresholdMultiplier(xmlNode->getDoubleAttribute("multiplier"));
+            }
+            else if (xmlNode->hasTagName("PROBE"))
+            {
+                probeRadius = (float) xmlNode->getDoubleAttribute("radius", 50.0);
+                deduplicationWindow = xmlNode->getIntAttribute("window", 10);
+
+                forEachXmlChildElement(*xmlNode, siteNode)
+                {
+                    if (siteNode->hasTagName("SITE"))
+                        setSitePosition(siteNode->getIntAttribute("ch"),
+                                        (float) siteNode->getDoubleAttribute("x"),
+                                        (float) siteNode->getDoubleAttribute("y"));
+                }
+
+                setDeduplication(xmlNode->getBoolAttribute("deduplicate"));
+            }
+            else if (xmlNode->hasTagName("ELECTRODE"))
             {
 
                 electrodeIndex++;
@@ -33,11 +33,83 @@
 
 class SpikeDetectorEditor;
 
+/**
+
+  Streaming estimate of the noise level of one channel.
+
+  Keeps a histogram of |x| for every decimation-th sample and converts its
+  median to a standard deviation (sigma = median(|x|) / 0.6745), which is
+  barely affected by the spikes themselves. The histogram decays
+  exponentially, with a half-life of roughly 20 s at 30 kHz, so the estimate
+  follows slow drift. The bin width doubles or halves as needed to keep the
+  median well inside the histogram.
+
+  Adding a sample costs O(1), and the histogram is a fixed-size member, so
+  nothing is allocated once the estimator exists.
+
+  @see SpikeDetector
+
+*/
+
+class NoiseEstimator
+{
+public:
+
+    NoiseEstimator();
+
+    /** Clears the histogram and the current estimate. */
+    void reset();
+
+    /** Adds a block of samples from the channel. */
+    void addSamples(const float* data, int numSamples);
+
+    /** Returns true once enough samples have been seen to estimate sigma. */
+    bool hasEstimate() const
+    {
+        return sigma > 0.0f;
+    }
+
+    /** Returns the estimated standard deviation of the noise. */
+    float getSigma() const
+    {
+        return sigma;
+    }
+
+private:
+
+    /** Recomputes sigma, decays the histogram and rescales it if needed. */
+    void update();
+
+    enum { numBins = 256, decimation = 4, updateInterval = 2048 };
+
+    float bins[numBins];
+    float binWidth;
+
+    int offset;
+    int numSinceUpdate;
+
+    float sigma;
+
+};
+
 /**
 
   Detects spikes in a continuous signal and outputs events containing the spike data.
 
-  @see GenericProcessor, SpikeDetectorEditor
+  Thresholds are either set by hand for each channel, or, when a threshold
+  multiplier k is set, follow k times the noise level of each channel as
+  estimated by a NoiseEstimator.
+
+  On dense probes, electrodes are usually laid out along the shank and the
+  same spike crosses threshold on several neighbouring electrodes. With
+  de-duplication turned on, the spikes found on all electrodes in a block
+  are collected and sorted by time, and a spike is only emitted if no
+  neighbouring electrode has a larger peak within a few samples. Two
+  electrodes are neighbours if any of their channels lie within the probe
+  radius of each other; site positions default to a linear probe with a
+  20 um pitch and can be set in the PROBE element of the settings file.
+
+  @see GenericProcessor, SpikeDetectorEditor, NoiseEstimator
 
 */
 
@@ -61,6 +133,12 @@ public:
         spikes into the event buffer. */
     void process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples);
 
+    /** Only reads the continuous channels. */
+    bool isPassThrough()
+    {
+        return true;
+    }
+
     /** Used to alter parameters of data acquisition. */
     void setParameter(int parameterIndex, float newValue);
 
@@ -126,6 +204,28 @@ public:
 
     double getChannelThreshold(int electrodeNum, int channelNum);
 
+    /** Sets k for automatic thresholds (k times the noise level of each
+        channel); 0 returns to manual thresholds. */
+    void setThresholdMultiplier(float k);
+
+    /** Returns k for automatic thresholds, or 0 if thresholds are manual. */
+    float getThresholdMultiplier()
+    {
+        return thresholdMultiplier;
+    }
+
+    /** Turns spatial de-duplication of spikes on or off. */
+    void setDeduplication(bool t);
+
+    /** Returns true if spikes are de-duplicated across neighbouring electrodes. */
+    bool isDeduplicating()
+    {
+        return deduplicate;
+    }
+
+    /** Sets the position of a probe site (in um); only used for de-duplication. */
+    void setSitePosition(int chan, float x, float y);
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
@@ -135,6 +235,52 @@ private:
 
     float getDefaultThreshold();
 
+    float thresholdMultiplier;
+
+    /** Feeds the noise estimators and sets thresholds from them. */
+    void updateAutoThresholds(AudioSampleBuffer& buffer, int nSamples);
+
+    /** A threshold crossing that has not been emitted yet. */
+    struct SpikeCandidate
+    {
+        int electrode;
+        int peakIndex;
+        float amplitude;
+        bool emitted;
+    };
+
+    class CandidateSorter
+    {
+    public:
+        static int compareElements(const SpikeCandidate& a, const SpikeCandidate& b)
+        {
+            return a.peakIndex - b.peakIndex;
+        }
+    };
+
+    enum { maxCandidates = 2048 };
+
+    bool deduplicate;
+    float probeRadius;
+    int deduplicationWindow;
+
+    Array<float> siteX;
+    Array<float> siteY;
+
+    Array<SpikeCandidate> candidates;
+    Array<SpikeCandidate> recentSpikes;
+
+    void getSitePosition(int chan, float& x, float& y);
+
+    /** Returns true if any channels of two electrodes are within probeRadius. */
+    bool areNeighbours(int electrodeA, int electrodeB);
+
+    /** Packages the waveforms around a peak and adds a spike event. */
+    void emitSpike(int electrodeIndex, int peakIndex, MidiBuffer& events);
+
+    /** Emits the candidates that are the largest among their neighbours. */
+    void resolveCandidates(MidiBuffer& events, int nSamples);
+
     int overflowBufferSize;
 
     int sampleIndex;
@@ -164,6 +310,8 @@ private:
         double* thresholds;
         bool* isActive;
 
+        NoiseEstimator* noise;
+
     };
 
     uint8_t* spikeBuffer;///[256];
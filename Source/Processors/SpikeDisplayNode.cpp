@@ -31,7 +31,7 @@
 
 SpikeDisplayNode::SpikeDisplayNode()
     : GenericProcessor("Spike Viewer"), displayBufferSize(5),  redrawRequested(false), isRecording(false),
-	  signalFilesShouldClose(false)
+	  signalFilesShouldClose(false), displaySkipped(false)
 {
  
 
@@ -70,6 +70,7 @@ void SpikeDisplayNode::updateSettings()
             elec.numChannels = eventChannels[i]->eventType - 100;
             elec.name = eventChannels[i]->name;
             elec.currentSpikeIndex = 0;
+            elec.spikePlot = nullptr;
             elec.mostRecentSpikes.ensureStorageAllocated(displayBufferSize);
 
             for (int j = 0; j < elec.numChannels; j++)
@@ -207,6 +208,13 @@ void SpikeDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, in
 
     checkForEvents(events); // automatically calls 'handleEvent
 
+    handleRequests();
+
+}
+
+void SpikeDisplayNode::handleRequests()
+{
+
     if (signalFilesShouldClose)
     {
         for (int i = 0; i < getNumElectrodes(); i++)
@@ -249,6 +257,18 @@ void SpikeDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, in
 
 }
 
+void SpikeDisplayNode::skipBlock(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
+{
+    if (isRecording)
+    {
+        displaySkipped = true;
+        checkForEvents(events);
+        displaySkipped = false;
+    }
+
+    handleRequests();
+}
+
 void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
 {
 
@@ -284,9 +304,13 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
                     aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);   
                 }
 
-                if (aboveThreshold)
+                if (aboveThreshold && !displaySkipped)
                 {
 
+                    // every spike goes into the waveform density
+                    if (e.spikePlot != nullptr)
+                        e.spikePlot->accumulateSpikeObject(newSpike);
+
                     // add to buffer
                     if (e.currentSpikeIndex < displayBufferSize)
                     {
@@ -295,11 +319,12 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
                         e.currentSpikeIndex++;
                     }
                     
-                    // save spike
-                    if (isRecording)
-                    {
-                        writeSpike(newSpike, electrodeNum);
-                    }
+                }
+
+                // save spike
+                if (aboveThreshold && isRecording)
+                {
+                    writeSpike(newSpike, electrodeNum);
                 }
 
             }
@@ -398,7 +423,8 @@ void SpikeDisplayNode::closeFile(int i)
 void SpikeDisplayNode::writeSpike(const SpikeObject& s, int i)
 {
 
-    packSpike(&s, spikeBuffer, MAX_SPIKE_BUFFER_LEN);
+    if (packSpike(&s, spikeBuffer, MAX_SPIKE_BUFFER_LEN) == 0)
+        return;
 
     int totalBytes = s.nSamples * s.nChannels * 2 + // account for samples
                      s.nChannels * 4 +            // acount for threshold and gain
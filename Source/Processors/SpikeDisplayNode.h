@@ -56,8 +56,19 @@ public:
         return true;
     }
 
+    /** Skipping a late block only costs the plots its spikes (see skipBlock()). */
+    int getPriorityClass()
+    {
+        return BEST_EFFORT_PRIORITY;
+    }
+
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
 
+    /** Still writes the block's spikes to disk while recording, but does
+        not pass them on to the plots. Closing files and redraw requests are
+        handled as in process(). */
+    void skipBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
+
     void setParameter(int, float);
 
     void handleEvent(int, MidiMessage&, int);
@@ -104,6 +115,10 @@ private:
     int displayBufferSize;
     bool redrawRequested;
 
+    /** Closes the files after stopRecording() and serves redraw requests;
+        called for every block, whether processed or skipped. */
+    void handleRequests();
+
     // methods for recording:
     void openFile(int index);
     void closeFile(int index);
@@ -113,6 +128,9 @@ private:
     // members for recording
     bool isRecording;
     bool signalFilesShouldClose;
+
+    /** Set while handling the events of a skipped block. */
+    bool displaySkipped;
     RecordNode* recordNode;
     String baseDirectory;
     File dataDirectory;
@@ -0,0 +1,526 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "SpikeSorter.h"
+#include "Channel.h"
+#include "Editors/SpikeSorterEditor.h"
+
+SortingModel::SortingModel(int numDims_)
+    : numDims(numDims_), maxDistanceSquared(0.0f)
+{
+    components.calloc(numComponents * numDims);
+
+    for (int k = 0; k < numComponents; k++)
+        offsets[k] = 0.0f;
+}
+
+SortingModel::SortingModel(const SortingModel& other)
+    : numDims(other.numDims), maxDistanceSquared(other.maxDistanceSquared),
+      centroids(other.centroids)
+{
+    components.malloc(numComponents * numDims);
+    memcpy(components, other.components, sizeof(float) * numComponents * numDims);
+
+    for (int k = 0; k < numComponents; k++)
+        offsets[k] = other.offsets[k];
+}
+
+void SortingModel::project(const float* waveform, float* features) const
+{
+    for (int k = 0; k < numComponents; k++)
+        features[k] = dotProduct(components + k*numDims, waveform, numDims) - offsets[k];
+}
+
+int SortingModel::classify(const float* features) const
+{
+    int unit = 0;
+    float nearest = maxDistanceSquared;
+
+    const int numTemplates = getNumTemplates();
+
+    for (int t = 0; t < numTemplates; t++)
+    {
+        float distance = 0.0f;
+
+        for (int k = 0; k < numComponents; k++)
+        {
+            const float d = features[k] - centroids.getUnchecked(t*numComponents + k);
+            distance += d * d;
+        }
+
+        if (distance < nearest)
+        {
+            nearest = distance;
+            unit = t + 1;
+        }
+    }
+
+    return unit;
+}
+
+void SortingModel::adapt(int unit, const float* features)
+{
+    float* centroid = centroids.getRawDataPointer() + (unit - 1) * numComponents;
+
+    for (int k = 0; k < numComponents; k++)
+        centroid[k] += (features[k] - centroid[k]) * (1.0f / 64.0f);
+}
+
+void SortingModel::addTemplate(const float* features)
+{
+    for (int k = 0; k < numComponents; k++)
+        centroids.add(features[k]);
+}
+
+// ----------------------------------------------------------------
+
+SpikeSorter::SpikeSorter()
+    : GenericProcessor("Spike Sorter")
+{
+    spikeBuffer.malloc(MAX_SPIKE_BUFFER_LEN);
+    waveform.malloc(MAX_NUMBER_OF_SPIKE_CHANNELS * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+
+    sortedEvents.ensureSize(65536);
+}
+
+SpikeSorter::~SpikeSorter()
+{
+
+}
+
+AudioProcessorEditor* SpikeSorter::createEditor()
+{
+    editor = new SpikeSorterEditor(this, true);
+
+    return editor;
+}
+
+int SpikeSorter::getWaveform(const SpikeObject& s, float* waveform)
+{
+    const int n = jmin(int(s.nChannels) * int(s.nSamples),
+                       MAX_NUMBER_OF_SPIKE_CHANNELS * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+
+    for (int i = 0; i < n; i++)
+        waveform[i] = float(s.data[i]) - 32768.0f;
+
+    return n;
+}
+
+void SpikeSorter::updateSettings()
+{
+    const ScopedLock sl(modelLock);
+
+    int electrodeIndex = 0;
+
+    for (int i = 0; i < eventChannels.size(); i++)
+    {
+        if (eventChannels[i]->eventType < SPIKE_BASE_CODE)
+            continue;
+
+        const int nChans = eventChannels[i]->eventType - SPIKE_BASE_CODE;
+
+        if (electrodeIndex == sortingElectrodes.size())
+        {
+            SortingElectrode* e = new SortingElectrode();
+            e->numChannels = 0;
+            sortingElectrodes.add(e);
+        }
+
+        SortingElectrode* e = sortingElectrodes[electrodeIndex];
+
+        if (e->numChannels != nChans)
+        {
+            e->numChannels = nChans;
+            e->model = nullptr;
+            e->recent.malloc(recentSpikes * nChans * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+            e->numRecent = 0;
+            e->nextRecent = 0;
+            e->recentDims = 0;
+        }
+
+        if (e->model == nullptr && loadedModels[electrodeIndex] != nullptr)
+        {
+            e->model = loadedModels[electrodeIndex];
+            loadedModels.set(electrodeIndex, nullptr, false);
+        }
+
+        electrodeIndex++;
+    }
+
+    while (sortingElectrodes.size() > electrodeIndex)
+        sortingElectrodes.removeLast();
+
+}
+
+bool SpikeSorter::enable()
+{
+    sortedEvents.clear();
+
+    return true;
+}
+
+void SpikeSorter::process(AudioSampleBuffer& buffer,
+                          MidiBuffer& events,
+                          int& nSamples)
+{
+    if (events.getNumEvents() == 0)
+        return;
+
+    // the message thread only holds the lock to swap a model; if it does,
+    // this block's spikes go through unsorted
+    const ScopedTryLock lock(modelLock);
+
+    if (! lock.isLocked())
+        return;
+
+    sortedEvents.clear();
+
+    MidiBuffer::Iterator i(events);
+
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        SpikeObject s;
+
+        if (*dataptr == SPIKE &&
+            unpackSpike(&s, dataptr, dataSize) &&
+            s.source < sortingElectrodes.size())
+        {
+            SortingElectrode* e = sortingElectrodes.getUnchecked(s.source);
+
+            const int n = getWaveform(s, waveform);
+
+            if (e->recentDims == 0 && n <= e->numChannels * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES)
+                e->recentDims = n;
+
+            // keep it for learning the PCA basis
+            if (n == e->recentDims)
+            {
+                memcpy(e->recent + e->nextRecent * n, waveform, sizeof(float) * n);
+
+                e->nextRecent = (e->nextRecent + 1) % recentSpikes;
+                e->numRecent = jmin(e->numRecent + 1, (int) recentSpikes);
+            }
+
+            s.sortedId = 0;
+
+            if (e->model != nullptr && e->model->numDims == n)
+            {
+                float features[SortingModel::numComponents];
+
+                e->model->project(waveform, features);
+
+                const int unit = e->model->classify(features);
+
+                if (unit > 0)
+                    e->model->adapt(unit, features);
+
+                s.sortedId = (uint16_t) unit;
+            }
+
+            const int numBytes = packSpike(&s, spikeBuffer, MAX_SPIKE_BUFFER_LEN);
+
+            if (numBytes > 0)
+                sortedEvents.addEvent(spikeBuffer, numBytes, samplePosition);
+        }
+        else
+        {
+            sortedEvents.addEvent(dataptr, dataSize, samplePosition);
+        }
+    }
+
+    events.swapWith(sortedEvents);
+
+}
+
+SortingModel* SpikeSorter::buildModel(SortingElectrode* e)
+{
+    int n, count;
+    HeapBlock<float> data;
+
+    {
+        const ScopedLock sl(modelLock);
+
+        n = e->recentDims;
+        count = e->numRecent;
+
+        if (n == 0 || count < minSpikesForBasis)
+            return nullptr;
+
+        data.malloc(count * n);
+        memcpy(data, e->recent, sizeof(float) * count * n);
+    }
+
+    HeapBlock<float> mean(n, true);
+
+    for (int r = 0; r < count; r++)
+        for (int i = 0; i < n; i++)
+            mean[i] += data[r*n + i] / float(count);
+
+    for (int r = 0; r < count; r++)
+        for (int i = 0; i < n; i++)
+            data[r*n + i] -= mean[i];
+
+    // covariance matrix
+    HeapBlock<float> covariance(n * n, true);
+
+    for (int r = 0; r < count; r++)
+    {
+        const float* x = data + r*n;
+
+        for (int i = 0; i < n; i++)
+            for (int j = i; j < n; j++)
+                covariance[i*n + j] += x[i] * x[j] / float(count);
+    }
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < i; j++)
+            covariance[i*n + j] = covariance[j*n + i];
+
+    // leading eigenvectors by power iteration, keeping each one orthogonal
+    // to those already found
+    SortingModel* model = new SortingModel(n);
+
+    HeapBlock<float> next(n);
+    float eigenvalue = 0.0f;
+
+    for (int k = 0; k < SortingModel::numComponents; k++)
+    {
+        float* v = model->components + k*n;
+
+        for (int i = 0; i < n; i++)
+            v[i] = 1.0f + float((i * (k + 1)) % 7);
+
+        for (int iteration = 0; iteration < 100; iteration++)
+        {
+            for (int i = 0; i < n; i++)
+                next[i] = dotProduct(covariance + i*n, v, n);
+
+            for (int p = 0; p < k; p++)
+            {
+                const float* u = model->components + p*n;
+                const float projection = dotProduct(next, u, n);
+
+                for (int i = 0; i < n; i++)
+                    next[i] -= projection * u[i];
+            }
+
+            eigenvalue = sqrtf(dotProduct(next, next, n));
+
+            if (eigenvalue <= 0.0f)
+                break;
+
+            for (int i = 0; i < n; i++)
+                v[i] = next[i] / eigenvalue;
+        }
+
+        model->offsets[k] = dotProduct(v, mean, n);
+    }
+
+    // spikes more than three standard deviations (along the weakest
+    // component) from every template stay unsorted
+    model->maxDistanceSquared = jmax(9.0f * eigenvalue, 1.0f);
+
+    return model;
+}
+
+void SpikeSorter::setModel(int electrode, SortingModel* model)
+{
+    ScopedPointer<SortingModel> oldModel;
+
+    {
+        const ScopedLock sl(modelLock);
+
+        oldModel = sortingElectrodes[electrode]->model.release();
+        sortingElectrodes[electrode]->model = model;
+    }
+
+    SpikeSorterEditor* ed = (SpikeSorterEditor*) getEditor();
+
+    if (ed != nullptr)
+        ed->updateUnitCount();
+}
+
+bool SpikeSorter::addTemplate(const SpikeObject& s)
+{
+    if (s.source >= sortingElectrodes.size())
+        return false;
+
+    SortingElectrode* e = sortingElectrodes[s.source];
+
+    HeapBlock<float> spikeWaveform(MAX_NUMBER_OF_SPIKE_CHANNELS * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+    const int n = getWaveform(s, spikeWaveform);
+
+    ScopedPointer<SortingModel> model;
+
+    {
+        const ScopedLock sl(modelLock);
+
+        if (e->model != nullptr)
+            model = new SortingModel(*e->model);
+    }
+
+    if (model == nullptr)
+        model = buildModel(e);
+
+    if (model == nullptr)
+    {
+        std::cout << "Not enough spikes on electrode " << s.source
+                  << " to build templates." << std::endl;
+        return false;
+    }
+
+    if (model->numDims != n)
+        return false;
+
+    float features[SortingModel::numComponents];
+
+    model->project(spikeWaveform, features);
+    model->addTemplate(features);
+
+    std::cout << "Electrode " << s.source << " now has "
+              << model->getNumTemplates() << " units." << std::endl;
+
+    setModel(s.source, model.release());
+
+    return true;
+}
+
+void SpikeSorter::clearTemplates(int electrode)
+{
+    if (electrode < sortingElectrodes.size())
+        setModel(electrode, nullptr);
+}
+
+void SpikeSorter::clearAllTemplates()
+{
+    for (int i = 0; i < sortingElectrodes.size(); i++)
+        setModel(i, nullptr);
+}
+
+int SpikeSorter::getNumTemplates(int electrode)
+{
+    const ScopedLock sl(modelLock);
+
+    if (electrode < sortingElectrodes.size() && sortingElectrodes[electrode]->model != nullptr)
+        return sortingElectrodes[electrode]->model->getNumTemplates();
+
+    return 0;
+}
+
+int SpikeSorter::getTotalNumTemplates()
+{
+    int total = 0;
+
+    for (int i = 0; i < sortingElectrodes.size(); i++)
+        total += getNumTemplates(i);
+
+    return total;
+}
+
+void SpikeSorter::saveCustomParametersToXml(XmlElement* parentElement)
+{
+    const ScopedLock sl(modelLock);
+
+    for (int i = 0; i < sortingElectrodes.size(); i++)
+    {
+        SortingModel* model = sortingElectrodes[i]->model;
+
+        if (model == nullptr)
+            continue;
+
+        XmlElement* unitsNode = parentElement->createNewChildElement("UNITS");
+        unitsNode->setAttribute("electrode", i);
+        unitsNode->setAttribute("dims", model->numDims);
+        unitsNode->setAttribute("maxDistanceSquared", model->maxDistanceSquared);
+
+        MemoryBlock components(model->components,
+                               sizeof(float) * SortingModel::numComponents * model->numDims);
+        MemoryBlock offsets(model->offsets, sizeof(model->offsets));
+        MemoryBlock centroids(model->centroids.getRawDataPointer(),
+                              sizeof(float) * model->centroids.size());
+
+        unitsNode->setAttribute("components", components.toBase64Encoding());
+        unitsNode->setAttribute("offsets", offsets.toBase64Encoding());
+        unitsNode->setAttribute("centroids", centroids.toBase64Encoding());
+    }
+}
+
+void SpikeSorter::loadCustomParametersFromXml()
+{
+    if (parametersAsXml == nullptr)
+        return;
+
+    forEachXmlChildElement(*parametersAsXml, xmlNode)
+    {
+        if (xmlNode->hasTagName("UNITS"))
+        {
+            const int electrode = xmlNode->getIntAttribute("electrode");
+            const int dims = xmlNode->getIntAttribute("dims");
+
+            if (electrode < 0 || dims <= 0 ||
+                dims > MAX_NUMBER_OF_SPIKE_CHANNELS * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES)
+                continue;
+
+            MemoryBlock components, offsets, centroids;
+            components.fromBase64Encoding(xmlNode->getStringAttribute("components"));
+            offsets.fromBase64Encoding(xmlNode->getStringAttribute("offsets"));
+            centroids.fromBase64Encoding(xmlNode->getStringAttribute("centroids"));
+
+            if (components.getSize() != sizeof(float) * SortingModel::numComponents * dims ||
+                offsets.getSize() != sizeof(float) * SortingModel::numComponents)
+                continue;
+
+            SortingModel* model = new SortingModel(dims);
+            model->maxDistanceSquared = (float) xmlNode->getDoubleAttribute("maxDistanceSquared");
+
+            components.copyTo(model->components, 0, components.getSize());
+            offsets.copyTo(model->offsets, 0, offsets.getSize());
+
+            const float* c = (const float*) centroids.getData();
+
+            for (int k = 0; k < int(centroids.getSize() / sizeof(float)); k++)
+                model->centroids.add(c[k]);
+
+            // applied by updateSettings() once the electrode exists
+            while (loadedModels.size() <= electrode)
+                loadedModels.add(nullptr);
+
+            loadedModels.set(electrode, model);
+        }
+    }
+
+    for (int i = 0; i < sortingElectrodes.size() && i < loadedModels.size(); i++)
+    {
+        if (loadedModels[i] != nullptr)
+        {
+            setModel(i, loadedModels[i]);
+            loadedModels.set(i, nullptr, false);
+        }
+    }
+}
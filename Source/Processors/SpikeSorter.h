@@ -0,0 +1,209 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKESORTER_H_4C8E12A7__
+#define __SPIKESORTER_H_4C8E12A7__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+#include "GenericProcessor.h"
+
+#include "Visualization/SpikeObject.h"
+#include "Visualization/SpikeMath.h"
+
+/**
+
+  Unit templates for one electrode.
+
+  Waveforms (all channels, concatenated) are projected onto the first three
+  principal components of the electrode's recent spikes, and each unit is
+  represented by its centroid in that space. A model is only changed on the
+  message thread, apart from the centroids, which the audio thread moves
+  slowly toward the spikes assigned to them.
+
+  @see SpikeSorter
+
+*/
+
+class SortingModel
+{
+public:
+
+    SortingModel(int numDims);
+
+    /** Makes a copy of another model (basis and templates). */
+    SortingModel(const SortingModel& other);
+
+    enum { numComponents = 3 };
+
+    /** Projects a waveform onto the principal components. */
+    void project(const float* waveform, float* features) const;
+
+    /** Returns the unit (1-based) whose centroid is nearest to a point in
+        feature space, or 0 if none of them is within maxDistance. */
+    int classify(const float* features) const;
+
+    /** Moves the centroid of a unit a small step toward a point. */
+    void adapt(int unit, const float* features);
+
+    /** Adds a unit with a given centroid. */
+    void addTemplate(const float* features);
+
+    /** Returns the number of units. */
+    int getNumTemplates() const
+    {
+        return centroids.size() / numComponents;
+    }
+
+    int numDims;
+
+    /** numComponents rows of numDims coefficients. */
+    HeapBlock<float> components;
+
+    /** Projection of the mean waveform on each component. */
+    float offsets[numComponents];
+
+    /** Squared distance beyond which a spike stays unsorted. */
+    float maxDistanceSquared;
+
+    Array<float> centroids;
+
+private:
+
+    SortingModel& operator= (const SortingModel&);
+
+    JUCE_LEAK_DETECTOR(SortingModel);
+
+};
+
+/**
+
+  Assigns spikes to units in real time.
+
+  Placed downstream of a SpikeDetector, it classifies every incoming spike
+  by nearest neighbour among the unit templates of its electrode, in a
+  three-dimensional PCA space, and writes the unit ID into the spike's
+  sortedId field (0 if unsorted). Templates are added from the Spike Viewer
+  (shift-click a waveform) and the PCA basis is learned from the last few
+  hundred spikes of the electrode when its first template is added.
+
+  The continuous channels are left untouched; only the spike events are
+  rewritten.
+
+  @see SpikeDetector, SortingModel, SpikeDisplayCanvas
+
+*/
+
+class SpikeSorter : public GenericProcessor
+
+{
+public:
+
+    SpikeSorter();
+    ~SpikeSorter();
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples);
+
+    /** Only rewrites events. */
+    bool isPassThrough()
+    {
+        return true;
+    }
+
+    bool enable();
+
+    /** Sets up one set of templates for each incoming electrode. */
+    void updateSettings();
+
+    AudioProcessorEditor* createEditor();
+
+    bool hasEditor() const
+    {
+        return true;
+    }
+
+    /** Adds a unit whose template is a given spike; builds the PCA basis
+        first if the electrode has no templates yet (message thread only).
+        Returns false if there are too few spikes to build it. */
+    bool addTemplate(const SpikeObject& s);
+
+    /** Removes all units of an electrode (message thread only). */
+    void clearTemplates(int electrode);
+
+    /** Removes all units of all electrodes (message thread only). */
+    void clearAllTemplates();
+
+    /** Returns the number of units of an electrode. */
+    int getNumTemplates(int electrode);
+
+    /** Returns the total number of units. */
+    int getTotalNumTemplates();
+
+    void saveCustomParametersToXml(XmlElement* parentElement);
+    void loadCustomParametersFromXml();
+
+private:
+
+    struct SortingElectrode
+    {
+        int numChannels;
+
+        ScopedPointer<SortingModel> model;
+
+        /** The last recentSpikes waveforms, used to learn the PCA basis. */
+        HeapBlock<float> recent;
+        int numRecent;
+        int nextRecent;
+        int recentDims;
+    };
+
+    enum { recentSpikes = 256, minSpikesForBasis = 32 };
+
+    /** Converts a spike's samples to floats (all channels, concatenated). */
+    static int getWaveform(const SpikeObject& s, float* waveform);
+
+    /** Computes a PCA basis from an electrode's recent spikes. */
+    SortingModel* buildModel(SortingElectrode* e);
+
+    /** Swaps in a new model (message thread). */
+    void setModel(int electrode, SortingModel* model);
+
+    OwnedArray<SortingElectrode> sortingElectrodes;
+
+    /** Models read from a settings file before the electrodes existed. */
+    OwnedArray<SortingModel> loadedModels;
+
+    /** Held by the audio thread while it classifies a block, and by the
+        message thread while it swaps models. */
+    CriticalSection modelLock;
+
+    MidiBuffer sortedEvents;
+
+    HeapBlock<uint8_t> spikeBuffer;
+    HeapBlock<float> waveform;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorter);
+
+};
+
+#endif  // __SPIKESORTER_H_4C8E12A7__
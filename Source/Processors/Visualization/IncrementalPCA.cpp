@@ -0,0 +1,268 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "IncrementalPCA.h"
+#include "SpikeMath.h"
+
+#include <math.h>
+
+// a new basis is published when any component has turned by more than ~11 degrees
+#define MIN_SIMILARITY 0.98f
+
+IncrementalPCA::IncrementalPCA(int numComponents_, int maxChannels)
+    : numComponents(jlimit(1, (int) maxComponents, numComponents_)),
+      maxDims(maxChannels * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES),
+      numDims(0), count(0), basisDims(0), estimateDims(0)
+{
+    mean.calloc(maxDims);
+    covariance.calloc(maxDims * maxDims);
+    waveform.calloc(maxDims);
+    delta.calloc(maxDims);
+
+    components.calloc(numComponents * maxDims);
+
+    for (int k = 0; k < maxComponents; k++)
+        offsets[k] = 0.0f;
+
+    snapshotMean.calloc(maxDims);
+    snapshotCovariance.calloc(maxDims * maxDims);
+    estimate.calloc(numComponents * maxDims);
+    next.calloc(maxDims);
+}
+
+IncrementalPCA::~IncrementalPCA()
+{
+
+}
+
+int IncrementalPCA::getWaveform(const SpikeObject& s, float* waveform)
+{
+    if (s.nChannels > MAX_NUMBER_OF_SPIKE_CHANNELS || s.nSamples > MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES)
+        return 0;
+
+    for (int c = 0; c < s.nChannels; c++)
+    {
+        if (s.gain[c] == 0)
+            return 0;
+
+        const float scale = 1000.0f / float(s.gain[c]);
+        const uint16_t* data = s.data + c*s.nSamples;
+        float* out = waveform + c*s.nSamples;
+
+        for (int i = 0; i < s.nSamples; i++)
+            out[i] = (float(data[i]) - 32768.0f) * scale;
+    }
+
+    return s.nChannels * s.nSamples;
+}
+
+void IncrementalPCA::addSpike(const SpikeObject& s)
+{
+    const ScopedTryLock tl(lock);
+
+    if (!tl.isLocked())
+        return;
+
+    if (s.nChannels * s.nSamples > maxDims)
+        return;
+
+    const int n = getWaveform(s, waveform);
+
+    if (n == 0)
+        return;
+
+    if (n != numDims)
+    {
+        numDims = n;
+        count = 0;
+
+        FloatVectorOperations::clear(mean, n);
+        FloatVectorOperations::clear(covariance, n * n);
+    }
+
+    count++;
+
+    // exponentially weighted mean and covariance; for the first
+    // historyLength spikes, this is the ordinary (population) estimate
+    const float w = 1.0f / float(jmin(count, (int64) historyLength));
+    const float keep = 1.0f - w;
+
+    for (int i = 0; i < n; i++)
+    {
+        delta[i] = waveform[i] - mean[i];
+        mean[i] += w * delta[i];
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        const float wd = w * delta[i];
+        float* row = covariance + i*n;
+
+        for (int j = i; j < n; j++)
+            row[j] = keep * (row[j] + wd * delta[j]);
+    }
+}
+
+bool IncrementalPCA::projectSpike(const SpikeObject& s, float* features)
+{
+    const ScopedTryLock tl(lock);
+
+    if (!tl.isLocked() || basisDims == 0)
+        return false;
+
+    if (s.nChannels * s.nSamples != basisDims)
+        return false;
+
+    getWaveform(s, waveform);
+    project(waveform, features);
+
+    return true;
+}
+
+void IncrementalPCA::project(const float* x, float* features) const
+{
+    for (int k = 0; k < numComponents; k++)
+        features[k] = dotProduct(components + k*basisDims, x, basisDims) - offsets[k];
+}
+
+bool IncrementalPCA::updateComponents()
+{
+    int n;
+
+    {
+        const ScopedLock sl(lock);
+
+        n = numDims;
+
+        if (n == 0 || count < minSpikes)
+            return false;
+
+        memcpy(snapshotMean, mean, sizeof(float) * n);
+
+        for (int i = 0; i < n; i++)
+            memcpy(snapshotCovariance + i*n + i, covariance + i*n + i, sizeof(float) * (n - i));
+    }
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < i; j++)
+            snapshotCovariance[i*n + j] = snapshotCovariance[j*n + i];
+
+    if (estimateDims != n)
+    {
+        for (int k = 0; k < numComponents; k++)
+            for (int i = 0; i < n; i++)
+                estimate[k*n + i] = 1.0f + float((i * (k + 1)) % 7);
+
+        estimateDims = n;
+    }
+
+    // power iteration, starting from the previous estimate and keeping each
+    // component orthogonal to the ones before it
+    for (int k = 0; k < numComponents; k++)
+    {
+        float* v = estimate + k*n;
+
+        for (int iteration = 0; iteration < 100; iteration++)
+        {
+            for (int i = 0; i < n; i++)
+                next[i] = dotProduct(snapshotCovariance + i*n, v, n);
+
+            for (int p = 0; p < k; p++)
+            {
+                const float* u = estimate + p*n;
+                const float projection = dotProduct(next, u, n);
+
+                for (int i = 0; i < n; i++)
+                    next[i] -= projection * u[i];
+            }
+
+            const float norm = sqrtf(dotProduct(next, next, n));
+
+            if (norm <= 0.0f)
+                break;
+
+            FloatVectorOperations::multiply(next, 1.0f / norm, n);
+
+            const float change = 1.0f - fabsf(dotProduct(next, v, n));
+
+            memcpy(v, next, sizeof(float) * n);
+
+            if (change < 1.0e-6f)
+                break;
+        }
+    }
+
+    // keep the old basis unless the new one has moved away from it
+    bool rotated = (basisDims != n);
+
+    for (int k = 0; k < numComponents && !rotated; k++)
+    {
+        if (fabsf(dotProduct(estimate + k*n, components + k*n, n)) < MIN_SIMILARITY)
+            rotated = true;
+    }
+
+    if (!rotated)
+        return false;
+
+    // eigenvectors are only defined up to their sign; choose the one that
+    // keeps clusters on the same side of the axes as before
+    for (int k = 0; k < numComponents; k++)
+    {
+        float* v = estimate + k*n;
+        float orientation = 0.0f;
+
+        if (basisDims == n)
+        {
+            orientation = dotProduct(v, components + k*n, n);
+        }
+        else
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (fabsf(v[i]) > fabsf(orientation))
+                    orientation = v[i];
+            }
+        }
+
+        if (orientation < 0.0f)
+            FloatVectorOperations::multiply(v, -1.0f, n);
+    }
+
+    float newOffsets[maxComponents];
+
+    for (int k = 0; k < numComponents; k++)
+        newOffsets[k] = dotProduct(estimate + k*n, snapshotMean, n);
+
+    {
+        const ScopedLock sl(lock);
+
+        memcpy(components, estimate, sizeof(float) * numComponents * n);
+
+        for (int k = 0; k < numComponents; k++)
+            offsets[k] = newOffsets[k];
+
+        basisDims = n;
+    }
+
+    return true;
+}
@@ -0,0 +1,123 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INCREMENTALPCA_H_93D0B6F1__
+#define __INCREMENTALPCA_H_93D0B6F1__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include "SpikeObject.h"
+
+/**
+
+  Principal components of a stream of spike waveforms.
+
+  Each spike (all channels, concatenated, in microvolts) updates a running
+  mean and covariance with exponential forgetting, so the basis follows
+  slow drift in the recording. This is O(n^2) per spike and happens on the
+  audio thread. Every so often, updateComponents() is called from the
+  message thread to find the leading eigenvectors by power iteration,
+  starting from the previous ones. A new basis is only published when it
+  has rotated noticeably, so that points drawn in the old one stay useful.
+
+  Projecting a spike is a fixed-size matrix multiply (numComponents rows)
+  and can be done by any consumer holding the object.
+
+  The audio thread only try-locks; a spike that arrives while the message
+  thread is copying the statistics is not counted or projected.
+
+  @see SpikePlot, ProjectionAxes
+
+*/
+
+class IncrementalPCA
+{
+public:
+
+    /** Creates an engine for waveforms with up to maxChannels channels. */
+    IncrementalPCA(int numComponents, int maxChannels);
+    ~IncrementalPCA();
+
+    enum { maxComponents = 4 };
+
+    /** Adds a spike to the running statistics (audio thread). If its length
+        differs from the previous spikes, the statistics start over. */
+    void addSpike(const SpikeObject& s);
+
+    /** Projects a spike onto the current basis. Returns false if there is
+        no basis yet, or the spike does not match it (audio thread). */
+    bool projectSpike(const SpikeObject& s, float* features);
+
+    /** Recomputes the leading components (message thread). Returns true if
+        a new basis was published. */
+    bool updateComponents();
+
+    int getNumComponents() const
+    {
+        return numComponents;
+    }
+
+    /** Converts the samples of a spike to microvolts; returns the number
+        of values written. */
+    static int getWaveform(const SpikeObject& s, float* waveform);
+
+    /** Weight of the oldest spikes after this many new ones is 1/e. */
+    enum { historyLength = 4096 };
+
+    /** Spikes needed before a first basis is computed. */
+    enum { minSpikes = 64 };
+
+private:
+
+    void project(const float* waveform, float* features) const;
+
+    const int numComponents;
+    const int maxDims;
+
+    CriticalSection lock;
+
+    // running statistics (audio thread, under lock)
+    int numDims;
+    int64 count;
+    HeapBlock<float> mean;
+    HeapBlock<float> covariance; // upper triangle used
+    HeapBlock<float> waveform;
+    HeapBlock<float> delta;
+
+    // published basis (written on the message thread, under lock)
+    int basisDims;
+    HeapBlock<float> components;
+    float offsets[maxComponents];
+
+    // working copies (message thread only)
+    HeapBlock<float> snapshotMean;
+    HeapBlock<float> snapshotCovariance;
+    HeapBlock<float> estimate;
+    HeapBlock<float> next;
+    int estimateDims;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IncrementalPCA);
+
+};
+
+#endif  // __INCREMENTALPCA_H_93D0B6F1__
@@ -26,21 +26,16 @@
 #include <math.h>
 
 LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* processor_) :
-    screenBufferIndex(0), timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
-    processor(processor_),
-    displayBufferIndex(0)
+    timebase(1.0f), processor(processor_),
+    meanBuffer(1, 1), intervalBuffer(1, 1), lastTotalTrials(-1), numTrials(0)
 {
 
     nChans = processor->getNumInputs();
     sampleRate = processor->getSampleRate();
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    displayBuffer = processor->getDisplayBufferAddress();
-    displayBufferSize = displayBuffer->getNumSamples();
-    std::cout << "Setting displayBufferSize on LfpTriggeredAverageCanvas to " << displayBufferSize << std::endl;
-
-    screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
-    screenBuffer->clear();
+    meanBuffer.clear();
+    intervalBuffer.clear();
 
     viewport = new Viewport();
     display = new LfpTriggeredAverageDisplay(this, viewport);
@@ -53,11 +48,6 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
 
     scrollBarThickness = viewport->getScrollBarThickness();
 
-
-    //viewport->getVerticalScrollBar()->addListener(this->scrollBarMoved(viewport->getVerticalScrollBar(), 1.0));
-
-
-
     addAndMakeVisible(viewport);
     addAndMakeVisible(timescale);
 
@@ -103,11 +93,15 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     spreadSelection->addListener(this);
     addAndMakeVisible(spreadSelection);
 
+    clearButton = new UtilityButton("clear", Font("Small Text", 13, Font::plain));
+    clearButton->setRadius(3.0f);
+    clearButton->addListener(this);
+    addAndMakeVisible(clearButton);
 
     display->setNumChannels(nChans);
     display->setRange(1000.0f);
 
-    // add event display-specific controls (currently just an enable/disable button)
+    // trigger channel selection (TTL channel 1 by default)
     for (int i = 0; i < 8; i++)
     {
 
@@ -117,17 +111,19 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
         addAndMakeVisible(eventOptions);
         eventOptions->setBounds(500+(floor(i/2)*20), getHeight()-20-(i%2)*20, 40, 20);
 
-        display->setEventDisplayState(i,true);
+        display->setEventDisplayState(i, i == 0);
 
     }
 
+    updateTriggerChannels();
+
+    processor->setWindowLength(timebase);
 
 }
 
 LfpTriggeredAverageCanvas::~LfpTriggeredAverageCanvas()
 {
 
-    deleteAndZero(screenBuffer);
 }
 
 void LfpTriggeredAverageCanvas::resized()
@@ -148,9 +144,7 @@ void LfpTriggeredAverageCanvas::resized()
         LfpTriggeredAverageEventInterfaces[i]->repaint();
     }
 
-
-    // std::cout << "Canvas thinks LfpTriggeredAverageDisplay should be this high: "
-    //  << LfpTriggeredAverageDisplay->getTotalHeight() << std::endl;
+    clearButton->setBounds(600,getHeight()-30,60,25);
 
 }
 
@@ -158,9 +152,7 @@ void LfpTriggeredAverageCanvas::beginAnimation()
 {
     std::cout << "Beginning animation." << std::endl;
 
-    displayBufferSize = displayBuffer->getNumSamples();
-
-    screenBufferIndex = 0;
+    lastTotalTrials = -1;
 
     startCallbacks();
 }
@@ -179,8 +171,6 @@ void LfpTriggeredAverageCanvas::update()
 
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    refreshScreenBuffer();
-
     display->setNumChannels(nChans);
 
     // update channel names
@@ -197,6 +187,8 @@ void LfpTriggeredAverageCanvas::update()
 
     display->setBounds(0,0,getWidth()-scrollBarThickness*2, display->getTotalHeight());
 
+    lastTotalTrials = -1;
+
 }
 
 void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
@@ -205,6 +197,8 @@ void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
     if (cb == timebaseSelection)
     {
         timebase = timebases[cb->getSelectedId()-1].getFloatValue();
+        processor->setWindowLength(timebase);
+        lastTotalTrials = -1;
     }
     else if (cb == rangeSelection)
     {
@@ -221,9 +215,33 @@ void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
     }
 
     timescale->setTimebase(timebase);
+
+    fullredraw = true;
+    refresh();
+}
+
+void LfpTriggeredAverageCanvas::buttonClicked(Button* button)
+{
+    if (button == clearButton)
+    {
+        processor->resetAverage();
+        lastTotalTrials = -1;
+        refresh();
+    }
 }
 
+void LfpTriggeredAverageCanvas::updateTriggerChannels()
+{
+    int mask = 0;
 
+    for (int i = 0; i < 8; i++)
+    {
+        if (display->getEventDisplayState(i))
+            mask |= (1 << i);
+    }
+
+    processor->setTriggerMask(mask);
+}
 
 
 int LfpTriggeredAverageCanvas::getChannelHeight()
@@ -235,152 +253,45 @@ int LfpTriggeredAverageCanvas::getChannelHeight()
 
 void LfpTriggeredAverageCanvas::setParameter(int param, float val)
 {
-    // if (param == 0)
-    // {
-    //     timebase = val;
-    //     refreshScreenBuffer();
-    // }
-    // else
-    // {
-    //     displayGain = val; //* 0.0001f;
-    // }
-
-    // repaint();
+
 }
 
 void LfpTriggeredAverageCanvas::refreshState()
 {
     // called when the component's tab becomes visible again
-    displayBufferIndex = processor->getDisplayBufferIndex();
-    screenBufferIndex = 0;
+    lastTotalTrials = -1;
 
 }
 
-void LfpTriggeredAverageCanvas::refreshScreenBuffer()
+int LfpTriggeredAverageCanvas::getSampleIndex(int x)
 {
+    const int width = getWidth() - leftmargin - scrollBarThickness;
 
-    screenBufferIndex = 0;
-
-    screenBuffer->clear();
-
-    // int w = display->getWidth();
-    // //std::cout << "Refreshing buffer size to " << w << "pixels." << std::endl;
-
-    // for (int i = 0; i < w; i++)
-    // {
-    //  float x = float(i);
-
-    //  for (int n = 0; n < nChans; n++)
-    //  {
-    //      waves[n][i*2] = x;
-    //      waves[n][i*2+1] = 0.5f; // line in center of display
-    //  }
-    // }
+    if (width <= 0)
+        return 0;
 
+    return jlimit(0, meanBuffer.getNumSamples() - 1, x * meanBuffer.getNumSamples() / width);
 }
 
-void LfpTriggeredAverageCanvas::updateScreenBuffer()
+int LfpTriggeredAverageCanvas::getNumChannels()
 {
-
-
-    // copy new samples from the displayBuffer into the screenBuffer (waves)
-    int maxSamples = display->getWidth() - leftmargin;
-
-    if (screenBufferIndex >= maxSamples) // wrap around if we reached right edge before
-        screenBufferIndex = 0;
-
-    lastScreenBufferIndex = screenBufferIndex;
-
-    int index = processor->getDisplayBufferIndex();
-
-    int nSamples =  index - displayBufferIndex; // N new samples to be addeddisplayBufferIndex
-
-    if (nSamples < 0) // buffer has reset to 0
-    {
-        nSamples = (displayBufferSize - displayBufferIndex) + index;
-    }
-
-    float ratio = sampleRate * timebase / float(getWidth() - leftmargin - scrollBarThickness);
-
-    // this number is crucial: converting from samples to values (in px) for the screen buffer
-    int valuesNeeded = (int) float(nSamples) / ratio;
-
-
-    if (screenBufferIndex + valuesNeeded > maxSamples)  // crop number of samples to fit cavas width
-    {
-        valuesNeeded = maxSamples - screenBufferIndex;
-    }
-
-    float subSampleOffset = 0.0;
-
-    displayBufferIndex = displayBufferIndex % displayBufferSize; // make sure we're not overshooting
-    int nextPos = (displayBufferIndex + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
-
-    if (valuesNeeded > 0 && valuesNeeded < 1000)
-    {
-
-        for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
-        {
-            float gain = 1.0;
-            float alpha = (float) subSampleOffset;
-            float invAlpha = 1.0f - alpha;
-
-            screenBuffer->clear(screenBufferIndex, 1);
-
-            for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
-            {
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, displayBufferIndex), // source
-                                      1, // numSamples
-                                      invAlpha*gain); // gain
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, nextPos), // source
-                                      1, // numSamples
-                                      alpha*gain); // gain
-
-
-            }
-
-            subSampleOffset += ratio;
-
-            while (subSampleOffset >= 1.0)
-            {
-                if (++displayBufferIndex > displayBufferSize)
-                    displayBufferIndex = 0;
-
-                nextPos = (displayBufferIndex + 1) % displayBufferSize;
-                subSampleOffset -= 1.0;
-            }
-
-            screenBufferIndex++;
-
-        }
-
-
-    }
-    else
-    {
-        //std::cout << "Skip." << std::endl;
-    }
+    return nChans;
 }
 
-float LfpTriggeredAverageCanvas::getXCoord(int chan, int samp)
+float LfpTriggeredAverageCanvas::getYCoord(int chan, int x)
 {
-    return samp;
-}
+    if (chan >= meanBuffer.getNumChannels())
+        return 0.0f;
 
-int LfpTriggeredAverageCanvas::getNumChannels()
-{
-    return nChans;
+    return *meanBuffer.getSampleData(chan, getSampleIndex(x));
 }
 
-float LfpTriggeredAverageCanvas::getYCoord(int chan, int samp)
+float LfpTriggeredAverageCanvas::getInterval(int chan, int x)
 {
-    return *screenBuffer->getSampleData(chan, samp);
+    if (chan >= intervalBuffer.getNumChannels())
+        return 0.0f;
+
+    return *intervalBuffer.getSampleData(chan, getSampleIndex(x));
 }
 
 void LfpTriggeredAverageCanvas::paint(Graphics& g)
@@ -419,22 +330,29 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
     g.setColour(Colour(100,100,100));
 
     g.drawText("Voltage range (uV)",5,getHeight()-55,300,20,Justification::left, false);
-    g.drawText("Timebase (s)",175,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Window (s)",175,getHeight()-55,300,20,Justification::left, false);
     g.drawText("Spread (px)",345,getHeight()-55,300,20,Justification::left, false);
 
-    g.drawText("Event display",500,getHeight()-55,300,20,Justification::left, false);
-
+    g.drawText("Trigger",500,getHeight()-55,300,20,Justification::left, false);
 
+    g.drawText("Trials: " + String(numTrials),680,getHeight()-30,200,25,Justification::left, false);
 
 }
 
 void LfpTriggeredAverageCanvas::refresh()
 {
-    updateScreenBuffer();
+    const int64 totalTrials = processor->getAverage(meanBuffer, intervalBuffer,
+                                                    lastTotalTrials, numTrials);
+
+    if (totalTrials != lastTotalTrials || fullredraw)
+    {
+        lastTotalTrials = totalTrials;
 
-    display->refresh(); // redraws only the new part of the screen buffer
+        fullredraw = true;
+        display->refresh(); // redraws all visible channels
 
-    //getPeer()->performAnyPendingRepaintsNow();
+        repaint(600, getHeight()-30, 300, 25); // trial count
+    }
 
 }
 
@@ -478,7 +396,7 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
             viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
-            int eventButtonState = xmlNode->getIntAttribute("eventButtonState");
+            int eventButtonState = xmlNode->getIntAttribute("EventButtonState", 1);
 
             for (int i = 0; i < 8; i++)
             {
@@ -486,6 +404,8 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
 
             	LfpTriggeredAverageEventInterfaces[i]->checkEnabledState();
             }
+
+            updateTriggerChannels();
         }
     }
 
@@ -534,11 +454,12 @@ void LfpTriggeredAverageTimescale::setTimebase(float t)
 
     labels.clear();
 
+    // the trigger is at the centre of the window
     for (float i = 1.0f; i < 10.0; i++)
     {
-        String labelString = String(timebase/10.0f*1000.0f*i);
+        String labelString = String(timebase/10.0f*1000.0f*(i-5.0f));
 
-        labels.add(labelString.substring(0,4));
+        labels.add(labelString.substring(0,5));
     }
 
     repaint();
@@ -695,17 +616,9 @@ void LfpTriggeredAverageDisplay::refresh()
         {
             if (canvas->fullredraw)
             {
-                channels[i]->fullredraw = true;
                 channels[i]->repaint();
                 channelInfo[i]->repaint();
-
             }
-            else
-            {
-                channels[i]->repaint(canvas->lastScreenBufferIndex-2, 0, (canvas->screenBufferIndex-canvas->lastScreenBufferIndex)+3, getChildComponent(i)->getHeight());  //repaint only the updated portion
-                // we redraw from -2 to +1 relative to the real redraw window, the -2 makes sure that the lines join nicely, and the +1 draws the vertical update line
-            }
-            //std::cout << i << std::endl;
         }
 
     }
@@ -878,17 +791,6 @@ LfpTriggeredAverageChannelDisplay::~LfpTriggeredAverageChannelDisplay()
 void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
 {
 
-    //g.fillAll(Colours::grey);
-
-    g.setColour(Colours::yellow);   // draw most recent drawn sample position
-    g.drawLine(canvas->screenBufferIndex+1, 0, canvas->screenBufferIndex+1, getHeight());
-
-
-
-
-    //g.setColour(Colours::red); // draw oldest drawn sample position
-    //g.drawLine(canvas->lastScreenBufferIndex, 0, canvas->lastScreenBufferIndex, getHeight()-channelOverlap);
-
     int center = getHeight()/2;
 
     if (isSelected)
@@ -909,110 +811,45 @@ void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
     g.setColour(Colour(40,40,40));
     g.drawLine(0, getHeight()/2, getWidth(), getHeight()/2);
 
-    int stepSize = 1;
-    int from = 0; // for vertical line drawing in the LFP data
-    int to = 0;
-
-    //for (int i = 0; i < getWidth()-stepSize; i += stepSize) // redraw entire display
-    int ifrom = canvas->lastScreenBufferIndex - 3; // need to start drawing a bit before the actual redraw windowfor the interpolated line to join correctly
+    const int width = getWidth() - canvas->leftmargin;
+    const float scale = channelHeightFloat/range;
 
-    if (ifrom < 0)
-        ifrom = 0;
+    // confidence band (mean +/- 1.96 SEM)
+    Path band;
 
-    int ito = canvas->screenBufferIndex - 1;
-
-    if (fullredraw)
+    for (int i = 0; i < width; i++)
     {
-        ifrom = 0; //canvas->leftmargin;
-        ito = getWidth()-stepSize;
-        fullredraw = false;
+        float y = -(canvas->getYCoord(chan, i) + canvas->getInterval(chan, i))*scale + center;
+
+        if (i == 0)
+            band.startNewSubPath(i, y);
+        else
+            band.lineTo(i, y);
     }
 
-    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
+    for (int i = width-1; i >= 0; i--)
     {
+        band.lineTo(i, -(canvas->getYCoord(chan, i) - canvas->getInterval(chan, i))*scale + center);
+    }
 
-        // draw event markers
-        int rawEventState = canvas->getYCoord(canvas->getNumChannels(), i);// get last channel+1 in buffer (represents events)
-        for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
-        {
-            if (display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
-            {
-                if (rawEventState & (1 << ev_ch))    // events are  representet by a bit code, so we have to extract the individual bits with a mask
-                {
-                    g.setColour(display->channelColours[ev_ch*2]); // get color from lfp color scheme
-                    g.setOpacity(0.35f);
-                    g.drawLine(i, center-channelHeight/2 , i, center+channelHeight/2);
-                }
-            }
-        }
+    band.closeSubPath();
 
-        //std::cout << "e " << canvas->getYCoord(canvas->getNumChannels()-1, i) << std::endl;
+    g.setColour(lineColour.withAlpha(0.3f));
+    g.fillPath(band);
 
-        g.setColour(lineColour);
-        g.setOpacity(1);
+    // mean
+    g.setColour(lineColour);
 
-        // drawLine makes for ok anti-aliased plots, but is pretty slow
+    for (int i = 0; i < width-1; i++)
+    {
         g.drawLine(i,
-                   (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2,
-                   i+stepSize,
-                   (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2);
-
-        if (false) // switched back to line drawing now that we only draw partial updates
-        {
-
-            // // pixel wise line plot has no anti-aliasing, but runs much faster
-            double a = (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2;
-            double b = (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2;
-
-            if (a<b)
-            {
-                from = (a);
-                to = (b);
-            }
-            else
-            {
-                from = (b);
-                to = (a);
-            }
-
-            if ((to-from) < 40)  // if there is too much vertical range in one pixel, don't draw the full line for speed reasons
-            {
-                for (int j = from; j <= to; j += 1)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else if ((to-from) < 100)
-            {
-                for (int j = from; j <= to; j += 2)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else
-            {
-                g.setPixel(i,to);
-                g.setPixel(i,from);
-            }
-
-        }
-
+                   -canvas->getYCoord(chan, i)*scale + center,
+                   i+1,
+                   -canvas->getYCoord(chan, i+1)*scale + center);
     }
 
-    // g.setColour(lineColour.withAlpha(0.7f)); // alpha on seems to decrease draw speed
-    // g.setFont(channelFont);
-    //  g.setFont(channelHeightFloat*0.6);
-
-    // g.drawText(String(chan+1), 10, center-channelHeight/2, 200, channelHeight, Justification::left, false);
-
-
 }
 
-
-
-
-
-
 void LfpTriggeredAverageChannelDisplay::setRange(float r)
 {
     range = r;
@@ -1143,6 +980,8 @@ void LfpTriggeredAverageEventInterface::buttonClicked(Button* button)
         display->setEventDisplayState(channelNumber, true);
     }
 
+    canvas->updateTriggerChannels();
+
     repaint();
 
 }
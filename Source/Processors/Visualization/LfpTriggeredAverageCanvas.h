@@ -37,14 +37,20 @@ class LfpTriggeredAverageEventInterface;
 
 /**
 
-  Displays multiple channels of continuous data.
+  Displays the trigger-aligned average of multiple channels of continuous data.
 
-  @see LfpTriggeredAverageNode, LfpTriggeredAverageDisplayEditor
+  Each channel shows the mean across trials, with a shaded band marking the
+  95% confidence interval of the mean. The trigger is at the centre of the
+  window; the timebase selects the total window length. The buttons at the
+  bottom choose which TTL channels trigger a trial.
+
+  @see LfpTriggeredAverageNode, LfpTriggeredAverageEditor
 
 */
 
 class LfpTriggeredAverageCanvas : public Visualizer,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public Button::Listener
 
 {
 public:
@@ -71,39 +77,43 @@ public:
 
     int getNumChannels();
 
-    float getXCoord(int chan, int samp);
-    float getYCoord(int chan, int samp);
+    /** Returns the mean for a channel at a given pixel (relative to the left margin). */
+    float getYCoord(int chan, int x);
 
-    int screenBufferIndex;
-    int lastScreenBufferIndex;
+    /** Returns the half-width of the confidence band at a given pixel. */
+    float getInterval(int chan, int x);
 
     void comboBoxChanged(ComboBox* cb);
 
+    /** Handles the "clear" button. */
+    void buttonClicked(Button* button);
+
+    /** Sends the trigger channels selected in the display to the processor. */
+    void updateTriggerChannels();
+
     void saveVisualizerParameters(XmlElement* xml);
 
     void loadVisualizerParameters(XmlElement* xml);
 
-    //void scrollBarMoved(ScrollBar *scrollBarThatHasMoved, double newRangeStart);
-
     bool fullredraw; // used to indicate that a full redraw is required. is set false after each full redraw, there is a similar switch for ach ch display;
     static const int leftmargin=50; // left margin for lfp plots (so the ch number text doesnt overlap)
 
 private:
 
+    /** Maps a pixel to a sample index in the averaging window. */
+    int getSampleIndex(int x);
+
     float sampleRate;
     float timebase;
-    float displayGain;
-    float timeOffset;
-    //int spread ; // vertical spacing between channels
-
-    static const int MAX_N_CHAN = 256;  // maximum number of channels
-    static const int MAX_N_SAMP = 5000; // maximum display size in pixels
-    //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
 
     LfpTriggeredAverageNode* processor;
-    AudioSampleBuffer* displayBuffer;
-    AudioSampleBuffer* screenBuffer;
-    MidiBuffer* eventBuffer;
+
+    /** Copies of the processor's average, updated when new trials arrive. */
+    AudioSampleBuffer meanBuffer;
+    AudioSampleBuffer intervalBuffer;
+
+    int64 lastTotalTrials;
+    int numTrials;
 
     ScopedPointer<LfpTriggeredAverageTimescale> timescale;
     ScopedPointer<LfpTriggeredAverageDisplay> display;
@@ -113,18 +123,14 @@ private:
     ScopedPointer<ComboBox> rangeSelection;
     ScopedPointer<ComboBox> spreadSelection;
 
+    ScopedPointer<UtilityButton> clearButton;
+
     StringArray voltageRanges;
     StringArray timebases;
     StringArray spreads; // option for vertical spacing between channels
 
     OwnedArray<LfpTriggeredAverageEventInterface> LfpTriggeredAverageEventInterfaces;
 
-    void refreshScreenBuffer();
-    void updateScreenBuffer();
-
-    int displayBufferIndex;
-    int displayBufferSize;
-
     int scrollBarThickness;
 
     int nChans;
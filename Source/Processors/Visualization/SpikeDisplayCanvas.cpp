@@ -22,10 +22,11 @@
 */
 
 #include "SpikeDisplayCanvas.h"
+#include "../SpikeSorter.h"
 
 
 SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
-    processor(n), newSpike(false)
+    processor(n), newSpike(false), densityDecay(5.0f)
 {
 
     viewport = new Viewport();
@@ -49,6 +50,23 @@ SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
 	lockThresholdsButton->setClickingTogglesState(true);
 	addAndMakeVisible(lockThresholdsButton);
 
+    densityButton = new UtilityButton("Density", Font("Small Text", 13, Font::plain));
+    densityButton->setRadius(3.0f);
+    densityButton->addListener(this);
+    densityButton->setClickingTogglesState(true);
+    addAndMakeVisible(densityButton);
+
+    decayButton = new UtilityButton("decay 5 s", Font("Small Text", 13, Font::plain));
+    decayButton->setRadius(3.0f);
+    decayButton->addListener(this);
+    addAndMakeVisible(decayButton);
+
+    pcaButton = new UtilityButton("PCA", Font("Small Text", 13, Font::plain));
+    pcaButton->setRadius(3.0f);
+    pcaButton->addListener(this);
+    pcaButton->setClickingTogglesState(true);
+    addAndMakeVisible(pcaButton);
+
     addAndMakeVisible(viewport);
 
     setWantsKeyboardFocus(true);
@@ -113,6 +131,11 @@ void SpikeDisplayCanvas::resized()
 
 	lockThresholdsButton->setBounds(130, getHeight()-40, 130,20);
 
+    densityButton->setBounds(280, getHeight()-40, 80,20);
+    decayButton->setBounds(370, getHeight()-40, 90,20);
+
+    pcaButton->setBounds(480, getHeight()-40, 60,20);
+
 }
 
 void SpikeDisplayCanvas::paint(Graphics& g)
@@ -137,6 +160,42 @@ void SpikeDisplayCanvas::processSpikeEvents()
 
 }
 
+static SpikeSorter* findSpikeSorter(GenericProcessor* p)
+{
+    while (p != nullptr)
+    {
+        SpikeSorter* sorter = dynamic_cast<SpikeSorter*>(p);
+
+        if (sorter != nullptr)
+            return sorter;
+
+        p = p->getSourceNode();
+    }
+
+    return nullptr;
+}
+
+void SpikeDisplayCanvas::addSortingTemplate(const SpikeObject& s)
+{
+    SpikeSorter* sorter = findSpikeSorter(processor->getSourceNode());
+
+    if (sorter == nullptr)
+    {
+        std::cout << "No Spike Sorter upstream of the Spike Viewer." << std::endl;
+        return;
+    }
+
+    sorter->addTemplate(s);
+}
+
+void SpikeDisplayCanvas::clearSortingTemplates(int electrodeNum)
+{
+    SpikeSorter* sorter = findSpikeSorter(processor->getSourceNode());
+
+    if (sorter != nullptr)
+        sorter->clearTemplates(electrodeNum);
+}
+
 bool SpikeDisplayCanvas::keyPressed(const KeyPress& key)
 {
 
@@ -165,6 +224,46 @@ void SpikeDisplayCanvas::buttonClicked(Button* button)
 	{
 		thresholdCoordinator->setLockThresholds(button->getToggleState());
 	}
+    else if (button == densityButton)
+    {
+        spikeDisplay->setDensityMode(button->getToggleState());
+    }
+    else if (button == decayButton)
+    {
+        // cycle through half-lives, ending with no decay
+        float halfLife;
+        String label;
+
+        if (densityDecay == 1.0f)
+        {
+            halfLife = 5.0f;
+            label = "decay 5 s";
+        }
+        else if (densityDecay == 5.0f)
+        {
+            halfLife = 30.0f;
+            label = "decay 30 s";
+        }
+        else if (densityDecay == 30.0f)
+        {
+            halfLife = 0.0f;
+            label = "no decay";
+        }
+        else
+        {
+            halfLife = 1.0f;
+            label = "decay 1 s";
+        }
+
+        densityDecay = halfLife;
+
+        decayButton->setLabel(label);
+        spikeDisplay->setDensityDecay(halfLife);
+    }
+    else if (button == pcaButton)
+    {
+        spikeDisplay->setPcaMode(button->getToggleState());
+    }
 }
 
 
@@ -172,7 +271,8 @@ void SpikeDisplayCanvas::buttonClicked(Button* button)
 // ----------------------------------------------------------------
 
 SpikeDisplay::SpikeDisplay(SpikeDisplayCanvas* sdc, Viewport* v) :
-	canvas(sdc), viewport(v), thresholdCoordinator(nullptr)
+	canvas(sdc), viewport(v), thresholdCoordinator(nullptr),
+    densityMode(false), densityDecay(5.0f), pcaMode(false)
 {
 
     totalHeight = 1000;
@@ -216,6 +316,10 @@ SpikePlot* SpikeDisplay::addSpikePlot(int numChannels, int electrodeNum, String
 		spikePlot->registerThresholdCoordinator(thresholdCoordinator);
 	}
 
+    spikePlot->setDensityDecay(densityDecay);
+    spikePlot->setDensityMode(densityMode);
+    spikePlot->setPcaMode(pcaMode);
+
     return spikePlot;
 }
 
@@ -349,11 +453,35 @@ void SpikeDisplay::registerThresholdCoordinator(SpikeThresholdCoordinator *stc)
 	}
 }
 
+void SpikeDisplay::setDensityMode(bool t)
+{
+    densityMode = t;
+
+    for (int i = 0; i < spikePlots.size(); i++)
+        spikePlots[i]->setDensityMode(t);
+}
+
+void SpikeDisplay::setDensityDecay(float halfLife)
+{
+    densityDecay = halfLife;
+
+    for (int i = 0; i < spikePlots.size(); i++)
+        spikePlots[i]->setDensityDecay(halfLife);
+}
+
+void SpikeDisplay::setPcaMode(bool t)
+{
+    pcaMode = t;
+
+    for (int i = 0; i < spikePlots.size(); i++)
+        spikePlots[i]->setPcaMode(t);
+}
+
 // ----------------------------------------------------------------
 
 SpikePlot::SpikePlot(SpikeDisplayCanvas* sdc, int elecNum, int p, String name_) :
     canvas(sdc), isSelected(false), electrodeNumber(elecNum),  plotType(p),
-	limitsChanged(true), name(name_)
+	limitsChanged(true), pcaMode(false), name(name_)
 
 {
 
@@ -400,6 +528,9 @@ SpikePlot::SpikePlot(SpikeDisplayCanvas* sdc, int elecNum, int p, String name_)
 
     initAxes();
 
+    if (nProjAx > 0)
+        pca = new IncrementalPCA(nChannels, nChannels);
+
     for (int i = 0; i < nChannels; i++)
     {
         UtilityButton* rangeButton = new UtilityButton("250", Font("Small Text", 10, Font::plain));
@@ -451,8 +582,23 @@ void SpikePlot::processSpikeObject(const SpikeObject& s)
         for (int i = 0; i < nWaveAx; i++)
             wAxes[i]->updateSpikeData(s);
 
-        for (int i = 0; i < nProjAx; i++)
-            pAxes[i]->updateSpikeData(s);
+        if (nProjAx > 0)
+        {
+            // one feature vector is shared by all projections
+            float features[MAX_N_CHAN];
+            bool valid;
+
+            if (pcaMode)
+                valid = pca->projectSpike(s, features);
+            else
+                valid = ProjectionAxes::getPeakFeatures(s, features);
+
+            if (valid)
+            {
+                for (int i = 0; i < nProjAx; i++)
+                    pAxes[i]->updateFeatures(features);
+            }
+        }
     // }
 
     //     if (aboveThreshold && isRecording)
@@ -463,6 +609,67 @@ void SpikePlot::processSpikeObject(const SpikeObject& s)
 
 }
 
+void SpikePlot::accumulateSpikeObject(const SpikeObject& s)
+{
+    for (int i = 0; i < nWaveAx; i++)
+    {
+        if (wAxes[i]->getDensityMode())
+            wAxes[i]->accumulateSpike(s);
+    }
+
+    if (pcaMode)
+        pca->addSpike(s);
+}
+
+void SpikePlot::setDensityMode(bool t)
+{
+    for (int i = 0; i < nWaveAx; i++)
+        wAxes[i]->setDensityMode(t);
+}
+
+void SpikePlot::setDensityDecay(float halfLife)
+{
+    for (int i = 0; i < nWaveAx; i++)
+        wAxes[i]->setDensityDecay(halfLife);
+}
+
+void SpikePlot::addSortingTemplate(const SpikeObject& s)
+{
+    canvas->addSortingTemplate(s);
+}
+
+void SpikePlot::clearSortingTemplates()
+{
+    canvas->clearSortingTemplates(electrodeNumber);
+}
+
+void SpikePlot::setPcaMode(bool t)
+{
+    if (pca == nullptr || t == pcaMode)
+        return;
+
+    pcaMode = t;
+
+    // the eigendecomposition runs here, on the message thread
+    if (pcaMode)
+        startTimer(1000);
+    else
+        stopTimer();
+
+    for (int i = 0; i < nProjAx; i++)
+        pAxes[i]->setCentred(pcaMode);
+}
+
+void SpikePlot::timerCallback()
+{
+    // points drawn in the old basis would no longer line up
+    if (pca->updateComponents())
+    {
+        for (int i = 0; i < nProjAx; i++)
+            pAxes[i]->clear();
+    }
+}
+
 void SpikePlot::select()
 {
     isSelected = true;
@@ -692,6 +899,10 @@ WaveAxes::WaveAxes(int channel) : GenericAxes(channel),
     displayThresholdLevel(0.0f),  
     detectorThresholdLevel(0.0f),
     spikesReceivedSinceLastRedraw(0),
+    densityMode(false),
+    densityHalfLife(5.0f),
+    densityColumns(0),
+    lastDecayTime(0.0),
     spikeIndex(0),
     bufferSize(5),
     range(250.0f),
@@ -714,6 +925,8 @@ WaveAxes::WaveAxes(int channel) : GenericAxes(channel),
 
         spikeBuffer.add(so);
     }
+
+    density.calloc(densityRows * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
 }
 
 void WaveAxes::setRange(float r)
@@ -721,6 +934,10 @@ void WaveAxes::setRange(float r)
 
     //std::cout << "Setting range to " << r << std::endl;
 
+    // the histogram rows are in display coordinates
+    if (r != range)
+        clearDensity();
+
     range = r;
 
     repaint();
@@ -733,6 +950,9 @@ void WaveAxes::paint(Graphics& g)
 
    // int chan = 0;
 
+    if (densityMode)
+        drawDensity(g);
+
     // draw the grid lines for the waveforms
 
     if (drawGrid)
@@ -749,18 +969,26 @@ void WaveAxes::paint(Graphics& g)
     }
 
 
-     for (int spikeNum = 0; spikeNum < bufferSize; spikeNum++)
+     for (int spikeNum = 0; spikeNum < bufferSize && !densityMode; spikeNum++)
      {
 
          if (spikeNum != spikeIndex)
          {
-             g.setColour(Colours::grey);
+             if (spikeBuffer[spikeNum].sortedId > 0)
+                 g.setColour(getUnitColour(spikeBuffer[spikeNum].sortedId).withAlpha(0.6f));
+             else
+                 g.setColour(Colours::grey);
+
              plotSpike(spikeBuffer[spikeNum], g);
          }
 
      }
 
-    g.setColour(Colours::white);
+    if (spikeBuffer[spikeIndex].sortedId > 0)
+        g.setColour(getUnitColour(spikeBuffer[spikeIndex].sortedId));
+    else
+        g.setColour(Colours::white);
+
     plotSpike(spikeBuffer[spikeIndex], g);
 
 
@@ -807,6 +1035,49 @@ void WaveAxes::plotSpike(const SpikeObject& s, Graphics& g)
 
 }
 
+Colour WaveAxes::getUnitColour(int unit)
+{
+    static const Colour unitColours[] = { Colours::yellow, Colours::cyan, Colours::magenta,
+                                          Colours::lime, Colours::orange, Colours::deepskyblue
+                                        };
+
+    return unitColours[(unit - 1) % 6];
+}
+
+float WaveAxes::getSpikeY(const SpikeObject& s, int sample)
+{
+    // same scaling as plotSpike()
+    float h = getHeight();
+
+    return h/2 + float(s.data[40*type + sample]-32768)/float(*s.gain)*1000.0f / range * h;
+}
+
+int WaveAxes::findNearestSpike(int x, int y)
+{
+    int nearest = -1;
+    float nearestDistance = 0.0f;
+
+    for (int spikeNum = 0; spikeNum < spikeBuffer.size(); spikeNum++)
+    {
+        const SpikeObject& s = spikeBuffer.getReference(spikeNum);
+
+        if (*s.gain == 0 || s.nSamples == 0)
+            continue;
+
+        int sample = jlimit(0, s.nSamples - 1, int(float(x) / getWidth() * s.nSamples));
+
+        float distance = fabsf(getSpikeY(s, sample) - float(y));
+
+        if (nearest < 0 || distance < nearestDistance)
+        {
+            nearest = spikeNum;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
+}
+
 void WaveAxes::drawThresholdSlider(Graphics& g)
 {
 
@@ -867,6 +1138,140 @@ bool WaveAxes::updateSpikeData(const SpikeObject& s)
 
 }
 
+void WaveAxes::accumulateSpike(const SpikeObject& s)
+{
+    if (*s.gain == 0 || s.nSamples < 2 || s.nSamples > MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES)
+        return;
+
+    // called from the audio thread; if the display is decaying or clearing
+    // the histogram, this spike is left out of it
+    const ScopedTryLock lock(densityLock);
+
+    if (! lock.isLocked())
+        return;
+
+    if (s.nSamples != densityColumns)
+    {
+        clearDensity();
+        densityColumns = s.nSamples;
+    }
+
+    int sampIdx = s.nSamples*type;
+
+    int previousRow = 0;
+
+    for (int i = 0; i < s.nSamples; i++)
+    {
+        // same mapping as plotSpike()
+        float y = 0.5f + float(s.data[sampIdx+i]-32768)/float(*s.gain)*1000.0f / range;
+        int row = (int) floor(y * densityRows);
+
+        // fill the rows between consecutive samples, so steep edges stay connected
+        int first = row;
+        int last = row;
+
+        if (i > 0 && row > previousRow + 1)
+            first = previousRow + 1;
+        else if (i > 0 && row < previousRow - 1)
+            last = previousRow - 1;
+
+        first = jmax(first, 0);
+        last = jmin(last, densityRows - 1);
+
+        for (int r = first; r <= last; r++)
+            density[r * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES + i] += 1.0f;
+
+        previousRow = row;
+    }
+
+    gotFirstSpike = true;
+}
+
+void WaveAxes::drawDensity(Graphics& g)
+{
+    const ScopedLock lock(densityLock);
+
+    if (densityColumns == 0)
+        return;
+
+    const double now = Time::getMillisecondCounterHiRes();
+
+    float decay = 1.0f;
+
+    if (densityHalfLife > 0 && lastDecayTime > 0)
+        decay = (float) pow(0.5, (now - lastDecayTime) / 1000.0 / densityHalfLife);
+
+    lastDecayTime = now;
+
+    if (densityImage.getWidth() != densityColumns)
+        densityImage = Image(Image::RGB, densityColumns, densityRows, true);
+
+    float maxCount = 0.0f;
+
+    for (int r = 0; r < densityRows; r++)
+    {
+        float* row = density + r * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES;
+
+        for (int i = 0; i < densityColumns; i++)
+        {
+            row[i] *= decay;
+            maxCount = jmax(maxCount, row[i]);
+        }
+    }
+
+    if (maxCount < 1.0f)
+        maxCount = 1.0f;
+
+    const float logMax = log(1.0f + maxCount);
+
+    Image::BitmapData pixels(densityImage, Image::BitmapData::writeOnly);
+
+    for (int r = 0; r < densityRows; r++)
+    {
+        const float* row = density + r * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES;
+
+        for (int i = 0; i < densityColumns; i++)
+        {
+            // log scale, black -> red -> yellow -> white
+            const float t = log(1.0f + row[i]) / logMax;
+
+            pixels.setPixelColour(i, r, Colour::fromFloatRGBA(jlimit(0.0f, 1.0f, 3.0f*t),
+                                                              jlimit(0.0f, 1.0f, 3.0f*t - 1.0f),
+                                                              jlimit(0.0f, 1.0f, 3.0f*t - 2.0f),
+                                                              1.0f));
+        }
+    }
+
+    g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+    g.drawImage(densityImage, 0, 0, getWidth(), getHeight(),
+                0, 0, densityColumns, densityRows);
+}
+
+void WaveAxes::clearDensity()
+{
+    const ScopedLock lock(densityLock);
+
+    density.clear(densityRows * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES);
+}
+
+void WaveAxes::setDensityMode(bool t)
+{
+    if (t && !densityMode)
+    {
+        clearDensity();
+        lastDecayTime = 0.0;
+    }
+
+    densityMode = t;
+
+    repaint();
+}
+
+void WaveAxes::setDensityDecay(float halfLife)
+{
+    densityHalfLife = halfLife;
+}
+
 bool WaveAxes::checkThreshold(const SpikeObject& s)
 {
     int sampIdx = 40*type;
@@ -900,6 +1305,8 @@ void WaveAxes::clear()
         spikeBuffer.add(so);
     }
 
+    clearDensity();
+
     repaint();
 }
 
@@ -944,6 +1351,30 @@ void WaveAxes::mouseMove(const MouseEvent& event)
 
 void WaveAxes::mouseDown(const MouseEvent& event)
 {
+    // shift-click turns the nearest waveform into a unit template,
+    // alt-click removes this electrode's templates
+    if (event.mods.isShiftDown() || event.mods.isAltDown())
+    {
+        SpikePlot* plot = findParentComponentOfClass<SpikePlot>();
+
+        if (plot == nullptr)
+            return;
+
+        if (event.mods.isAltDown())
+        {
+            plot->clearSortingTemplates();
+        }
+        else
+        {
+            int spikeNum = findNearestSpike(event.x, event.y);
+
+            if (spikeNum > -1)
+                plot->addSortingTemplate(spikeBuffer[spikeNum]);
+        }
+
+        return;
+    }
+
     // if (isOverThresholdSlider)
     // {
     //     cursorType = MouseCursor::DraggingHandCursor;
@@ -1017,8 +1448,8 @@ void WaveAxes::setDisplaythreshold(float threshold)
 
 // --------------------------------------------------
 
-ProjectionAxes::ProjectionAxes(int projectionNum) : GenericAxes(projectionNum), imageDim(500),
-    rangeX(250), rangeY(250), spikesReceivedSinceLastRedraw(0)
+ProjectionAxes::ProjectionAxes(int projectionNum) : GenericAxes(projectionNum), centred(false),
+    imageDim(500), rangeX(250), rangeY(250), spikesReceivedSinceLastRedraw(0)
 {
     projectionImage = Image(Image::RGB, imageDim, imageDim, true);
 
@@ -1042,14 +1473,30 @@ void ProjectionAxes::setRange(float x, float y)
     repaint();
 }
 
+void ProjectionAxes::setCentred(bool t)
+{
+    centred = t;
+
+    clear();
+}
+
 void ProjectionAxes::paint(Graphics& g)
 {
     //g.setColour(Colours::orange);
     //g.fillRect(5,5,getWidth()-5, getHeight()-5);
 
-    g.drawImage(projectionImage,
-                0, 0, getWidth(), getHeight(),
-                0, imageDim-rangeY, rangeX, rangeY);
+    if (centred)
+    {
+        g.drawImage(projectionImage,
+                    0, 0, getWidth(), getHeight(),
+                    (imageDim-rangeX)/2, (imageDim-rangeY)/2, rangeX, rangeY);
+    }
+    else
+    {
+        g.drawImage(projectionImage,
+                    0, 0, getWidth(), getHeight(),
+                    0, imageDim-rangeY, rangeX, rangeY);
+    }
 }
 
 bool ProjectionAxes::updateSpikeData(const SpikeObject& s)
@@ -1059,52 +1506,71 @@ bool ProjectionAxes::updateSpikeData(const SpikeObject& s)
         gotFirstSpike = true;
     }
 
-    int idx1, idx2;
-    calcWaveformPeakIdx(s, ampDim1, ampDim2, &idx1, &idx2);
+    float features[MAX_NUMBER_OF_SPIKE_CHANNELS];
+
+    if (!getPeakFeatures(s, features))
+        return false;
 
     // add peaks to image
 
-    updateProjectionImage(s.data[idx1], s.data[idx2], *s.gain);
+    updateFeatures(features);
 
     return true;
 }
 
-void ProjectionAxes::updateProjectionImage(uint16_t x, uint16_t y, uint16_t gain)
+void ProjectionAxes::updateFeatures(const float* features)
+{
+    if (!gotFirstSpike)
+    {
+        gotFirstSpike = true;
+    }
+
+    updateProjectionImage(features[ampDim1], features[ampDim2]);
+}
+
+void ProjectionAxes::updateProjectionImage(float x, float y)
 {
     Graphics g(projectionImage);
 
-    // h/2 + float(s.data[sampIdx]-32768)/float(*s.gain)*1000.0f / range * h;
+    // x and y are in microvolts
+    float xf, yf;
 
-    if (gain != 0)
+    if (centred)
     {
-        float xf = float(x-32768)/float(gain)*1000.0f; // in microvolts
-        float yf = float(imageDim) - float(y-32768)/float(gain)*1000.0f; // in microvolts
-
-        g.setColour(Colours::white);
-        g.fillEllipse(xf,yf,2.0f,2.0f);
+        xf = float(imageDim/2) + x;
+        yf = float(imageDim/2) - y;
+    }
+    else
+    {
+        xf = x;
+        yf = float(imageDim) - y;
     }
 
+    g.setColour(Colours::white);
+    g.fillEllipse(xf,yf,2.0f,2.0f);
+
 }
 
-void ProjectionAxes::calcWaveformPeakIdx(const SpikeObject& s, int d1, int d2, int* idx1, int* idx2)
+bool ProjectionAxes::getPeakFeatures(const SpikeObject& s, float* features)
 {
+    if (s.nChannels > MAX_NUMBER_OF_SPIKE_CHANNELS)
+        return false;
 
-    int max1 = -1*pow(2.0,15);
-    int max2 = max1;
-
-    for (int i = 0; i < s.nSamples; i++)
+    for (int c = 0; c < s.nChannels; c++)
     {
-        if (s.data[d1*s.nSamples + i] > max1)
-        {
-            *idx1 = d1*s.nSamples+i;
-            max1 = s.data[*idx1];
-        }
-        if (s.data[d2*s.nSamples+i] > max2)
-        {
-            *idx2 = d2*s.nSamples+i;
-            max2 = s.data[*idx2];
-        }
+        if (s.gain[c] == 0)
+            return false;
+
+        const uint16_t* data = s.data + c*s.nSamples;
+        uint16_t peak = 0;
+
+        for (int i = 0; i < s.nSamples; i++)
+            peak = jmax(peak, data[i]);
+
+        features[c] = float(int(peak) - 32768) / float(s.gain[c]) * 1000.0f;
     }
+
+    return true;
 }
 
 
@@ -28,6 +28,7 @@
 
 #include "../SpikeDisplayNode.h"
 #include "SpikeObject.h"
+#include "IncrementalPCA.h"
 
 #include "Visualizer.h"
 #include <vector>
@@ -64,6 +65,9 @@ class SpikeThresholdCoordinator;
 
   Displays spike waveforms and projections.
 
+  The "Density" button switches the waveform axes from drawing the last
+  few spikes to a persistent waveform density image (see WaveAxes).
+
   @see SpikeDisplayNode, SpikeDisplayEditor, Visualizer
 
 */
@@ -99,6 +103,12 @@ public:
 
     void startRecording() { } // unused
     void stopRecording() { } // unused
+
+    /** Adds a unit template to the nearest SpikeSorter upstream, if there is one. */
+    void addSortingTemplate(const SpikeObject& s);
+
+    /** Removes the unit templates of an electrode from the nearest SpikeSorter upstream. */
+    void clearSortingTemplates(int electrodeNum);
     
     SpikeDisplayNode* processor;
 
@@ -117,6 +127,12 @@ private:
 	ScopedPointer<SpikeThresholdCoordinator> thresholdCoordinator;
 	ScopedPointer<UtilityButton> lockThresholdsButton;
 
+    ScopedPointer<UtilityButton> densityButton;
+    ScopedPointer<UtilityButton> decayButton;
+    ScopedPointer<UtilityButton> pcaButton;
+
+    float densityDecay;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeDisplayCanvas);
 
 };
@@ -146,6 +162,15 @@ public:
 
 	void registerThresholdCoordinator(SpikeThresholdCoordinator *stc);
 
+    /** Switches all waveform axes between line and density display. */
+    void setDensityMode(bool t);
+
+    /** Sets the half-life (in seconds) of the waveform density; 0 means no decay. */
+    void setDensityDecay(float halfLife);
+
+    /** Switches all projection axes between channel peaks and principal components. */
+    void setPcaMode(bool t);
+
 private:
 
     //void computeColumnLayout();
@@ -166,6 +191,10 @@ private:
 
 	SpikeThresholdCoordinator *thresholdCoordinator;
 
+    bool densityMode;
+    float densityDecay;
+    bool pcaMode;
+
 };
 
 /**
@@ -176,7 +205,7 @@ private:
 
 */
 
-class SpikePlot : public Component, Button::Listener
+class SpikePlot : public Component, Button::Listener, Timer
 {
 public:
     SpikePlot(SpikeDisplayCanvas*, int elecNum, int plotType, String name_);
@@ -190,6 +219,25 @@ public:
 
     void processSpikeObject(const SpikeObject& s);
 
+    /** Adds a spike to the waveform density of each channel; called for every
+        spike, not just the ones passed to processSpikeObject(). */
+    void accumulateSpikeObject(const SpikeObject& s);
+
+    void setDensityMode(bool t);
+    void setDensityDecay(float halfLife);
+
+    /** Turns a spike into a unit template (see SpikeDisplayCanvas::addSortingTemplate). */
+    void addSortingTemplate(const SpikeObject& s);
+
+    /** Removes all unit templates for this electrode. */
+    void clearSortingTemplates();
+
+    /** Plots the first principal components of the electrode's waveforms
+        instead of the channel peaks (stereotrodes and tetrodes only). */
+    void setPcaMode(bool t);
+
+    void timerCallback();
+
     SpikeDisplayCanvas* canvas;
 
     bool isSelected;
@@ -227,6 +275,10 @@ private:
 
     OwnedArray<ProjectionAxes> pAxes;
     OwnedArray<WaveAxes> wAxes;
+
+    ScopedPointer<IncrementalPCA> pca;
+    bool pcaMode;
+
     OwnedArray<UtilityButton> rangeButtons;
     Array<float> ranges;
 
@@ -294,6 +346,14 @@ protected:
 
   Class for drawing spike waveforms.
 
+  By default, the last few spikes are drawn as lines. In density mode,
+  every spike is added to a histogram of amplitude (128 rows spanning the
+  current range) by sample, which is drawn as a single image with the
+  most recent spike on top. The cost of painting is then the same at any
+  firing rate, and overlapping clusters of waveforms become visible. The
+  counts decay with a configurable half-life, and are cleared when the
+  range changes.
+
 */
 
 class WaveAxes : public GenericAxes
@@ -325,6 +385,22 @@ public:
     float getDisplayThreshold();
     void setDetectorThreshold(float);
 
+    /** Adds a spike to the density histogram. */
+    void accumulateSpike(const SpikeObject& s);
+
+    /** Switches between drawing the last few spikes and the waveform density. */
+    void setDensityMode(bool t);
+    bool getDensityMode()
+    {
+        return densityMode;
+    }
+
+    /** Sets the half-life (in seconds) of the density counts; 0 means no decay. */
+    void setDensityDecay(float halfLife);
+
+    /** Returns the colour used to draw spikes assigned to a sorted unit. */
+    static Colour getUnitColour(int unit);
+
     //MouseCursor getMouseCursor();
 
 	//For locking the thresholds
@@ -346,8 +422,33 @@ private:
 
     void drawThresholdSlider(Graphics& g);
 
+    /** Returns the y coordinate of a spike at a given sample on this channel. */
+    float getSpikeY(const SpikeObject& s, int sample);
+
+    /** Returns the index of the buffered spike passing closest to a point, or -1. */
+    int findNearestSpike(int x, int y);
+
+    /** Applies the decay, then renders the histogram into densityImage. */
+    void drawDensity(Graphics& g);
+
+    void clearDensity();
+
     int spikesReceivedSinceLastRedraw;
 
+    enum { densityRows = 128 };
+
+    bool densityMode;
+    float densityHalfLife;
+
+    /** Held by the audio thread while it adds a spike (it only tries), and by
+        the message thread while it decays, draws or clears the histogram. */
+    CriticalSection densityLock;
+
+    HeapBlock<float> density;
+    int densityColumns;
+    Image densityImage;
+    double lastDecayTime;
+
     Font font;
 
     Array<SpikeObject> spikeBuffer;
@@ -383,22 +484,33 @@ public:
 
     bool updateSpikeData(const SpikeObject& s);
 
+    /** Plots one point from a feature vector (in microvolts) holding one
+        value per channel or per principal component. */
+    void updateFeatures(const float* features);
+
     void paint(Graphics& g);
 
     void clear();
 
     void setRange(float, float);
 
+    /** Puts the origin in the middle of the plot, for signed features. */
+    void setCentred(bool t);
+
     static void n2ProjIdx(int i, int* p1, int* p2);
 
-private:
+    /** Fills features with the peak of each channel, in microvolts. Returns
+        false if the spike has no gain. */
+    static bool getPeakFeatures(const SpikeObject& s, float* features);
 
-    void updateProjectionImage(uint16_t, uint16_t, uint16_t);
+private:
 
-    void calcWaveformPeakIdx(const SpikeObject&, int, int, int*, int*);
+    void updateProjectionImage(float, float);
 
     int ampDim1, ampDim2;
 
+    bool centred;
+
     Image projectionImage;
 
     Colour pointColour;
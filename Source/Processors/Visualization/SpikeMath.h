@@ -0,0 +1,55 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKEMATH_H_6C1E8A53__
+#define __SPIKEMATH_H_6C1E8A53__
+
+/**
+
+  Vector helpers shared by the SpikeSorter and the IncrementalPCA.
+
+*/
+
+/** Dot product with four independent partial sums, which the compiler
+    turns into packed SSE multiply-adds. */
+inline float dotProduct(const float* a, const float* b, int n)
+{
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i+1] * b[i+1];
+        s2 += a[i+2] * b[i+2];
+        s3 += a[i+3] * b[i+3];
+    }
+
+    for (; i < n; i++)
+        s0 += a[i] * b[i];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+#endif  // __SPIKEMATH_H_6C1E8A53__
@@ -34,7 +34,14 @@ int packSpike(const SpikeObject* s, uint8_t* buffer, int bufferSize)
     // a pointer to a uint8_t buffer (which will hold the serialized SpikeObject,
     // and a integer indicating the bufferSize.
 
-    //int reqBytes = 1 + 4 + 2 + 2 + 2 + 2 * s->nChannels * s->nSamples + 2 * s->nChannels * 2;
+    const int reqBytes = 1 + 8 + 2 + 2 + 2 + 2 * s->nChannels * s->nSamples + 2 * s->nChannels * 2 + 2;
+
+    if (reqBytes > bufferSize)
+    {
+        std::cout << "Spike is larger than it should be. Size was: " << reqBytes
+                  << " Max size is: " << bufferSize << std::endl;
+        return 0;
+    }
 
     int idx = 0;
 
@@ -62,12 +69,8 @@ int packSpike(const SpikeObject* s, uint8_t* buffer, int bufferSize)
     memcpy(buffer+idx, &(s->threshold), s->nChannels * 2);
     idx += s->nChannels * 2;
 
-    if (idx >= MAX_SPIKE_BUFFER_LEN)
-    {
-        std::cout << "Spike is larger than it should be. Size was: " << idx
-                  << " Max size is: " << MAX_SPIKE_BUFFER_LEN << std::endl;
-
-    }
+    memcpy(buffer+idx, &(s->sortedId), 2);
+    idx += 2;
 
     //makeBufferValid(buffer, idx);
 
@@ -131,6 +134,13 @@ bool unpackSpike(SpikeObject* s, const uint8_t* buffer, int bufferSize)
     memcpy(&(s->threshold), buffer+idx, s->nChannels *2);
     idx += s->nChannels * 2;
 
+    if (idx + 2 <= bufferSize)
+        memcpy(&(s->sortedId), buffer+idx, 2);
+    else
+        s->sortedId = 0;
+
+    idx += 2;
+
     //if (idx >= bufferSize)
     //    std::cout << "Buffer Overrun! More data extracted than was given!" << std::endl;
 
@@ -225,6 +235,7 @@ void generateSimulatedSpike(SpikeObject* s, uint64_t timestamp, int noise)
     s->source = 0;
     s->nChannels = 4;
     s->nSamples = 32;
+    s->sortedId = 0;
     int idx=0;
 
     int waveType = rand()%2; // Pick one of the three predefined waveshapes to generate
@@ -259,6 +270,7 @@ void generateEmptySpike(SpikeObject* s, int nChannels)
     s->source = 0;
     s->nChannels = 4;
     s->nSamples = 32;
+    s->sortedId = 0;
 
     int idx = 0;
     for (int i=0; i<4; i++)
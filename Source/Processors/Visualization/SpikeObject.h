@@ -32,8 +32,9 @@
 #define MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES 60
 #define CHECK_BUFFER_VALIDITY true
 #define SPIKE_EVENT_CODE 4;
-#define MAX_SPIKE_BUFFER_LEN 512 // max length of spike buffer in bytes
-                                 // the true max calculated from the spike values below is actually 507
+#define MAX_SPIKE_BUFFER_LEN 516 // max length of spike buffer in bytes
+                                 // the true max calculated from the spike values below is 513,
+                                 // rounded up to 16-bit words plus the validity word
 
 #define SPIKE_BASE_CODE 100
 
@@ -47,7 +48,7 @@
 
   The buffer is LittleEndian (thank Intel) and the byte order is the same as the SpikeObject definition.
   IE. the first 2 bytes are the timestamp, the next two bytes are the source identifier, etc... with the last
-  set of bytes corresponding to the thresholds of the different channels.
+  two bytes holding the sorted unit ID. Buffers without the unit ID are still unpacked, with sortedId = 0.
 
   Finally the buffer will have an additional byte on the end that is used to check the integerity of the entire package.
   The way this works is the buffer is divivded up into a series of 16 bit unsigned integers. The sum of all these integers
@@ -67,10 +68,12 @@ struct SpikeObject
     uint16_t    data[MAX_NUMBER_OF_SPIKE_CHANNELS* MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES];
     uint16_t    gain[MAX_NUMBER_OF_SPIKE_CHANNELS];
     uint16_t    threshold[MAX_NUMBER_OF_SPIKE_CHANNELS];
+    uint16_t    sortedId; // unit assigned by a SpikeSorter; 0 if unsorted
 
 };
 
-/** Simple method for serializing a SpikeObject into a string of bytes, returns true is the packaged spike buffer is valid */
+/** Simple method for serializing a SpikeObject into a string of bytes, returns the number of bytes written,
+  or 0 (leaving the buffer untouched) if the spike does not fit into bufferLength bytes */
 int packSpike(const SpikeObject* s, uint8_t* buffer, int bufferLength);
 
 /** Simple method for deserializing a string of bytes into a Spike object, returns true is the provided spike buffer is valid */
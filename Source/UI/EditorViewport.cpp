@@ -53,6 +53,8 @@ EditorViewport::EditorViewport()
     signalChainManager = new SignalChainManager(this, editorArray,
                                                 signalChainArray);
 
+    settingsFileThread = new SettingsFileThread(this);
+
     upButton = new SignalChainScrollButton(UP);
     downButton = new SignalChainScrollButton(DOWN);
     leftButton = new EditorScrollButton(LEFT);
@@ -1258,14 +1260,13 @@ const String EditorViewport::saveState(File fileToUse)
     getControlPanel()->saveStateToXml(xml); // save the control panel settings
     getUIComponent()->saveStateToXml(xml);  // save the UI settings
 
-    if (! xml->writeToFile(currentFile, String::empty))
-        error = "Couldn't write to file ";
-    else
-        error = "Saved configuration as ";
+    // the file is written by the SettingsFileThread, which takes the xml;
+    // settingsFileSaved() reports whether that worked
+    settingsFileThread->save(xml, currentFile);
 
+    error = "Saving configuration as ";
     error += currentFile.getFileName();
-
-    delete xml;
+    error += "...";
 
     return error;
 }
@@ -1287,15 +1288,43 @@ const String EditorViewport::loadState(File fileToLoad)
     //     return "No configuration selected.";
     // }
 
+    if (settingsFileThread->isLoading())
+        return "Already loading a configuration.";
+
     currentFile = fileToLoad;
 
+    settingsFileThread->load(fileToLoad);
+
+    return "Loading " + fileToLoad.getFileName() + "...";
+}
+
+void EditorViewport::settingsFileLoaded(XmlElement* xml, const File& file)
+{
+    currentFile = file;
+
+    sendActionMessage(loadStateFromXml(xml));
+}
+
+void EditorViewport::settingsFileSaved(const File& file, bool succeeded)
+{
+    String message;
+
+    if (! succeeded)
+        message = "Couldn't write to file ";
+    else
+        message = "Saved configuration as ";
+
+    message += file.getFileName();
+
+    sendActionMessage(message);
+}
+
+const String EditorViewport::loadStateFromXml(XmlElement* xml)
+{
     std::cout << "Loading processor graph." << std::endl;
 
     Array<GenericProcessor*> splitPoints;
 
-    XmlDocument doc(currentFile);
-    XmlElement* xml = doc.getDocumentElement();
-
     if (xml == 0 || ! xml->hasTagName("SETTINGS"))
     {
         std::cout << "File not found." << std::endl;
@@ -1303,8 +1332,18 @@ const String EditorViewport::loadState(File fileToLoad)
         return "Not a valid file.";
     }
 
+    if (!canEdit)
+    {
+        delete xml;
+        return "Cannot load a configuration while acquisition is active.";
+    }
+
     clearSignalChain();
 
+    // only the new processor is updated as each one is added; the whole
+    // chain is updated once at the end
+    signalChainManager->setUpdatesDeferred(true);
+
     String description;// = " ";
     int loadOrder = 0;
 
@@ -1403,6 +1442,8 @@ const String EditorViewport::loadState(File fileToLoad)
         editorArray[i]->deselect();
     }
 
+    signalChainManager->setUpdatesDeferred(false);
+
     getProcessorGraph()->restoreParameters();
 
     getControlPanel()->loadStateFromXml(xml); // save the control panel settings
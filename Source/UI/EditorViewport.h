@@ -34,6 +34,7 @@
 #include "ControlPanel.h"
 #include "UIComponent.h"
 #include "DataViewport.h"
+#include "SettingsFileThread.h"
 
 class GenericEditor;
 class SignalChainTabButton;
@@ -64,7 +65,8 @@ class UIComponent;
 class EditorViewport  : public Component,
     public DragAndDropTarget,
     public AccessClass,
-    public Button::Listener
+    public Button::Listener,
+    public SettingsFileThread::Listener
 
 {
 public:
@@ -145,12 +147,24 @@ public:
         return signalChainArray;
     }
 
-    /** Save the current configuration as an XML file. */
+    /** Save the current configuration as an XML file. The file is written
+    in the background; whether that worked is sent as an action message. */
     const String saveState(File filename);
 
-    /** Load a saved configuration from an XML file. */
+    /** Load a saved configuration from an XML file. The file is parsed in the
+    background, and the signal chain is rebuilt when it is ready. */
     const String loadState(File filename);
 
+    /** Rebuilds the signal chain from a parsed configuration (message thread). */
+    const String loadStateFromXml(XmlElement* xml);
+
+    /** Called by the SettingsFileThread once a configuration has been parsed. */
+    void settingsFileLoaded(XmlElement* xml, const File& file);
+
+    /** Called by the SettingsFileThread once a configuration has been written,
+        or has failed to be. */
+    void settingsFileSaved(const File& file, bool succeeded);
+
     /** Converts information about a given editor to XML. */
     XmlElement* createNodeXml(GenericEditor*, int);
 
@@ -188,6 +202,8 @@ private:
 
     SignalChainManager* signalChainManager;
 
+    ScopedPointer<SettingsFileThread> settingsFileThread;
+
     Font font;
     Image sourceDropImage;
 
@@ -0,0 +1,252 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProfilerPanel.h"
+#include "../Processors/GenericProcessor.h"
+
+#define ROW_HEIGHT 18
+#define HEADER_HEIGHT 40
+
+ProfilerPanel::ProfilerPanel(ProcessorGraph* graph_)
+    : graph(graph_)
+{
+    font = Font("Small Text", 12, Font::plain);
+
+    resetButton = new UtilityButton("reset", Font("Small Text", 13, Font::plain));
+    resetButton->addListener(this);
+    addAndMakeVisible(resetButton);
+
+    saveButton = new UtilityButton("save CSV", Font("Small Text", 13, Font::plain));
+    saveButton->addListener(this);
+    addAndMakeVisible(saveButton);
+
+    updateRows();
+
+    startTimer(500);
+}
+
+ProfilerPanel::~ProfilerPanel()
+{
+    stopTimer();
+}
+
+class RowSorter
+{
+public:
+    template <class RowType>
+    static int compareElements(const RowType& first, const RowType& second)
+    {
+        if (first.snapshot.totalSeconds > second.snapshot.totalSeconds)
+            return -1;
+        else if (first.snapshot.totalSeconds < second.snapshot.totalSeconds)
+            return 1;
+        else
+            return first.nodeId - second.nodeId;
+    }
+};
+
+void ProfilerPanel::updateRows()
+{
+    rows.clear();
+
+    Array<GenericProcessor*> processors = graph->getAllProcessors();
+
+    for (int i = 0; i < processors.size(); i++)
+    {
+        GenericProcessor* p = processors[i];
+
+        Row row;
+        row.name = p->getName();
+        row.nodeId = p->getNodeId();
+        row.sampleRate = p->getSampleRate();
+        p->getProfile()->getSnapshot(row.snapshot);
+
+        rows.add(row);
+    }
+
+    RowSorter sorter;
+    rows.sort(sorter);
+}
+
+void ProfilerPanel::timerCallback()
+{
+    updateRows();
+    repaint();
+}
+
+void ProfilerPanel::resized()
+{
+    resetButton->setBounds(getWidth() - 150, 8, 60, 20);
+    saveButton->setBounds(getWidth() - 80, 8, 70, 20);
+}
+
+void ProfilerPanel::buttonClicked(Button* button)
+{
+    if (button == resetButton)
+    {
+        Array<GenericProcessor*> processors = graph->getAllProcessors();
+
+        for (int i = 0; i < processors.size(); i++)
+            processors[i]->getProfile()->reset();
+
+        updateRows();
+        repaint();
+    }
+    else if (button == saveButton)
+    {
+        FileChooser fc("Choose the file to save...",
+                       File::getCurrentWorkingDirectory(),
+                       "*.csv",
+                       true);
+
+        if (fc.browseForFileToSave(true))
+        {
+            updateRows();
+
+            if (! writeCsv(fc.getResult()))
+                std::cout << "Could not write " << fc.getResult().getFullPathName() << std::endl;
+        }
+    }
+}
+
+static double getBudgetFraction(const ProcessorProfile::Snapshot& s, float sampleRate)
+{
+    if (s.numSamples == 0 || sampleRate <= 0)
+        return 0.0;
+
+    return s.totalSeconds / (double(s.numSamples) / sampleRate);
+}
+
+static double getMeanMicroseconds(const ProcessorProfile::Snapshot& s)
+{
+    if (s.numBlocks == 0)
+        return 0.0;
+
+    return s.totalSeconds / double(s.numBlocks) * 1.0e6;
+}
+
+bool ProfilerPanel::writeCsv(const File& file)
+{
+    file.deleteFile();
+
+    ScopedPointer<FileOutputStream> stream(file.createOutputStream());
+
+    if (stream == nullptr)
+        return false;
+
+    *stream << "name,node_id,sample_rate,blocks,samples,allocations,skipped,"
+            << "total_s,mean_us,max_us,last_us,budget_fraction" << newLine;
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const Row& r = rows.getReference(i);
+        const ProcessorProfile::Snapshot& s = r.snapshot;
+
+        *stream << r.name.replaceCharacter(',', ' ') << ","
+                << r.nodeId << ","
+                << String(r.sampleRate) << ","
+                << String(s.numBlocks) << ","
+                << String(s.numSamples) << ","
+                << String(s.numAllocations) << ","
+                << String(s.numSkipped) << ","
+                << String(s.totalSeconds, 6) << ","
+                << String(getMeanMicroseconds(s), 3) << ","
+                << String(s.maxSeconds * 1.0e6, 3) << ","
+                << String(s.lastSeconds * 1.0e6, 3) << ","
+                << String(getBudgetFraction(s, r.sampleRate), 6) << newLine;
+    }
+
+    stream->flush();
+
+    return true;
+}
+
+void ProfilerPanel::paint(Graphics& g)
+{
+    g.fillAll(Colours::darkgrey);
+
+    g.setFont(font);
+
+    const int columns[] = {10, 200, 280, 360, 440, 520, 600, 680};
+    const char* headers[] = {"processor", "blocks", "mean (us)", "max (us)",
+                             "last (us)", "budget", "allocs/block", "skipped"
+                            };
+
+    g.setColour(Colours::white);
+
+    for (int c = 0; c < 8; c++)
+        g.drawText(headers[c], columns[c], HEADER_HEIGHT - ROW_HEIGHT, 80, ROW_HEIGHT,
+                   Justification::left, false);
+
+    g.drawLine(0, HEADER_HEIGHT, getWidth(), HEADER_HEIGHT);
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const Row& r = rows.getReference(i);
+        const ProcessorProfile::Snapshot& s = r.snapshot;
+
+        const int y = HEADER_HEIGHT + i * ROW_HEIGHT + 2;
+        const double budget = getBudgetFraction(s, r.sampleRate);
+
+        // bar showing the share of the callback budget
+        g.setColour(budget > 0.5 ? Colours::orange : Colours::yellow.withAlpha(0.5f));
+        g.fillRect(columns[5], y + 2, int(jmin(budget, 1.0) * 70), ROW_HEIGHT - 4);
+
+        g.setColour(Colours::white);
+
+        String allocs = s.numBlocks > 0 ? String(double(s.numAllocations) / double(s.numBlocks), 2)
+                                        : String("-");
+
+        g.drawText(r.name + " (" + String(r.nodeId) + ")", columns[0], y, 185, ROW_HEIGHT,
+                   Justification::left, true);
+        g.drawText(String(s.numBlocks), columns[1], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(String(getMeanMicroseconds(s), 1), columns[2], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(String(s.maxSeconds * 1.0e6, 1), columns[3], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(String(s.lastSeconds * 1.0e6, 1), columns[4], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(String(budget * 100.0, 2) + "%", columns[5], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(allocs, columns[6], y, 75, ROW_HEIGHT, Justification::left, false);
+        g.drawText(String(s.numSkipped), columns[7], y, 75, ROW_HEIGHT, Justification::left, false);
+    }
+}
+
+ProfilerWindow::ProfilerWindow(ProcessorGraph* graph)
+    : DocumentWindow("Processor profiler",
+                     Colours::black,
+                     DocumentWindow::allButtons)
+{
+    centreWithSize(800, 400);
+    setUsingNativeTitleBar(true);
+    setResizable(true, false);
+
+    setContentOwned(new ProfilerPanel(graph), false);
+}
+
+ProfilerWindow::~ProfilerWindow()
+{
+
+}
+
+void ProfilerWindow::closeButtonPressed()
+{
+    setVisible(false);
+}
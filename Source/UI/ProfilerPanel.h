@@ -0,0 +1,121 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROFILERPANEL_H_91C4E7A2__
+#define __PROFILERPANEL_H_91C4E7A2__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../Processors/ProcessorGraph.h"
+#include "../Processors/Editors/GenericEditor.h" // for UtilityButton
+
+/**
+
+  Shows how much of the callback budget each processor consumes.
+
+  The panel polls the ProcessorProfile of every node in the ProcessorGraph
+  a few times per second and draws one row per processor, sorted by total
+  time spent, so the most expensive node in a long signal chain is always
+  at the top. The "budget" column is the fraction of real time (samples
+  processed divided by sample rate) spent inside that processor.
+
+  The current values can be written to a CSV file for offline analysis.
+
+  @see ProcessorProfile, ProfilerWindow
+
+*/
+
+class ProfilerPanel : public Component,
+    public Timer,
+    public Button::Listener
+{
+public:
+    ProfilerPanel(ProcessorGraph* graph);
+    ~ProfilerPanel();
+
+    /** Draws the table of processor timings. */
+    void paint(Graphics& g);
+
+    /** Positions the buttons. */
+    void resized();
+
+    /** Refreshes the displayed values. */
+    void timerCallback();
+
+    /** Handles the "reset" and "save" buttons. */
+    void buttonClicked(Button* button);
+
+    /** Writes one line per processor to a CSV file. Returns false if the file
+        could not be written. */
+    bool writeCsv(const File& file);
+
+private:
+
+    /** One row of the table. */
+    struct Row
+    {
+        String name;
+        int nodeId;
+        float sampleRate;
+        ProcessorProfile::Snapshot snapshot;
+    };
+
+    /** Takes a snapshot of all processors in the graph, sorted by total time. */
+    void updateRows();
+
+    ProcessorGraph* graph;
+
+    Array<Row> rows;
+
+    ScopedPointer<UtilityButton> resetButton;
+    ScopedPointer<UtilityButton> saveButton;
+
+    Font font;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerPanel);
+
+};
+
+/**
+
+  Holds a ProfilerPanel in its own window, opened from View > Processor profiler.
+
+  @see ProfilerPanel, UIComponent
+
+*/
+
+class ProfilerWindow : public DocumentWindow
+{
+public:
+    ProfilerWindow(ProcessorGraph* graph);
+    ~ProfilerWindow();
+
+    void closeButtonPressed();
+
+private:
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerWindow);
+
+};
+
+
+#endif  // __PROFILERPANEL_H_91C4E7A2__
@@ -0,0 +1,162 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SettingsFileThread.h"
+
+SettingsFileThread::SettingsFileThread(Listener* listener_)
+    : Thread("Settings file"), listener(listener_), numLoads(0)
+{
+    startThread();
+}
+
+SettingsFileThread::~SettingsFileThread()
+{
+    // run() only exits once the queue is empty, so no save is lost
+    signalThreadShouldExit();
+    notify();
+    stopThread(10000);
+
+    cancelPendingUpdate();
+}
+
+void SettingsFileThread::save(XmlElement* xml, const File& file)
+{
+    Job* job = new Job();
+    job->xml = xml;
+    job->file = file;
+    job->isLoad = false;
+    job->succeeded = false;
+
+    {
+        const ScopedLock sl(lock);
+        pending.add(job);
+    }
+
+    notify();
+}
+
+void SettingsFileThread::load(const File& file)
+{
+    Job* job = new Job();
+    job->file = file;
+    job->isLoad = true;
+    job->succeeded = false;
+
+    {
+        const ScopedLock sl(lock);
+        pending.add(job);
+        numLoads++;
+    }
+
+    notify();
+}
+
+bool SettingsFileThread::isLoading()
+{
+    const ScopedLock sl(lock);
+
+    return numLoads > 0;
+}
+
+void SettingsFileThread::run()
+{
+    while (true)
+    {
+        ScopedPointer<Job> job;
+
+        {
+            const ScopedLock sl(lock);
+
+            if (pending.size() > 0)
+                job = pending.removeAndReturn(0);
+        }
+
+        if (job == nullptr)
+        {
+            if (threadShouldExit())
+                break;
+
+            wait(500);
+            continue;
+        }
+
+        if (job->isLoad)
+        {
+            XmlDocument doc(job->file);
+            job->xml = doc.getDocumentElement();
+
+            if (job->xml == nullptr)
+                std::cout << "Could not parse " << job->file.getFullPathName() << ": "
+                          << doc.getLastParseError() << std::endl;
+        }
+        else
+        {
+            // write next to the target, then swap it in
+            TemporaryFile temp(job->file);
+
+            job->succeeded = job->xml->writeToFile(temp.getFile(), String::empty)
+                             && temp.overwriteTargetFileWithTemporary();
+
+            if (! job->succeeded)
+                std::cout << "Couldn't write to file " << job->file.getFullPathName() << std::endl;
+
+            job->xml = nullptr;
+        }
+
+        {
+            const ScopedLock sl(lock);
+            finished.add(job.release());
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void SettingsFileThread::handleAsyncUpdate()
+{
+    while (true)
+    {
+        ScopedPointer<Job> job;
+
+        {
+            const ScopedLock sl(lock);
+
+            if (finished.size() == 0)
+                break;
+
+            job = finished.removeAndReturn(0);
+        }
+
+        if (job->isLoad)
+        {
+            listener->settingsFileLoaded(job->xml.release(), job->file);
+
+            const ScopedLock sl(lock);
+            numLoads--;
+        }
+        else
+        {
+            listener->settingsFileSaved(job->file, job->succeeded);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SETTINGSFILETHREAD_H_4B9D27E1__
+#define __SETTINGSFILETHREAD_H_4B9D27E1__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Reads and writes settings files without blocking the message thread.
+
+  Saving: the caller builds the XmlElement tree (which needs the editors,
+  so it must happen on the message thread) and hands it over. The thread
+  serializes it into a temporary file next to the target, then moves it
+  into place, so a settings file is never left half-written. Whether that
+  worked is reported to the Listener on the message thread.
+
+  Loading: the thread parses the file, then hands the parsed tree back to
+  the Listener on the message thread, which rebuilds the signal chain in
+  one pass. Processors and their editors are components, so they can only
+  be created there.
+
+  Jobs run in the order they were queued. Pending saves are finished
+  before the thread is destroyed.
+
+  @see EditorViewport
+
+*/
+
+class SettingsFileThread : public Thread,
+    public AsyncUpdater
+{
+public:
+
+    /** Receives parsed and written settings files on the message thread. */
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** Called once a file has been parsed. Takes ownership of xml, which
+            is null if the file could not be read or parsed. */
+        virtual void settingsFileLoaded(XmlElement* xml, const File& file) = 0;
+
+        /** Called once a save has finished; succeeded is false if the file
+            could not be written or replaced. */
+        virtual void settingsFileSaved(const File& file, bool succeeded) = 0;
+    };
+
+    SettingsFileThread(Listener* listener);
+    ~SettingsFileThread();
+
+    /** Writes xml to a file in the background. Takes ownership of xml. */
+    void save(XmlElement* xml, const File& file);
+
+    /** Parses a file in the background. */
+    void load(const File& file);
+
+    /** Returns true while a load is queued, running, or waiting to be committed. */
+    bool isLoading();
+
+    /** Processes queued jobs. */
+    void run();
+
+    /** Hands parsed files and save results to the Listener. */
+    void handleAsyncUpdate();
+
+private:
+
+    struct Job
+    {
+        ScopedPointer<XmlElement> xml;
+        File file;
+        bool isLoad;
+        bool succeeded;
+    };
+
+    Listener* listener;
+
+    CriticalSection lock;
+    OwnedArray<Job> pending;
+    OwnedArray<Job> finished;
+
+    int numLoads;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SettingsFileThread);
+
+};
+
+
+#endif  // __SETTINGSFILETHREAD_H_4B9D27E1__
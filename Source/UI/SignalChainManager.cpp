@@ -32,7 +32,7 @@ SignalChainManager::SignalChainManager
  Array<GenericEditor*, CriticalSection>& editorArray_,
  Array<SignalChainTabButton*, CriticalSection>& signalChainArray_)
     : editorArray(editorArray_), signalChainArray(signalChainArray_),
-      ev(ev_), tabSize(30)
+      ev(ev_), tabSize(30), updatesDeferred(false)
 {
     topTab = 0;
 }
@@ -485,7 +485,13 @@ void SignalChainManager::updateVisibleEditors(GenericEditor* activeEditor,
     }
 
     // Step 7: update all settings
-    if (action != ACTIVATE)
+    if (action == ADD && updatesDeferred)
+    {
+        // processors are loaded from source to sink, so everything upstream
+        // of the new one is already up to date
+        activeEditor->getProcessor()->update();
+    }
+    else if (action != ACTIVATE)
     {
 
         std::cout << "Updating settings." << std::endl;
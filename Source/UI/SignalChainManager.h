@@ -69,6 +69,14 @@ public:
     /** Clears the signal chain.*/
     void clearSignalChain();
 
+    /** While true, adding an editor only updates the new processor instead of
+    every processor in every chain. Used while a configuration is loaded, which
+    ends with a single UPDATE of the whole chain.*/
+    void setUpdatesDeferred(bool t)
+    {
+        updatesDeferred = t;
+    }
+
 private:
 
     /** An array of all currently visible editors.*/
@@ -89,6 +97,8 @@ private:
 
     const int tabSize;
 
+    bool updatesDeferred;
+
 
 };
 
@@ -262,6 +262,11 @@ PopupMenu UIComponent::getMenuForIndex(int menuIndex, const String& menuName)
         menu.addCommandItem(commandManager, toggleSignalChain);
         menu.addCommandItem(commandManager, toggleFileInfo);
         menu.addSeparator();
+        menu.addCommandItem(commandManager, toggleLatencyMonitor);
+        menu.addCommandItem(commandManager, showProfiler);
+        menu.addCommandItem(commandManager, toggleParallelChains);
+        menu.addCommandItem(commandManager, toggleDeadlineMonitor);
+        menu.addSeparator();
         menu.addCommandItem(commandManager, resizeWindow);
 
     }
@@ -302,7 +307,11 @@ void UIComponent::getAllCommands(Array <CommandID>& commands)
                              toggleSignalChain,
                              toggleFileInfo,
                              showHelp,
-                             resizeWindow
+                             resizeWindow,
+                             toggleLatencyMonitor,
+                             showProfiler,
+                             toggleParallelChains,
+                             toggleDeadlineMonitor
                             };
 
     commands.addArray(ids, numElementsInArray(ids));
@@ -385,6 +394,28 @@ void UIComponent::getCommandInfo(CommandID commandID, ApplicationCommandInfo& re
             result.setInfo("Reset window bounds", "Reset window bounds", "General", 0);
             break;
 
+        case toggleLatencyMonitor:
+            result.setInfo("Latency monitor", "Measure TTL-to-output latency during acquisition.", "General", 0);
+            result.setTicked(processorGraph->getLatencyMonitor()->isEnabled());
+            result.setActive(!acquisitionStarted);
+            break;
+
+        case showProfiler:
+            result.setInfo("Processor profiler", "Show the time spent in each processor.", "General", 0);
+            break;
+
+        case toggleParallelChains:
+            result.setInfo("Parallel signal chains", "Process independent signal chains on several threads.", "General", 0);
+            result.setTicked(processorGraph->getParallelRenderer()->isEnabled());
+            result.setActive(!acquisitionStarted);
+            break;
+
+        case toggleDeadlineMonitor:
+            result.setInfo("Deadline scheduler", "Skip display and audio work when a callback runs late.", "General", 0);
+            result.setTicked(processorGraph->getDeadlineMonitor()->isEnabled());
+            result.setActive(!acquisitionStarted);
+            break;
+
         default:
             break;
     };
@@ -460,6 +491,53 @@ bool UIComponent::perform(const InvocationInfo& info)
             mainWindow->centreWithSize(800, 600);
             break;
 
+        case toggleLatencyMonitor:
+            {
+                LatencyMonitor* monitor = processorGraph->getLatencyMonitor();
+                monitor->setEnabled(!monitor->isEnabled());
+
+                if (monitor->isEnabled())
+                    sendActionMessage("Latency report will be printed when acquisition stops.");
+                else
+                    sendActionMessage("Latency monitor disabled.");
+
+                break;
+            }
+
+        case showProfiler:
+            if (profilerWindow == nullptr)
+                profilerWindow = new ProfilerWindow(processorGraph);
+
+            profilerWindow->setVisible(true);
+            profilerWindow->toFront(true);
+            break;
+
+        case toggleParallelChains:
+            {
+                ParallelGraphRenderer* renderer = processorGraph->getParallelRenderer();
+                renderer->setEnabled(!renderer->isEnabled());
+
+                if (renderer->isEnabled())
+                    sendActionMessage("Independent signal chains will run in parallel.");
+                else
+                    sendActionMessage("Signal chains will run on the audio thread only.");
+
+                break;
+            }
+
+        case toggleDeadlineMonitor:
+            {
+                DeadlineMonitor* monitor = processorGraph->getDeadlineMonitor();
+                monitor->setEnabled(!monitor->isEnabled());
+
+                if (monitor->isEnabled())
+                    sendActionMessage("Display and audio will be skipped in late callbacks.");
+                else
+                    sendActionMessage("Deadline scheduler disabled.");
+
+                break;
+            }
+
         default:
             break;
 
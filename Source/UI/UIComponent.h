@@ -31,6 +31,7 @@
 #include "EditorViewport.h"
 #include "DataViewport.h"
 #include "MessageCenter.h"
+#include "ProfilerPanel.h"
 #include "../Processors/ProcessorGraph.h"
 #include "../Audio/AudioComponent.h"
 #include "../MainWindow.h"
@@ -164,6 +165,7 @@ private:
     ScopedPointer<ControlPanel> controlPanel;
     ScopedPointer<MessageCenter> messageCenter;
     ScopedPointer<InfoLabel> infoLabel;
+    ScopedPointer<ProfilerWindow> profilerWindow;
 
     /** Pointer to the GUI's MainWindow, which owns the UIComponent. */
     MainWindow* mainWindow;
@@ -196,7 +198,11 @@ private:
         toggleSignalChain	    = 0x2009,
         toggleFileInfo			= 0x2010,
         showHelp				= 0x2011,
-        resizeWindow            = 0x2012
+        resizeWindow            = 0x2012,
+        toggleLatencyMonitor    = 0x2013,
+        showProfiler            = 0x2014,
+        toggleParallelChains    = 0x2015,
+        toggleDeadlineMonitor   = 0x2016
     };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UIComponent);